@@ -0,0 +1,52 @@
+// Copyright (C) 2021 twyleg
+#include <logging/binary_log_reader.h>
+#include <logging/log_pattern_formatter.h>
+#include <logging/logger.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <segment.binlog|directory>..." << std::endl;
+		return 1;
+	}
+
+	std::vector<boost::filesystem::path> segmentPaths;
+	for (int i=1; i<argc; ++i) {
+		const boost::filesystem::path path(argv[i]);
+		if (boost::filesystem::is_directory(path)) {
+			for (const auto& entry: boost::filesystem::directory_iterator(path)) {
+				if (entry.path().extension() == ".binlog") {
+					segmentPaths.push_back(entry.path());
+				}
+			}
+		} else {
+			segmentPaths.push_back(path);
+		}
+	}
+	std::sort(segmentPaths.begin(), segmentPaths.end());
+
+	const auto formatter = Logging::createFormatter(Logging::Logger::getLogPattern());
+	spdlog::memory_buf_t formatted;
+
+	try {
+		for (const auto& segmentPath: segmentPaths) {
+			Logging::BinaryLogReader::readSegment(segmentPath, [&](const spdlog::details::log_msg& msg) {
+				formatted.clear();
+				formatter->format(msg, formatted);
+				std::fwrite(formatted.data(), 1, formatted.size(), stdout);
+			});
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
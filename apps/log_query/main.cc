@@ -0,0 +1,425 @@
+// Copyright (C) 2021 twyleg
+#include <logging/log_index.h>
+
+#include <spdlog/common.h>
+
+#include <boost/filesystem.hpp>
+
+#include <zlib.h>
+
+#ifdef LOGGING_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace Logging;
+
+constexpr int64_t NS_PER_MS = 1000000;
+constexpr int64_t NS_PER_S = 1000 * NS_PER_MS;
+
+// "[YYYYmmdd-HH:MM:SS.mmm]", the time prefix of LOG_PATTERN
+constexpr size_t TIME_PREFIX_SIZE = 23;
+constexpr size_t READ_BLOCK_SIZE = 1024 * 1024;
+
+struct Query {
+	int64_t mFrom = std::numeric_limits<int64_t>::min();
+	int64_t mTo = std::numeric_limits<int64_t>::max();
+	spdlog::level::level_enum mMinLevel = spdlog::level::trace;
+	std::vector<std::string> mModules;
+	uint64_t mModuleMask = 0;
+};
+
+class LogFile {
+
+public:
+
+	// The size hint avoids regrowing the buffer of compressed files
+	LogFile(const boost::filesystem::path& filePath, size_t sizeHint) {
+		if (filePath.extension() == ".gz") {
+			readCompressed(filePath, sizeHint);
+		} else if (filePath.extension() == ".zst") {
+			readZstdCompressed(filePath, sizeHint);
+		} else {
+			map(filePath);
+		}
+	}
+
+	LogFile(const LogFile&) = delete;
+	LogFile& operator=(const LogFile&) = delete;
+
+	~LogFile() {
+		if (mMapping) {
+			::munmap(mMapping, mData.size());
+		}
+	}
+
+	std::string_view data() const { return mData; }
+
+private:
+
+	void map(const boost::filesystem::path& filePath) {
+		const int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat fileStat;
+		if (fd < 0 || ::fstat(fd, &fileStat) != 0) {
+			throw std::runtime_error("Unable to open log file \"" + filePath.string() + "\"");
+		}
+		const size_t size = static_cast<size_t>(fileStat.st_size);
+		if (size > 0) {
+			mMapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mMapping == MAP_FAILED) {
+				mMapping = nullptr;
+				::close(fd);
+				throw std::runtime_error("Unable to map log file \"" + filePath.string() + "\"");
+			}
+			mData = std::string_view(static_cast<const char*>(mMapping), size);
+		}
+		::close(fd);
+	}
+
+	void readCompressed(const boost::filesystem::path& filePath, size_t sizeHint) {
+		gzFile file = ::gzopen(filePath.c_str(), "rb");
+		if (!file) {
+			throw std::runtime_error("Unable to open log file \"" + filePath.string() + "\"");
+		}
+		::gzbuffer(file, READ_BLOCK_SIZE);
+
+		mBuffer.resize(std::max(sizeHint, READ_BLOCK_SIZE));
+		size_t size = 0;
+		int read;
+		while ((read = ::gzread(file, &mBuffer[size], static_cast<unsigned>(std::min(mBuffer.size() - size, READ_BLOCK_SIZE)))) > 0) {
+			size += static_cast<size_t>(read);
+			if (size == mBuffer.size()) {
+				mBuffer.resize(mBuffer.size() * 2);
+			}
+		}
+		::gzclose(file);
+		mBuffer.resize(size);
+		mData = mBuffer;
+	}
+
+	void readZstdCompressed(const boost::filesystem::path& filePath, size_t sizeHint) {
+#ifdef LOGGING_WITH_ZSTD
+		std::unique_ptr<std::FILE, decltype(&std::fclose)> file(std::fopen(filePath.c_str(), "rb"), &std::fclose);
+		std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+		if (!file || !context) {
+			throw std::runtime_error("Unable to open log file \"" + filePath.string() + "\"");
+		}
+
+		std::vector<char> inputBuffer(ZSTD_DStreamInSize());
+		mBuffer.resize(std::max(sizeHint, READ_BLOCK_SIZE));
+		size_t size = 0;
+		size_t read;
+		while ((read = std::fread(inputBuffer.data(), 1, inputBuffer.size(), file.get())) > 0) {
+			ZSTD_inBuffer in{inputBuffer.data(), read, 0};
+			// A full output buffer may leave decompressed data behind in the context
+			bool outputFull;
+			do {
+				if (size == mBuffer.size()) {
+					mBuffer.resize(mBuffer.size() * 2);
+				}
+				ZSTD_outBuffer out{&mBuffer[size], mBuffer.size() - size, 0};
+				const size_t result = ZSTD_decompressStream(context.get(), &out, &in);
+				if (ZSTD_isError(result)) {
+					throw std::runtime_error("Unable to decompress log file \"" + filePath.string() + "\": "
+							+ ZSTD_getErrorName(result));
+				}
+				size += out.pos;
+				outputFull = out.pos == out.size;
+			} while (in.pos < in.size || outputFull);
+		}
+		mBuffer.resize(size);
+		mData = mBuffer;
+#else
+		(void) sizeHint;
+		throw std::runtime_error("Unable to read log file \"" + filePath.string() + "\", log_query was built without zstd support");
+#endif
+	}
+
+	void* mMapping = nullptr;
+	std::string mBuffer;
+	std::string_view mData;
+};
+
+bool parseDigits(std::string_view text, size_t pos, size_t count, int& value) {
+	value = 0;
+	for (size_t i=pos; i<pos+count; ++i) {
+		if (i >= text.size() || !std::isdigit(static_cast<unsigned char>(text[i]))) {
+			return false;
+		}
+		value = value * 10 + (text[i] - '0');
+	}
+	return true;
+}
+
+// Local time of the full hour, mktime is far too slow to be called for every record
+int64_t hourTimestamp(int year, int month, int day, int hour) {
+	static int cachedKey = -1;
+	static int64_t cachedTimestamp = 0;
+
+	const int key = ((year * 16 + month) * 32 + day) * 32 + hour;
+	if (key != cachedKey) {
+		std::tm tm{};
+		tm.tm_year = year - 1900;
+		tm.tm_mon = month - 1;
+		tm.tm_mday = day;
+		tm.tm_hour = hour;
+		tm.tm_isdst = -1;
+		cachedTimestamp = static_cast<int64_t>(std::mktime(&tm)) * NS_PER_S;
+		cachedKey = key;
+	}
+	return cachedTimestamp;
+}
+
+// Parses "YYYYmmdd-HH:MM:SS[.mmm]" in local time, like the timestamps of LOG_PATTERN.
+// The resolution is the length of the last given field in nanoseconds.
+bool parseTime(std::string_view text, int64_t& timestamp, int64_t& resolution) {
+	int year, month, day, hour, minute, second;
+	int milliseconds = 0;
+	if (text.size() < 17 || text[8] != '-' || text[11] != ':' || text[14] != ':'
+			|| !parseDigits(text, 0, 4, year) || !parseDigits(text, 4, 2, month) || !parseDigits(text, 6, 2, day)
+			|| !parseDigits(text, 9, 2, hour) || !parseDigits(text, 12, 2, minute) || !parseDigits(text, 15, 2, second)) {
+		return false;
+	}
+	if (text.size() == 17) {
+		resolution = NS_PER_S;
+	} else if (text.size() == 21 && text[17] == '.' && parseDigits(text, 18, 3, milliseconds)) {
+		resolution = NS_PER_MS;
+	} else {
+		return false;
+	}
+
+	timestamp = hourTimestamp(year, month, day, hour) + (minute * 60 + second) * NS_PER_S + milliseconds * NS_PER_MS;
+	return true;
+}
+
+bool isRecordStart(std::string_view data) {
+	int64_t timestamp;
+	int64_t resolution;
+	return data.size() > TIME_PREFIX_SIZE && data[0] == '[' && data[TIME_PREFIX_SIZE - 1] == ']'
+			&& parseTime(data.substr(1, TIME_PREFIX_SIZE - 2), timestamp, resolution);
+}
+
+bool nextField(std::string_view& rest, std::string_view& field) {
+	if (rest.size() < 2 || rest[0] != ' ' || rest[1] != '[') {
+		return false;
+	}
+	const auto end = rest.find(']', 2);
+	if (end == std::string_view::npos) {
+		return false;
+	}
+	field = rest.substr(2, end - 2);
+	rest.remove_prefix(end + 1);
+	return true;
+}
+
+bool matchesLevel(const Query& query, std::string_view levelName) {
+	for (int level=query.mMinLevel; level<spdlog::level::off; ++level) {
+		const auto name = spdlog::level::to_string_view(static_cast<spdlog::level::level_enum>(level));
+		if (levelName == std::string_view(name.data(), name.size())) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Records that do not start like LOG_PATTERN can only be filtered through the index
+bool matches(const Query& query, std::string_view record) {
+	int64_t timestamp;
+	int64_t resolution;
+	std::string_view rest = record.substr(std::min(record.size(), TIME_PREFIX_SIZE));
+	std::string_view threadId;
+	std::string_view module;
+	std::string_view level;
+	if (!isRecordStart(record) || !parseTime(record.substr(1, TIME_PREFIX_SIZE - 2), timestamp, resolution)
+			|| !nextField(rest, threadId) || !nextField(rest, module) || !nextField(rest, level)) {
+		return true;
+	}
+
+	return timestamp >= query.mFrom && timestamp <= query.mTo && matchesLevel(query, level)
+			&& (query.mModules.empty() || std::find(query.mModules.begin(), query.mModules.end(), module) != query.mModules.end());
+}
+
+bool mayMatch(const Query& query, const LogIndex::Entry& entry) {
+	return entry.mMaxTimestamp >= query.mFrom && entry.mMinTimestamp <= query.mTo
+			&& (entry.mLevelMask >> query.mMinLevel) != 0
+			&& (!query.mModuleMask || (entry.mModuleMask & query.mModuleMask));
+}
+
+void scanRecords(const Query& query, std::string_view data) {
+	size_t start = 0;
+	while (start < data.size()) {
+		// Continuation lines of multi-line messages belong to the record before them
+		const bool hasHeader = isRecordStart(data.substr(start));
+		size_t end = start;
+		do {
+			const auto newline = data.find('\n', end);
+			end = newline == std::string_view::npos ? data.size() : newline + 1;
+		} while (hasHeader && end < data.size() && !isRecordStart(data.substr(end)));
+
+		const auto record = data.substr(start, end - start);
+		if (matches(query, record)) {
+			std::fwrite(record.data(), 1, record.size(), stdout);
+		}
+		start = end;
+	}
+}
+
+bool isCompressed(const boost::filesystem::path& filePath) {
+	return filePath.extension() == ".gz" || filePath.extension() == ".zst";
+}
+
+boost::filesystem::path logFilePath(const boost::filesystem::path& filePath) {
+	return isCompressed(filePath) ? boost::filesystem::path(filePath).replace_extension() : filePath;
+}
+
+// Orders files oldest first. Rotated files are renamed, so neither their name nor their
+// modification time tells when their first record was written, but their index does.
+int64_t firstTimestamp(const boost::filesystem::path& filePath) {
+	const auto entries = LogIndex::read(LogIndex::indexPath(logFilePath(filePath)));
+	if (!entries.empty()) {
+		return entries.front().mMinTimestamp;
+	}
+	return static_cast<int64_t>(boost::filesystem::last_write_time(filePath)) * NS_PER_S;
+}
+
+void queryFile(const Query& query, const boost::filesystem::path& filePath) {
+	const bool compressed = isCompressed(filePath);
+	const auto entries = LogIndex::read(LogIndex::indexPath(logFilePath(filePath)));
+
+	// Compressed segments are complete, so their index covers all of their records
+	if (compressed && !entries.empty() && std::none_of(entries.begin(), entries.end(),
+			[&query](const LogIndex::Entry& entry) { return mayMatch(query, entry); })) {
+		return;
+	}
+
+	const LogFile file(filePath, entries.empty() ? 0 : entries.back().mOffset + entries.back().mSize);
+	const auto data = file.data();
+
+	// Bytes no entry covers are scanned completely
+	uint64_t offset = 0;
+	for (const auto& entry: entries) {
+		if (entry.mOffset < offset || entry.mOffset + entry.mSize > data.size()) {
+			break;
+		}
+		if (entry.mOffset > offset) {
+			scanRecords(query, data.substr(offset, entry.mOffset - offset));
+		}
+		if (mayMatch(query, entry)) {
+			scanRecords(query, data.substr(entry.mOffset, entry.mSize));
+		}
+		offset = entry.mOffset + entry.mSize;
+	}
+	scanRecords(query, data.substr(offset));
+}
+
+bool isLogFile(const boost::filesystem::path& path) {
+	const auto fileName = path.filename().string();
+	const auto endsWith = [&fileName](std::string_view suffix) {
+		return fileName.size() >= suffix.size() && fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+	return endsWith(".log") || endsWith(".log.gz") || endsWith(".log.zst");
+}
+
+// from_str maps unknown names to off, so off has to be spelled out
+bool parseLevel(const char* text, spdlog::level::level_enum& level) {
+	level = spdlog::level::from_str(text);
+	return level != spdlog::level::off || !std::strcmp(text, "off");
+}
+
+void printUsage(const char* binaryName) {
+	std::cerr << "Usage: " << binaryName
+			<< " [--from <YYYYmmdd-HH:MM:SS[.mmm]>] [--to <YYYYmmdd-HH:MM:SS[.mmm]>] [--level <minimum level>]"
+			<< " [--module <name>]... <file.log|file.log.gz|file.log.zst|directory>..." << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+
+	Query query;
+	std::vector<boost::filesystem::path> filePaths;
+
+	for (int i=1; i<argc; ++i) {
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		int64_t timestamp;
+		int64_t resolution;
+		if (!std::strcmp(argv[i], "--from") || !std::strcmp(argv[i], "--to")) {
+			if (!value || !parseTime(value, timestamp, resolution)) {
+				std::cerr << "Invalid time for " << argv[i] << ": \"" << (value ? value : "") << "\"" << std::endl;
+				printUsage(argv[0]);
+				return 1;
+			}
+			if (!std::strcmp(argv[i], "--from")) {
+				query.mFrom = timestamp;
+			} else {
+				query.mTo = timestamp + resolution - 1;
+			}
+			++i;
+		} else if (!std::strcmp(argv[i], "--level")) {
+			if (!value || !parseLevel(value, query.mMinLevel)) {
+				std::cerr << "Invalid level for --level: \"" << (value ? value : "") << "\"" << std::endl;
+				printUsage(argv[0]);
+				return 1;
+			}
+			++i;
+		} else if (!std::strcmp(argv[i], "--module") && value) {
+			query.mModules.emplace_back(argv[++i]);
+			query.mModuleMask |= LogIndex::moduleBit(query.mModules.back());
+		} else if (argv[i][0] != '-') {
+			const boost::filesystem::path path(argv[i]);
+			if (boost::filesystem::is_directory(path)) {
+				for (const auto& entry: boost::filesystem::directory_iterator(path)) {
+					if (isLogFile(entry.path())) {
+						filePaths.push_back(entry.path());
+					}
+				}
+			} else {
+				filePaths.push_back(path);
+			}
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (filePaths.empty()) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	try {
+		std::vector<std::pair<int64_t, boost::filesystem::path>> sortedFilePaths;
+		for (const auto& filePath: filePaths) {
+			sortedFilePaths.emplace_back(firstTimestamp(filePath), filePath);
+		}
+		std::sort(sortedFilePaths.begin(), sortedFilePaths.end());
+
+		for (const auto& filePath: sortedFilePaths) {
+			queryFile(query, filePath.second);
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,6 +1,8 @@
 // Copyright (C) 2021 twyleg
 #include <logging/logger.h>
+#include <qt_logging/log_filter_model.h>
 #include <qt_logging/sinks.h>
+#include <qt_logging/utils.h>
 
 #include <simple_xercesc/xml_reader.h>
 
@@ -90,8 +92,16 @@ private:
 
 		Logging::Logger::instance().configure(config);
 		Logging::Logger::instance().addSink(qStringListModelSink);
+		Logging::Qt::initQmlLoggerRedirection(config.mCategoryModules);
+		Logging::Logger::instance().watchConfigFile(CONFIG_XML_PATH, [](const boost::filesystem::path&) {
+			// The logger does not know about Qt categories, their mappings are reloaded here
+			auto reloadedConfig = readConfig();
+			Logging::Qt::setCategoryModules(reloadedConfig.mCategoryModules);
+			return reloadedConfig;
+		});
 
-		mEngine.rootContext()->setContextProperty("logMessages", &qStringListModelSink->mStringListModel);
+		mLogFilterModel.setSourceModel(&qStringListModelSink->mLogModel);
+		mEngine.rootContext()->setContextProperty("logMessages", &mLogFilterModel);
 	}
 
 	void initUi() {
@@ -103,6 +113,7 @@ private:
 	char **mArgv;
 
 	QApplication mApplication;
+	Logging::Qt::LogFilterModel mLogFilterModel;
 	QQmlApplicationEngine mEngine;
 	QTimer mPrintTimer;
 };
@@ -13,6 +13,17 @@ Item {
 	property int fontSizePixel: 10
 	property alias scrollLock: scrollLockCheckbox.checked
 
+	function levelColor(level) {
+		if (level >= 4) {
+			return "red"
+		} else if (level === 3) {
+			return "orange"
+		} else if (level <= 1) {
+			return "gray"
+		}
+		return logView.foregroundColor
+	}
+
 	Rectangle {
 		id: backgroundRectangle
 
@@ -53,6 +64,17 @@ Item {
 				text: "Lock"
 				checked: true
 			}
+
+			ComboBox {
+				model: ["Trace", "Debug", "Info", "Warn", "Error", "Critical"]
+				currentIndex: logMessages.minimumLevel
+				onActivated: logMessages.minimumLevel = index
+			}
+
+			TextField {
+				placeholderText: "Search"
+				onTextChanged: logMessages.searchText = text
+			}
 		}
 
 		ListView {
@@ -83,7 +105,7 @@ Item {
 			delegate: Text {
 				font.pixelSize: fontSizePixel
 				text: display
-				color: logView.foregroundColor
+				color: levelColor(level)
 			}
 
 			ScrollBar.vertical: ScrollBar {
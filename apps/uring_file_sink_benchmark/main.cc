@@ -0,0 +1,72 @@
+// Copyright (C) 2021 twyleg
+#include <logging/logger.h>
+#include <logging/uring_file_sink.h>
+#include <logging/vectored_file_sink.h>
+
+#include <spdlog/sinks/rotating_file_sink.h>
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_FILE_SIZE = 64 * 1024 * 1024;
+constexpr size_t MAX_NUM_FILES = 2;
+
+void runBenchmark(const std::string& name, spdlog::sink_ptr sink, size_t numMessages, size_t numThreads) {
+	sink->set_pattern(Logging::Logger::getLogPattern());
+	auto logger = std::make_shared<spdlog::logger>(name, sink);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (size_t t=0; t<numThreads; ++t) {
+		threads.emplace_back([&logger, numMessages, numThreads, t]() {
+			for (size_t i=t; i<numMessages; i+=numThreads) {
+				logger->info("benchmark message {} with some payload {:.3f}", i, i * 0.5);
+			}
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+	logger->flush();
+
+	const auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << name << ": " << numMessages << " messages, " << numThreads << " threads, "
+			<< duration * 1000.0 << " ms, " << static_cast<size_t>(numMessages / duration) << " msg/s" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+
+	const size_t numMessages = argc > 1 ? std::stoul(argv[1]) : 1000000;
+	const size_t numThreads = argc > 2 ? std::stoul(argv[2]) : 1;
+	const boost::filesystem::path outputDir = argc > 3 ? argv[3] : "./benchmark_log";
+
+	boost::filesystem::create_directories(outputDir);
+
+	runBenchmark("spdlog_rotating_file_sink", std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
+			(outputDir / "spdlog_rotating.log").string(), MAX_FILE_SIZE, MAX_NUM_FILES), numMessages, numThreads);
+
+	runBenchmark("rotating_file_sink", std::make_shared<Logging::VectoredFileSink>(
+			outputDir / "rotating.log", true, Logging::VectoredFileSink::DEFAULT_FLUSH_POLICY,
+			MAX_FILE_SIZE, MAX_NUM_FILES), numMessages, numThreads);
+
+	if (Logging::UringFileSink::isSupported()) {
+		runBenchmark("uring_file_sink", std::make_shared<Logging::UringFileSink>(
+				outputDir / "uring.log", true, Logging::UringFileSink::DEFAULT_PARAMETERS,
+				MAX_FILE_SIZE, MAX_NUM_FILES), numMessages, numThreads);
+	} else {
+		std::cout << "uring_file_sink: io_uring not supported" << std::endl;
+	}
+
+	return 0;
+}
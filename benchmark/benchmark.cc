@@ -0,0 +1,112 @@
+// Copyright (C) 2021 twyleg
+#include "benchmark.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <thread>
+
+namespace Logging::Benchmark {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t toNanoseconds(Clock::duration duration) {
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sortedSamples, double fraction) {
+	if (sortedSamples.empty()) {
+		return 0;
+	}
+	const auto index = static_cast<size_t>(fraction * static_cast<double>(sortedSamples.size() - 1));
+	return sortedSamples[index];
+}
+
+}
+
+Result run(const Scenario& scenario, size_t threads, size_t messagesPerThread) {
+
+	if (scenario.mSetUp) {
+		scenario.mSetUp();
+	}
+
+	std::vector<std::vector<uint64_t>> samples(threads);
+	std::atomic<size_t> readyThreads{0};
+	std::atomic<bool> start{false};
+
+	std::vector<std::thread> producers;
+	for (size_t t=0; t<threads; ++t) {
+		producers.emplace_back([&, t]() {
+			auto& threadSamples = samples[t];
+			threadSamples.reserve(messagesPerThread);
+
+			readyThreads.fetch_add(1);
+			while (!start.load()) {
+				std::this_thread::yield();
+			}
+
+			for (size_t i=0; i<messagesPerThread; ++i) {
+				const auto begin = Clock::now();
+				scenario.mLog(i);
+				threadSamples.push_back(toNanoseconds(Clock::now() - begin));
+			}
+		});
+	}
+
+	while (readyThreads.load() < threads) {
+		std::this_thread::yield();
+	}
+
+	const auto begin = Clock::now();
+	start.store(true);
+	for (auto& producer: producers) {
+		producer.join();
+	}
+	if (scenario.mTearDown) {
+		scenario.mTearDown();
+	}
+	const auto durationNs = toNanoseconds(Clock::now() - begin);
+
+	std::vector<uint64_t> latencies;
+	latencies.reserve(threads * messagesPerThread);
+	for (const auto& threadSamples: samples) {
+		latencies.insert(latencies.end(), threadSamples.begin(), threadSamples.end());
+	}
+	std::sort(latencies.begin(), latencies.end());
+
+	const size_t messages = threads * messagesPerThread;
+	return {
+		scenario.mName,
+		threads,
+		messages,
+		durationNs,
+		durationNs ? static_cast<double>(messages) * 1e9 / static_cast<double>(durationNs) : 0.0,
+		percentile(latencies, 0.5),
+		percentile(latencies, 0.99),
+		percentile(latencies, 0.999),
+		latencies.empty() ? 0 : latencies.back()
+	};
+}
+
+void writeJson(std::ostream& os, const std::vector<Result>& results, size_t messagesPerThread, size_t maxThreads) {
+	os << "{\n";
+	os << fmt::format("  \"messagesPerThread\": {},\n", messagesPerThread);
+	os << fmt::format("  \"maxThreads\": {},\n", maxThreads);
+	os << "  \"results\": [";
+	for (size_t i=0; i<results.size(); ++i) {
+		const auto& result = results[i];
+		os << (i ? ",\n" : "\n");
+		os << fmt::format("    {{\"scenario\": \"{}\", \"threads\": {}, \"messages\": {}, \"durationNs\": {}, "
+				"\"throughputPerSecond\": {:.1f}, \"latencyNs\": {{\"p50\": {}, \"p99\": {}, \"p99.9\": {}, \"max\": {}}}}}",
+				result.mScenario, result.mThreads, result.mMessages, result.mDurationNs, result.mThroughput,
+				result.mLatencyP50Ns, result.mLatencyP99Ns, result.mLatencyP999Ns, result.mLatencyMaxNs);
+	}
+	os << "\n  ]\n}\n";
+}
+
+}
@@ -0,0 +1,34 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Logging::Benchmark {
+
+struct Scenario {
+	std::string mName;
+	std::function<void()> mSetUp;
+	std::function<void(size_t)> mLog;
+	std::function<void()> mTearDown;
+};
+
+struct Result {
+	std::string mScenario;
+	size_t mThreads;
+	size_t mMessages;
+	uint64_t mDurationNs;
+	double mThroughput;
+	uint64_t mLatencyP50Ns;
+	uint64_t mLatencyP99Ns;
+	uint64_t mLatencyP999Ns;
+	uint64_t mLatencyMaxNs;
+};
+
+Result run(const Scenario&, size_t threads, size_t messagesPerThread);
+void writeJson(std::ostream&, const std::vector<Result>&, size_t messagesPerThread, size_t maxThreads);
+
+}
@@ -0,0 +1,201 @@
+// Copyright (C) 2021 twyleg
+#include "benchmark.h"
+
+#include <logging/log_pattern_formatter.h>
+#include <logging/logger.h>
+#include <logging/sinks.h>
+
+#include <spdlog/pattern_formatter.h>
+
+#include <boost/filesystem.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace Logging;
+using namespace Logging::Benchmark;
+
+const boost::filesystem::path OUTPUT_DIR = "./bench_logging_output";
+constexpr const char* ROTATING_MAX_SIZE = "67108864";
+constexpr const char* ROTATING_MAX_NUM_FILES = "2";
+constexpr size_t ASYNC_QUEUE_SIZE = 65536;
+
+auto LM = Logger::addModule("bench");
+
+void configure(Logger::Config::LogLevel defaultLogLevel, const Logger::Config::SinkList& sinks,
+		const boost::optional<Logger::Config::AsyncParameters>& async = boost::none) {
+	boost::filesystem::remove_all(OUTPUT_DIR);
+	boost::filesystem::create_directories(OUTPUT_DIR);
+
+	Logger::instance().removeAllSinks();
+	Logger::instance().configure({defaultLogLevel, {}, sinks, {}, async, boost::none});
+}
+
+Logger::Config::SinkDefinition fileSink(const std::string& type,
+		std::unordered_map<std::string, std::string> parameters = {}) {
+	parameters.emplace("outputDir", OUTPUT_DIR.string());
+	parameters.emplace("fileName", "bench");
+	return {type, Logger::Config::SinkParameterMap(parameters)};
+}
+
+void log(size_t i) {
+	LOG(LM, LL_INFO, "benchmark message {} with payload {:.3f} and {}", i, i * 0.5, "a string argument");
+}
+
+void logDeferred(size_t i) {
+	LOG_DEFERRED(LM, LL_INFO, "benchmark message {} with payload {:.3f} and {}", i, i * 0.5, "a string argument");
+}
+
+void logDebug(size_t i) {
+	LOG(LM, LL_DEBUG, "benchmark message {} with payload {:.3f} and {}", i, i * 0.5, "a string argument");
+}
+
+void logKv(size_t i) {
+	LOG_KV(LM, LL_INFO, "benchmark message", "index", i, "payload", i * 0.5, "text", "a string argument");
+}
+
+void flush() {
+	FLUSH(LM);
+}
+
+void flushDeferred() {
+	FLUSH_DEFERRED(LM);
+}
+
+std::unique_ptr<spdlog::formatter> createPatternFormatter() {
+	return std::make_unique<spdlog::pattern_formatter>(Logger::getLogPattern());
+}
+
+std::unique_ptr<spdlog::formatter> createLogPatternFormatter() {
+	return std::make_unique<LogPatternFormatter>();
+}
+
+// Formatting only, without any sink, to compare the formatters for LOG_PATTERN
+template<std::unique_ptr<spdlog::formatter> (*createFormatter)()>
+void format(size_t i) {
+	thread_local const auto formatter = createFormatter();
+	thread_local spdlog::memory_buf_t formatted;
+	const auto payload = fmt::format("benchmark message {}", i);
+	spdlog::details::log_msg msg(LM->name(), LL_INFO, payload);
+	formatted.clear();
+	formatter->format(msg, formatted);
+}
+
+Scenario syncScenario(const std::string& name, const Logger::Config::SinkList& sinks) {
+	return {name, [sinks]() { configure(LL_DEBUG, sinks); }, log, flush};
+}
+
+Scenario asyncScenario(const std::string& name, const Logger::Config::SinkList& sinks, AsyncSink::OverflowPolicy policy) {
+	const Logger::Config::AsyncParameters async{ASYNC_QUEUE_SIZE, policy, 1};
+	return {name, [sinks, async]() { configure(LL_DEBUG, sinks, async); }, log, flush};
+}
+
+Scenario deferredScenario(const std::string& name, const Logger::Config::SinkList& sinks) {
+	return {name, [sinks]() { configure(LL_DEBUG, sinks); }, logDeferred, flushDeferred};
+}
+
+std::vector<Scenario> createScenarios() {
+	return {
+		{"filtered_out", []() { configure(LL_ERROR, {}); }, [](size_t i) {
+			LOG(LM, LL_DEBUG, "filtered message {}", i);
+		}, nullptr},
+		{"pattern_formatter", nullptr, format<createPatternFormatter>, nullptr},
+		{"log_pattern_formatter", nullptr, format<createLogPatternFormatter>, nullptr},
+		{"string_container_sink", []() {
+			configure(LL_DEBUG, {});
+			Logger::instance().addSink(std::make_shared<StringContainerSink<std::vector, std::mutex>>());
+		}, log, flush},
+		syncScenario("console_sink", {{"ConsoleSink", Logger::Config::SinkParameterMap({})}}),
+		syncScenario("single_file_sink", {fileSink("SingleFileSink")}),
+		syncScenario("rotating_file_sink", {fileSink("RotatingFileSink",
+				{{"maxSize", ROTATING_MAX_SIZE}, {"maxNumFiles", ROTATING_MAX_NUM_FILES}})}),
+		syncScenario("compressed_rotating_file_sink", {fileSink("RotatingFileSink",
+				{{"maxSize", ROTATING_MAX_SIZE}, {"maxNumFiles", ROTATING_MAX_NUM_FILES}, {"compress", "gzip"}})}),
+		{"single_file_sink_kv", []() { configure(LL_DEBUG, {fileSink("SingleFileSink")}); }, logKv, flush},
+		{"json_sink_kv", []() { configure(LL_DEBUG, {fileSink("JsonSink")}); }, logKv, flush},
+		{"rate_limited_single_file_sink", []() {
+			configure(LL_DEBUG, {fileSink("SingleFileSink")});
+			Logger::instance().setModuleRateLimit(*LM, {10000.0, 1000, 0});
+		}, log, flush},
+		{"sampled_debug_single_file_sink", []() {
+			configure(LL_DEBUG, {fileSink("SingleFileSink")});
+			Logger::instance().setModuleSampleRate(*LM, 0.01);
+		}, logDebug, flush},
+		syncScenario("timestamp_file_sink", {fileSink("TimestampFileSink")}),
+		syncScenario("binary_file_sink", {fileSink("BinaryFileSink")}),
+		syncScenario("uring_file_sink", {fileSink("UringFileSink")}),
+		asyncScenario("async_block_single_file_sink", {fileSink("SingleFileSink")}, AsyncSink::OverflowPolicy::BLOCK),
+		asyncScenario("async_drop_newest_single_file_sink", {fileSink("SingleFileSink")},
+				AsyncSink::OverflowPolicy::DROP_NEWEST),
+		asyncScenario("async_drop_oldest_single_file_sink", {fileSink("SingleFileSink")},
+				AsyncSink::OverflowPolicy::DROP_OLDEST),
+		deferredScenario("deferred_single_file_sink", {fileSink("SingleFileSink")}),
+		deferredScenario("deferred_binary_file_sink", {fileSink("BinaryFileSink")})
+	};
+}
+
+size_t nextThreadCount(size_t threads, size_t maxThreads) {
+	if (threads < maxThreads && threads * 2 > maxThreads) {
+		return maxThreads;
+	}
+	return threads * 2;
+}
+
+void printUsage(const char* binaryName) {
+	std::cerr << "Usage: " << binaryName
+			<< " [--messages <per thread>] [--threads <max>] [--scenario <name>] [--output <file.json>]" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+
+	size_t messagesPerThread = 100000;
+	size_t maxThreads = 4;
+	std::string scenarioFilter;
+	std::string outputPath = "bench_logging.json";
+
+	for (int i=1; i<argc; ++i) {
+		const bool hasValue = i + 1 < argc;
+		if (!std::strcmp(argv[i], "--messages") && hasValue) {
+			messagesPerThread = std::stoul(argv[++i]);
+		} else if (!std::strcmp(argv[i], "--threads") && hasValue) {
+			maxThreads = std::stoul(argv[++i]);
+		} else if (!std::strcmp(argv[i], "--scenario") && hasValue) {
+			scenarioFilter = argv[++i];
+		} else if (!std::strcmp(argv[i], "--output") && hasValue) {
+			outputPath = argv[++i];
+		} else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::vector<Result> results;
+	for (const auto& scenario: createScenarios()) {
+		if (!scenarioFilter.empty() && scenario.mName != scenarioFilter) {
+			continue;
+		}
+		for (size_t threads=1; threads<=maxThreads; threads=nextThreadCount(threads, maxThreads)) {
+			results.push_back(run(scenario, threads, messagesPerThread));
+			const auto& result = results.back();
+			std::cerr << result.mScenario << " threads=" << result.mThreads
+					<< " throughput=" << static_cast<uint64_t>(result.mThroughput) << "/s"
+					<< " p50=" << result.mLatencyP50Ns << "ns p99=" << result.mLatencyP99Ns
+					<< "ns p99.9=" << result.mLatencyP999Ns << "ns" << std::endl;
+		}
+	}
+	Logger::instance().removeAllSinks();
+	boost::filesystem::remove_all(OUTPUT_DIR);
+
+	std::ofstream ofs(outputPath);
+	writeJson(ofs, results, messagesPerThread, maxThreads);
+	std::cerr << "Results written to " << outputPath << std::endl;
+
+	return 0;
+}
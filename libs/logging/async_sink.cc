@@ -0,0 +1,296 @@
+// Copyright (C) 2021 twyleg
+#include "async_sink.h"
+
+#include <spdlog/pattern_formatter.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <utility>
+
+namespace Logging {
+
+namespace {
+
+constexpr int WORKER_SPIN_COUNT = 64;
+constexpr auto WORKER_IDLE_TIMEOUT = std::chrono::milliseconds(10);
+constexpr auto FLUSH_POLL_INTERVAL = std::chrono::microseconds(100);
+
+}
+
+class AsyncSink::ModuleRoute : public spdlog::sinks::sink, public Structured::StructuredSink {
+
+public:
+
+	ModuleRoute(std::shared_ptr<AsyncSink> asyncSink, const Targets& targets)
+		: mAsyncSink(std::move(asyncSink)),
+		  mTargets(targets)
+	{
+		set_level(mAsyncSink->level());
+	}
+
+	void log(const spdlog::details::log_msg& msg) override {
+		mAsyncSink->enqueue(msg, nullptr, &mTargets);
+	}
+
+	void logStructured(const spdlog::details::log_msg& msg, const Structured::Fields& fields) override {
+		mAsyncSink->enqueue(msg, &fields, &mTargets);
+	}
+
+	void flush() override { mAsyncSink->flush(); }
+	void set_pattern(const std::string& pattern) override { mAsyncSink->set_pattern(pattern); }
+	void set_formatter(std::unique_ptr<spdlog::formatter> formatter) override { mAsyncSink->set_formatter(std::move(formatter)); }
+
+private:
+
+	const std::shared_ptr<AsyncSink> mAsyncSink;
+	const Targets& mTargets;
+};
+
+AsyncSink::AsyncSink(const Parameters& parameters, std::vector<spdlog::sink_ptr> sinks,
+		std::vector<std::shared_ptr<const ModuleFilter>> moduleFilters)
+	: mParameters(parameters),
+	  mSinks(std::move(sinks)),
+	  mModuleFilters(std::move(moduleFilters)),
+	  mQueue(parameters.mQueueSize),
+	  mWorkerStates(std::max<size_t>(1, parameters.mWorkerThreads))
+{
+	for (const auto& sink: mSinks) {
+		if (auto crashDumpSink = dynamic_cast<const CrashDumpSink*>(sink.get())) {
+			mCrashDumpSinks.push_back(crashDumpSink);
+		}
+	}
+
+	for (auto& workerState: mWorkerStates) {
+		mWorkers.emplace_back(&AsyncSink::workerLoop, this, std::ref(workerState));
+	}
+}
+
+AsyncSink::~AsyncSink() {
+	mStop.store(true);
+	mIdleCondition.notify_all();
+	for (auto& worker: mWorkers) {
+		worker.join();
+	}
+}
+
+spdlog::sink_ptr AsyncSink::createModuleRoute(const std::string& moduleName) {
+	Targets targets;
+	for (size_t i=0; i<mSinks.size(); ++i) {
+		if (i >= mModuleFilters.size() || !mModuleFilters[i] || mModuleFilters[i]->matches(moduleName)) {
+			targets.push_back(i);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mRoutesMutex);
+	auto route = std::find(mRoutes.begin(), mRoutes.end(), targets);
+	if (route == mRoutes.end()) {
+		route = mRoutes.insert(mRoutes.end(), std::move(targets));
+	}
+	return std::make_shared<ModuleRoute>(shared_from_this(), *route);
+}
+
+void AsyncSink::log(const spdlog::details::log_msg& msg) {
+	enqueue(msg, nullptr, nullptr);
+}
+
+void AsyncSink::logStructured(const spdlog::details::log_msg& msg, const Structured::Fields& fields) {
+	enqueue(msg, &fields, nullptr);
+}
+
+void AsyncSink::enqueue(const spdlog::details::log_msg& msg, const Structured::Fields* fields, const Targets* targets) {
+
+	spdlog::details::log_msg_buffer msgBuffer(msg);
+	const auto fill = [&msgBuffer, fields, targets](Record& record) {
+		record.mMsg = std::move(msgBuffer);
+		record.mTargets = targets;
+		if (fields) {
+			record.mFields.clear();
+			record.mFields.append(fields->mData, fields->mData + fields->mSize);
+			record.mNumFields = fields->mNumFields;
+		} else {
+			record.mNumFields = 0;
+		}
+	};
+
+	switch (mParameters.mOverflowPolicy) {
+	case OverflowPolicy::BLOCK:
+		while (!mQueue.tryPushWith(fill)) {
+			wakeUpWorker();
+			std::this_thread::yield();
+		}
+		break;
+	case OverflowPolicy::DROP_NEWEST:
+		if (!mQueue.tryPushWith(fill)) {
+			mDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		break;
+	case OverflowPolicy::DROP_OLDEST:
+		while (!mQueue.tryPushWith(fill)) {
+			if (mQueue.tryPopWith([](Record&) {})) {
+				mDropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		break;
+	}
+
+	mEnqueued.fetch_add(1, std::memory_order_relaxed);
+	updateHighWaterMark();
+	wakeUpWorker();
+}
+
+void AsyncSink::updateHighWaterMark() {
+	const size_t size = mQueue.sizeApprox();
+	size_t highWaterMark = mHighWaterMark.load(std::memory_order_relaxed);
+	while (size > highWaterMark
+			&& !mHighWaterMark.compare_exchange_weak(highWaterMark, size, std::memory_order_relaxed)) {
+	}
+}
+
+void AsyncSink::wakeUpWorker() {
+	if (mIdleWorkers.load(std::memory_order_acquire) > 0) {
+		mIdleCondition.notify_one();
+	}
+}
+
+void AsyncSink::workerLoop(WorkerState& workerState) {
+
+	Record record;
+	int spins = 0;
+
+	for (;;) {
+		// Published before popping, so that flush() sees either the position or the pop
+		workerState.mPosition.store(mQueue.popCount(), std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (mQueue.tryPopWith([&record](Record& data) { std::swap(record, data); })) {
+			writeToSinks(record);
+			spins = 0;
+			continue;
+		}
+		workerState.mPosition.store(IDLE, std::memory_order_release);
+
+		if (mStop.load()) {
+			break;
+		}
+
+		if (++spins < WORKER_SPIN_COUNT) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mIdleMutex);
+		mIdleWorkers.fetch_add(1, std::memory_order_acq_rel);
+		mIdleCondition.wait_for(lock, WORKER_IDLE_TIMEOUT, [this]() {
+			return mStop.load() || mQueue.sizeApprox() > 0;
+		});
+		mIdleWorkers.fetch_sub(1, std::memory_order_acq_rel);
+		spins = 0;
+	}
+}
+
+void AsyncSink::writeToSinks(const Record& record) {
+	const spdlog::details::log_msg& msg = record.mMsg;
+	const auto writeToSink = [&msg](const spdlog::sink_ptr& sink, auto&& write) {
+		if (!sink->should_log(msg.level)) {
+			return;
+		}
+		try {
+			write(*sink);
+		} catch (const std::exception& e) {
+			fmt::print(stderr, "[*** LOG ERROR ***] [{}] {}\n", msg.logger_name, e.what());
+		}
+	};
+
+	const auto forEachTarget = [this, &record](auto&& callback) {
+		if (!record.mTargets) {
+			std::for_each(mSinks.begin(), mSinks.end(), callback);
+			return;
+		}
+		for (const size_t target: *record.mTargets) {
+			callback(mSinks[target]);
+		}
+	};
+
+	if (record.mNumFields == 0) {
+		forEachTarget([&writeToSink, &msg](const spdlog::sink_ptr& sink) {
+			writeToSink(sink, [&msg](spdlog::sinks::sink& sink) { sink.log(msg); });
+		});
+		return;
+	}
+
+	const Structured::Fields fields{record.mFields.data(), record.mFields.size(), record.mNumFields};
+	Structured::RecordDispatcher dispatcher(msg, fields);
+	forEachTarget([&writeToSink, &dispatcher](const spdlog::sink_ptr& sink) {
+		writeToSink(sink, [&dispatcher](spdlog::sinks::sink& sink) { dispatcher.dispatch(sink); });
+	});
+}
+
+bool AsyncSink::isWritten(size_t position) const {
+	if (mQueue.popCount() < position) {
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return std::all_of(mWorkerStates.begin(), mWorkerStates.end(), [position](const WorkerState& workerState) {
+		return workerState.mPosition.load(std::memory_order_acquire) >= position;
+	});
+}
+
+void AsyncSink::flush() {
+	// Records logged before are below this queue position. Counting processed records
+	// instead would miss records still being written by another worker.
+	const size_t target = mQueue.pushCount();
+	while (!isWritten(target)) {
+		wakeUpWorker();
+		std::this_thread::sleep_for(FLUSH_POLL_INTERVAL);
+	}
+
+	for (const auto& sink: mSinks) {
+		sink->flush();
+	}
+}
+
+void AsyncSink::set_pattern(const std::string& pattern) {
+	for (const auto& sink: mSinks) {
+		sink->set_pattern(pattern);
+	}
+}
+
+void AsyncSink::set_formatter(std::unique_ptr<spdlog::formatter> formatter) {
+	for (const auto& sink: mSinks) {
+		sink->set_formatter(formatter->clone());
+	}
+}
+
+void AsyncSink::dumpPending(int fd) const noexcept {
+	CrashHandler::write(fd, "--- queued async records ---\n");
+	mQueue.forEachPending([fd](const Record& record) {
+		const spdlog::details::log_msg& msg = record.mMsg;
+		const auto level = spdlog::level::to_string_view(msg.level);
+		CrashHandler::write(fd, "[");
+		CrashHandler::write(fd, msg.logger_name.data(), msg.logger_name.size());
+		CrashHandler::write(fd, "] [");
+		CrashHandler::write(fd, level.data(), level.size());
+		CrashHandler::write(fd, "]: ");
+		CrashHandler::write(fd, msg.payload.data(), msg.payload.size());
+		CrashHandler::write(fd, "\n");
+	});
+
+	for (const auto crashDumpSink: mCrashDumpSinks) {
+		crashDumpSink->dumpPending(fd);
+	}
+}
+
+AsyncSink::Statistics AsyncSink::getStatistics() const {
+	return {
+		mEnqueued.load(std::memory_order_relaxed),
+		mDropped.load(std::memory_order_relaxed),
+		mHighWaterMark.load(std::memory_order_relaxed),
+		mQueue.capacity()
+	};
+}
+
+}
@@ -0,0 +1,139 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "bounded_queue.h"
+#include "crash_handler.h"
+#include "module_rules.h"
+#include "structured.h"
+
+#include <spdlog/sinks/sink.h>
+#include <spdlog/details/log_msg_buffer.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Logging {
+
+class AsyncSink : public spdlog::sinks::sink, public CrashDumpSink, public Structured::StructuredSink,
+		public std::enable_shared_from_this<AsyncSink> {
+
+public:
+
+	enum class OverflowPolicy {
+		BLOCK,
+		DROP_NEWEST,
+		DROP_OLDEST
+	};
+
+	struct Parameters {
+		size_t mQueueSize;
+		OverflowPolicy mOverflowPolicy;
+		// Records are popped in order but written concurrently by the workers. With more
+		// than one worker, records of the same thread may reach a sink out of order.
+		size_t mWorkerThreads;
+	};
+
+	struct Statistics {
+		uint64_t mEnqueuedMessages;
+		uint64_t mDroppedMessages;
+		size_t mQueueHighWaterMark;
+		size_t mQueueCapacity;
+	};
+
+	// moduleFilters is empty or holds one filter per sink, records logged directly go to all sinks
+	AsyncSink(const Parameters&, std::vector<spdlog::sink_ptr> sinks,
+			std::vector<std::shared_ptr<const ModuleFilter>> moduleFilters = {});
+	~AsyncSink() override;
+
+	// Returns a sink that queues the records of a module for the sinks whose filter matches it.
+	// The filters are resolved here once, the workers only look up the matching sinks.
+	spdlog::sink_ptr createModuleRoute(const std::string& moduleName);
+
+	void log(const spdlog::details::log_msg&) override;
+	void logStructured(const spdlog::details::log_msg&, const Structured::Fields&) override;
+	void flush() override;
+	void set_pattern(const std::string&) override;
+	void set_formatter(std::unique_ptr<spdlog::formatter>) override;
+
+	Statistics getStatistics() const;
+
+	void dumpPending(int fd) const noexcept override;
+
+private:
+
+	class ModuleRoute;
+
+	// Indices of the sinks a record is written to
+	using Targets = std::vector<size_t>;
+
+	struct Record {
+		spdlog::details::log_msg_buffer mMsg;
+		// Encoded LOG_KV fields, stored inline in the queue cell like the payload. Larger
+		// fields allocate once, the cell keeps that buffer for the records after them.
+		spdlog::memory_buf_t mFields;
+		uint8_t mNumFields = 0;
+		// All sinks if null
+		const Targets* mTargets = nullptr;
+	};
+
+	static constexpr size_t IDLE = std::numeric_limits<size_t>::max();
+
+	// Lower bound of the queue position a worker pops or writes, IDLE while it holds no record
+	struct alignas(64) WorkerState {
+		std::atomic<size_t> mPosition{IDLE};
+	};
+
+	void enqueue(const spdlog::details::log_msg&, const Structured::Fields*, const Targets*);
+	void updateHighWaterMark();
+	void wakeUpWorker();
+	void workerLoop(WorkerState&);
+	void writeToSinks(const Record&);
+	bool isWritten(size_t position) const;
+
+	const Parameters mParameters;
+	const std::vector<spdlog::sink_ptr> mSinks;
+	const std::vector<std::shared_ptr<const ModuleFilter>> mModuleFilters;
+	std::vector<const CrashDumpSink*> mCrashDumpSinks;
+
+	// Never shrinks, queued records point into it
+	std::mutex mRoutesMutex;
+	std::deque<Targets> mRoutes;
+
+	BoundedQueue<Record> mQueue;
+
+	std::atomic<uint64_t> mEnqueued{0};
+	std::atomic<uint64_t> mDropped{0};
+	std::atomic<size_t> mHighWaterMark{0};
+
+	std::atomic<bool> mStop{false};
+	std::atomic<int> mIdleWorkers{0};
+	std::mutex mIdleMutex;
+	std::condition_variable mIdleCondition;
+	std::vector<WorkerState> mWorkerStates;
+	std::vector<std::thread> mWorkers;
+};
+
+template<class Stream>
+Stream& operator<<(Stream& os, const AsyncSink::OverflowPolicy& overflowPolicy) {
+	switch (overflowPolicy) {
+	case AsyncSink::OverflowPolicy::BLOCK:
+		os << "block";
+		break;
+	case AsyncSink::OverflowPolicy::DROP_NEWEST:
+		os << "dropNewest";
+		break;
+	case AsyncSink::OverflowPolicy::DROP_OLDEST:
+		os << "dropOldest";
+		break;
+	}
+	return os;
+}
+
+}
@@ -0,0 +1,162 @@
+// Copyright (C) 2021 twyleg
+#include "binary_file_sink.h"
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+namespace Logging {
+
+namespace {
+
+constexpr const char* PREFORMATTED_MESSAGE_FORMAT = "{}";
+
+int64_t toNanoseconds(spdlog::log_clock::duration duration) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+}
+
+BinaryFileSink::BinaryFileSink(const boost::filesystem::path& outputDir, const std::string& baseName, size_t segmentSize)
+	: mOutputDir(outputDir),
+	  mBaseName(baseName),
+	  mSegmentSize(segmentSize)
+{
+	boost::filesystem::create_directories(mOutputDir);
+	openSegment(0);
+}
+
+BinaryFileSink::~BinaryFileSink() {
+	closeSegment();
+}
+
+void BinaryFileSink::sink_it_(const spdlog::details::log_msg& msg) {
+	mScratch.resize(Deferred::Detail::Codec<std::string_view>::size({msg.payload.data(), msg.payload.size()}));
+	Deferred::Detail::writeString(mScratch.data(), {msg.payload.data(), msg.payload.size()});
+
+	writeRecord(toNanoseconds(msg.time.time_since_epoch()), msg.thread_id, msg.logger_name,
+			PREFORMATTED_MESSAGE_FORMAT, static_cast<uint8_t>(msg.level), 1, mScratch.data(), mScratch.size());
+}
+
+void BinaryFileSink::logRecord(const Deferred::RecordHeader& header, const char* args) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	writeRecord(toNanoseconds(spdlog::log_clock::duration(header.mTimestamp)), header.mThreadId,
+			header.mLogger->name(), header.mFormat, header.mLevel, header.mNumArgs, args,
+			Deferred::getArgsSize(args, header.mNumArgs));
+}
+
+void BinaryFileSink::flush_() {
+	if (mData && msync(mData, mUsed, MS_ASYNC) != 0) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to sync binary log segment {}", mSegmentPath.string()), errno);
+	}
+}
+
+void BinaryFileSink::writeRecord(int64_t timestamp, uint64_t threadId, const spdlog::string_view_t& moduleName,
+		const char* format, uint8_t level, uint8_t numArgs, const char* args, size_t argsSize) {
+
+	using namespace BinaryLogFormat;
+
+	mModuleKey.assign(moduleName.data(), moduleName.size());
+	auto& module = getDictionaryEntry(mModules, mModuleKey, moduleName);
+	auto& formatEntry = getDictionaryEntry(mFormats, static_cast<const void*>(format), format);
+
+	const auto dictionarySize = [this](const DictionaryEntry& entry) -> size_t {
+		return entry.mWrittenInSegment == mSegmentIndex ? 0 : DICTIONARY_ENTRY_HEADER_SIZE + entry.mValue.size();
+	};
+
+	const size_t recordSize = RECORD_ENTRY_HEADER_SIZE + argsSize;
+	if (mUsed + recordSize + dictionarySize(module) + dictionarySize(formatEntry) > mCapacity) {
+		closeSegment();
+		openSegment(recordSize + dictionarySize(module) + dictionarySize(formatEntry));
+	}
+
+	writeDictionaryEntry(module, EntryType::MODULE);
+	writeDictionaryEntry(formatEntry, EntryType::FORMAT);
+
+	char* dst = mData + mUsed;
+	dst = write(dst, EntryType::RECORD);
+	dst = write(dst, timestamp);
+	dst = write(dst, threadId);
+	dst = write(dst, module.mId);
+	dst = write(dst, formatEntry.mId);
+	dst = write(dst, level);
+	dst = write(dst, numArgs);
+	dst = write(dst, static_cast<uint32_t>(argsSize));
+	std::memcpy(dst, args, argsSize);
+	mUsed += recordSize;
+}
+
+template<class Key>
+BinaryFileSink::DictionaryEntry& BinaryFileSink::getDictionaryEntry(std::unordered_map<Key, DictionaryEntry>& dictionary,
+		const Key& key, const spdlog::string_view_t& value) {
+	auto it = dictionary.find(key);
+	if (it == dictionary.end()) {
+		const auto id = static_cast<uint32_t>(dictionary.size());
+		it = dictionary.emplace(key, DictionaryEntry{id, std::string(value.data(), value.size()), 0}).first;
+	}
+	return it->second;
+}
+
+void BinaryFileSink::writeDictionaryEntry(DictionaryEntry& entry, BinaryLogFormat::EntryType entryType) {
+
+	using namespace BinaryLogFormat;
+
+	if (entry.mWrittenInSegment == mSegmentIndex) {
+		return;
+	}
+
+	char* dst = mData + mUsed;
+	dst = write(dst, entryType);
+	dst = write(dst, entry.mId);
+	dst = write(dst, static_cast<uint32_t>(entry.mValue.size()));
+	std::memcpy(dst, entry.mValue.data(), entry.mValue.size());
+	mUsed += DICTIONARY_ENTRY_HEADER_SIZE + entry.mValue.size();
+	entry.mWrittenInSegment = mSegmentIndex;
+}
+
+void BinaryFileSink::openSegment(size_t minSize) {
+
+	++mSegmentIndex;
+	mSegmentPath = mOutputDir / fmt::format("{}.{:05}{}", mBaseName, mSegmentIndex, BinaryLogFormat::FILE_EXTENSION);
+	mCapacity = std::max(mSegmentSize, minSize + sizeof(BinaryLogFormat::MAGIC));
+
+	mFd = ::open(mSegmentPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (mFd < 0) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to open binary log segment {}", mSegmentPath.string()), errno);
+	}
+
+	if (posix_fallocate(mFd, 0, static_cast<off_t>(mCapacity)) != 0 && ftruncate(mFd, static_cast<off_t>(mCapacity)) != 0) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to preallocate binary log segment {}", mSegmentPath.string()), errno);
+	}
+
+	void* data = mmap(nullptr, mCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+	if (data == MAP_FAILED) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to map binary log segment {}", mSegmentPath.string()), errno);
+	}
+	mData = static_cast<char*>(data);
+
+	std::memcpy(mData, BinaryLogFormat::MAGIC, sizeof(BinaryLogFormat::MAGIC));
+	mUsed = sizeof(BinaryLogFormat::MAGIC);
+}
+
+void BinaryFileSink::closeSegment() {
+	if (mData) {
+		munmap(mData, mCapacity);
+		mData = nullptr;
+	}
+	if (mFd >= 0) {
+		// On failure the zeroed tail stays in place, readers stop at the first END entry
+		const int result = ftruncate(mFd, static_cast<off_t>(mUsed));
+		(void) result;
+		::close(mFd);
+		mFd = -1;
+	}
+}
+
+}
@@ -0,0 +1,71 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "binary_log_format.h"
+#include "deferred.h"
+
+#include <spdlog/sinks/base_sink.h>
+
+#include <boost/filesystem.hpp>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Logging {
+
+class BinaryFileSink : public spdlog::sinks::base_sink<std::mutex>, public Deferred::RecordSink {
+
+public:
+
+	BinaryFileSink(const boost::filesystem::path& outputDir, const std::string& baseName, size_t segmentSize);
+	~BinaryFileSink() override;
+
+	void logRecord(const Deferred::RecordHeader&, const char* args) override;
+
+	const boost::filesystem::path& getCurrentSegmentPath() const { return mSegmentPath; }
+
+protected:
+
+	void sink_it_(const spdlog::details::log_msg&) override;
+	void flush_() override;
+
+private:
+
+	struct DictionaryEntry {
+		uint32_t mId;
+		std::string mValue;
+		size_t mWrittenInSegment;
+	};
+
+	void writeRecord(int64_t timestamp, uint64_t threadId, const spdlog::string_view_t& moduleName,
+			const char* format, uint8_t level, uint8_t numArgs, const char* args, size_t argsSize);
+	template<class Key>
+	DictionaryEntry& getDictionaryEntry(std::unordered_map<Key, DictionaryEntry>&, const Key& key,
+			const spdlog::string_view_t& value);
+	void writeDictionaryEntry(DictionaryEntry&, BinaryLogFormat::EntryType);
+
+	void openSegment(size_t minSize);
+	void closeSegment();
+
+	const boost::filesystem::path mOutputDir;
+	const std::string mBaseName;
+	const size_t mSegmentSize;
+
+	boost::filesystem::path mSegmentPath;
+	size_t mSegmentIndex = 0;
+	int mFd = -1;
+	char* mData = nullptr;
+	size_t mCapacity = 0;
+	size_t mUsed = 0;
+
+	// Module names may be freed and their memory reused by other modules, unlike the
+	// format strings of the LOG macros
+	std::unordered_map<std::string, DictionaryEntry> mModules;
+	std::unordered_map<const void*, DictionaryEntry> mFormats;
+	std::string mModuleKey;
+	std::vector<char> mScratch;
+};
+
+}
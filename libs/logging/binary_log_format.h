@@ -0,0 +1,45 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace Logging::BinaryLogFormat {
+
+// Segment layout: MAGIC followed by a sequence of entries. Every entry starts
+// with its EntryType. Module and format dictionaries are repeated in every
+// segment before their first use, so each segment can be decoded on its own.
+//
+//   MODULE: uint32 moduleId, uint32 length, char[length] name
+//   FORMAT: uint32 formatId, uint32 length, char[length] format
+//   RECORD: int64 timestamp (ns since epoch), uint64 threadId, uint32 moduleId,
+//           uint32 formatId, uint8 level, uint8 numArgs, uint32 argsSize,
+//           char[argsSize] args (Logging::Deferred argument encoding)
+
+constexpr char MAGIC[8] = {'L', 'O', 'G', 'B', 'I', 'N', '\0', '\1'};
+constexpr const char* FILE_EXTENSION = ".binlog";
+
+enum class EntryType : uint8_t {
+	END = 0,
+	MODULE = 1,
+	FORMAT = 2,
+	RECORD = 3
+};
+
+constexpr size_t DICTIONARY_ENTRY_HEADER_SIZE = sizeof(EntryType) + 2 * sizeof(uint32_t);
+constexpr size_t RECORD_ENTRY_HEADER_SIZE = sizeof(EntryType) + sizeof(int64_t) + sizeof(uint64_t)
+		+ 2 * sizeof(uint32_t) + 2 * sizeof(uint8_t) + sizeof(uint32_t);
+
+template<class T>
+inline char* write(char* dst, const T& value) {
+	std::memcpy(dst, &value, sizeof(T));
+	return dst + sizeof(T);
+}
+
+template<class T>
+inline const char* read(const char* src, T& value) {
+	std::memcpy(&value, src, sizeof(T));
+	return src + sizeof(T);
+}
+
+}
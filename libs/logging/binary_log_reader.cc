@@ -0,0 +1,99 @@
+// Copyright (C) 2021 twyleg
+#include "binary_log_reader.h"
+#include "binary_log_format.h"
+#include "deferred.h"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Logging {
+
+void BinaryLogReader::readSegment(const boost::filesystem::path& segmentPath, const RecordCallback& callback) {
+
+	using namespace BinaryLogFormat;
+
+	std::ifstream ifs(segmentPath.string(), std::ios::binary);
+	if (!ifs) {
+		throw std::runtime_error(fmt::format("Unable to open binary log segment \"{}\"", segmentPath.string()));
+	}
+	const std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+		throw std::runtime_error(fmt::format("\"{}\" is not a binary log segment", segmentPath.string()));
+	}
+
+	std::unordered_map<uint32_t, std::string> modules;
+	std::unordered_map<uint32_t, std::string> formats;
+	spdlog::memory_buf_t formatted;
+
+	const char* pos = data.data() + sizeof(MAGIC);
+	const char* end = data.data() + data.size();
+
+	while (pos < end) {
+		EntryType entryType;
+		read(pos, entryType);
+
+		if (entryType == EntryType::MODULE || entryType == EntryType::FORMAT) {
+			if (static_cast<size_t>(end - pos) < DICTIONARY_ENTRY_HEADER_SIZE) {
+				break;
+			}
+			uint32_t id;
+			uint32_t length;
+			const char* src = read(read(pos + sizeof(EntryType), id), length);
+			if (static_cast<size_t>(end - src) < length) {
+				break;
+			}
+			auto& dictionary = entryType == EntryType::MODULE ? modules : formats;
+			dictionary[id] = std::string(src, length);
+			pos = src + length;
+
+		} else if (entryType == EntryType::RECORD) {
+			if (static_cast<size_t>(end - pos) < RECORD_ENTRY_HEADER_SIZE) {
+				break;
+			}
+			int64_t timestamp;
+			uint64_t threadId;
+			uint32_t moduleId;
+			uint32_t formatId;
+			uint8_t level;
+			uint8_t numArgs;
+			uint32_t argsSize;
+			const char* src = pos + sizeof(EntryType);
+			src = read(src, timestamp);
+			src = read(src, threadId);
+			src = read(src, moduleId);
+			src = read(src, formatId);
+			src = read(src, level);
+			src = read(src, numArgs);
+			src = read(src, argsSize);
+			if (static_cast<size_t>(end - src) < argsSize) {
+				break;
+			}
+
+			formatted.clear();
+			Deferred::formatArgs(formats[formatId].c_str(), src, numArgs, formatted);
+
+			const std::string& moduleName = modules[moduleId];
+			spdlog::details::log_msg msg(moduleName, static_cast<spdlog::level::level_enum>(level),
+					spdlog::string_view_t(formatted.data(), formatted.size()));
+			msg.time = spdlog::log_clock::time_point(std::chrono::duration_cast<spdlog::log_clock::duration>(
+					std::chrono::nanoseconds(timestamp)));
+			msg.thread_id = threadId;
+			callback(msg);
+
+			pos = src + argsSize;
+
+		} else {
+			break;
+		}
+	}
+}
+
+}
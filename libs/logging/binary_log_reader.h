@@ -0,0 +1,21 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <spdlog/details/log_msg.h>
+
+#include <boost/filesystem.hpp>
+
+#include <functional>
+
+namespace Logging {
+
+class BinaryLogReader {
+
+public:
+
+	using RecordCallback = std::function<void(const spdlog::details::log_msg&)>;
+
+	static void readSegment(const boost::filesystem::path&, const RecordCallback&);
+};
+
+}
@@ -0,0 +1,140 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace Logging {
+
+// Bounded lock-free MPMC queue (Vyukov). Capacity is rounded up to a power of two.
+template<class T>
+class BoundedQueue {
+
+public:
+
+	explicit BoundedQueue(size_t capacity)
+		: mCapacity(roundUpToPowerOfTwo(capacity)),
+		  mMask(mCapacity - 1),
+		  mCells(new Cell[mCapacity])
+	{
+		for (size_t i=0; i<mCapacity; ++i) {
+			mCells[i].mSequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	template<class U>
+	bool tryPush(U&& item) {
+		return tryPushWith([&item](T& data) {
+			data = std::forward<U>(item);
+		});
+	}
+
+	bool tryPop(T& item) {
+		return tryPopWith([&item](T& data) {
+			item = std::move(data);
+		});
+	}
+
+	// In-place variants: fill(T&) and consume(T&) work on the cell's object directly, so
+	// buffers it owns can be reused by the next item instead of being reallocated.
+	template<class Fill>
+	bool tryPushWith(Fill&& fill) {
+		Cell* cell;
+		size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+		for (;;) {
+			cell = &mCells[pos & mMask];
+			const size_t sequence = cell->mSequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+			if (diff == 0) {
+				if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = mEnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		fill(cell->mData);
+		cell->mSequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	template<class Consume>
+	bool tryPopWith(Consume&& consume) {
+		Cell* cell;
+		size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+		for (;;) {
+			cell = &mCells[pos & mMask];
+			const size_t sequence = cell->mSequence.load(std::memory_order_acquire);
+			const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+			if (diff == 0) {
+				if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = mDequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+		consume(cell->mData);
+		cell->mSequence.store(pos + mMask + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Visits pushed but not yet popped items without removing them. Best effort only,
+	// meant for inspection from a crash handler while consumers may still be running.
+	template<class Callback>
+	void forEachPending(Callback&& callback) const {
+		const size_t end = mEnqueuePos.load(std::memory_order_acquire);
+		for (size_t pos=mDequeuePos.load(std::memory_order_acquire); pos<end; ++pos) {
+			const Cell& cell = mCells[pos & mMask];
+			if (cell.mSequence.load(std::memory_order_acquire) == pos + 1) {
+				callback(cell.mData);
+			}
+		}
+	}
+
+	size_t capacity() const { return mCapacity; }
+
+	// Positions claimed by pushes and pops so far. Items are popped in push order, so all
+	// items pushed before pushCount() returned n are gone once popCount() reaches n.
+	size_t pushCount() const { return mEnqueuePos.load(std::memory_order_relaxed); }
+	size_t popCount() const { return mDequeuePos.load(std::memory_order_relaxed); }
+
+	size_t sizeApprox() const {
+		const size_t enqueuePos = mEnqueuePos.load(std::memory_order_relaxed);
+		const size_t dequeuePos = mDequeuePos.load(std::memory_order_relaxed);
+		return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+	}
+
+private:
+
+	static size_t roundUpToPowerOfTwo(size_t value) {
+		size_t result = 2;
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	struct Cell {
+		std::atomic<size_t> mSequence;
+		T mData;
+	};
+
+	const size_t mCapacity;
+	const size_t mMask;
+	std::unique_ptr<Cell[]> mCells;
+
+	alignas(64) std::atomic<size_t> mEnqueuePos{0};
+	alignas(64) std::atomic<size_t> mDequeuePos{0};
+};
+
+}
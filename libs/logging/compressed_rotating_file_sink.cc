@@ -0,0 +1,365 @@
+// Copyright (C) 2021 twyleg
+#include "compressed_rotating_file_sink.h"
+
+#include <fmt/format.h>
+
+#include <zlib.h>
+#ifdef LOGGING_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Logging {
+
+namespace {
+
+#ifdef LOGGING_WITH_ZSTD
+constexpr bool ZSTD_AVAILABLE = true;
+#else
+constexpr bool ZSTD_AVAILABLE = false;
+#endif
+
+constexpr size_t COMPRESS_BLOCK_SIZE = 128 * 1024;
+constexpr int COMPRESS_THREAD_NICE_VALUE = 19;
+
+const char* compressedExtension(CompressedRotatingFileSink::Compression compression) {
+	return compression == CompressedRotatingFileSink::Compression::ZSTD ? ".zst" : ".gz";
+}
+
+boost::filesystem::path segmentPath(const boost::filesystem::path& filePath, uint64_t sequence) {
+	return filePath.parent_path() / fmt::format("{}.{:06}{}", filePath.stem().string(), sequence, filePath.extension().string());
+}
+
+int openSegment(const boost::filesystem::path& segmentPath) {
+	const int fd = ::open(segmentPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to open log file {}", segmentPath.string()), errno);
+	}
+	return fd;
+}
+
+std::ifstream openInput(const boost::filesystem::path& source) {
+	std::ifstream input(source.string(), std::ios::binary);
+	if (!input) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to open log file {}", source.string()));
+	}
+	return input;
+}
+
+void compressGzip(const boost::filesystem::path& source, const boost::filesystem::path& target, int level) {
+	auto input = openInput(source);
+	gzFile output = ::gzopen(target.c_str(), fmt::format("wb{}", std::clamp(level, 1, 9)).c_str());
+	if (!output) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to open compressed log file {}", target.string()), errno);
+	}
+
+	std::vector<char> buffer(COMPRESS_BLOCK_SIZE);
+	bool failed = false;
+	while (!failed && (input.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || input.gcount() > 0)) {
+		failed = ::gzwrite(output, buffer.data(), static_cast<unsigned>(input.gcount())) <= 0;
+	}
+	if (::gzclose(output) != Z_OK || failed) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to write compressed log file {}", target.string()));
+	}
+}
+
+#ifdef LOGGING_WITH_ZSTD
+void compressZstd(const boost::filesystem::path& source, const boost::filesystem::path& target, int level) {
+	auto input = openInput(source);
+	std::ofstream output(target.string(), std::ios::binary | std::ios::trunc);
+	if (!output) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to open compressed log file {}", target.string()));
+	}
+
+	std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context(ZSTD_createCCtx(), &ZSTD_freeCCtx);
+	ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, level);
+
+	std::vector<char> inputBuffer(ZSTD_CStreamInSize());
+	std::vector<char> outputBuffer(ZSTD_CStreamOutSize());
+	bool lastBlock = false;
+	while (!lastBlock) {
+		input.read(inputBuffer.data(), static_cast<std::streamsize>(inputBuffer.size()));
+		lastBlock = !input;
+
+		ZSTD_inBuffer in{inputBuffer.data(), static_cast<size_t>(input.gcount()), 0};
+		const auto mode = lastBlock ? ZSTD_e_end : ZSTD_e_continue;
+		bool blockDone = false;
+		while (!blockDone) {
+			ZSTD_outBuffer out{outputBuffer.data(), outputBuffer.size(), 0};
+			const size_t remaining = ZSTD_compressStream2(context.get(), &out, &in, mode);
+			if (ZSTD_isError(remaining)) {
+				throw spdlog::spdlog_ex(fmt::format("Failed to compress log file {}: {}", source.string(),
+						ZSTD_getErrorName(remaining)));
+			}
+			output.write(outputBuffer.data(), static_cast<std::streamsize>(out.pos));
+			blockDone = lastBlock ? remaining == 0 : in.pos == in.size;
+		}
+	}
+
+	output.close();
+	if (!output) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to write compressed log file {}", target.string()));
+	}
+}
+#endif
+
+}
+
+CompressedRotatingFileSink::CompressedRotatingFileSink(const boost::filesystem::path& filePath, const Parameters& parameters,
+		const FlushPolicy& flushPolicy, const LogIndexWriter::Policy& indexPolicy)
+	: CompressedRotatingFileSink(filePath, acquireSegments(filePath), parameters, flushPolicy, indexPolicy)
+{}
+
+CompressedRotatingFileSink::CompressedRotatingFileSink(const boost::filesystem::path& filePath, Segments&& segments,
+		const Parameters& parameters, const FlushPolicy& flushPolicy, const LogIndexWriter::Policy& indexPolicy)
+	: VectoredFileSink(segmentPath(filePath, segments.mNextSequence), true, flushPolicy, parameters.mMaxFileSize, 0, indexPolicy),
+	  mBasePath(filePath),
+	  mParameters(parameters),
+	  mShared(std::move(segments.mShared)),
+	  mFinishedSegments(segments.mUncompressed.begin(), segments.mUncompressed.end()),
+	  mNextSequence(allocateSequence()),
+	  mCompressedSegments(segments.mCompressed.begin(), segments.mCompressed.end())
+{
+	if (!isSupported(mParameters.mCompression)) {
+		throw spdlog::spdlog_ex("Log file compression with zstd is not available");
+	}
+
+	for (const auto& segment: mCompressedSegments) {
+		mCompressedSize += segment.second;
+	}
+	mCompressThread = std::thread(&CompressedRotatingFileSink::compressLoop, this);
+}
+
+CompressedRotatingFileSink::~CompressedRotatingFileSink() {
+	{
+		std::lock_guard<std::mutex> lock(mCompressMutex);
+		mStopCompression = true;
+		mPreopen = false;
+	}
+	mCompressCondition.notify_all();
+	mCompressThread.join();
+
+	if (mNextFd >= 0) {
+		::close(mNextFd);
+		boost::system::error_code ec;
+		boost::filesystem::remove(segmentPath(mBasePath, mNextSequence), ec);
+	}
+
+	// A live instance compresses the last segment on its next rotation, the next scan otherwise
+	close();
+	std::lock_guard<std::mutex> lock(mShared->mMutex);
+	mShared->mOrphaned.push_back(getFilePath());
+}
+
+bool CompressedRotatingFileSink::isSupported(Compression compression) {
+	return compression == Compression::GZIP || ZSTD_AVAILABLE;
+}
+
+int CompressedRotatingFileSink::defaultLevel(Compression compression) {
+	return compression == Compression::ZSTD ? 3 : 6;
+}
+
+void CompressedRotatingFileSink::waitForCompression() {
+	std::unique_lock<std::mutex> lock(mCompressMutex);
+	mCompressCondition.wait(lock, [this]() { return mFinishedSegments.empty() && !mCompressing; });
+}
+
+void CompressedRotatingFileSink::rotate() {
+	boost::filesystem::path nextPath;
+	int nextFd;
+	{
+		std::lock_guard<std::mutex> lock(mCompressMutex);
+		nextPath = segmentPath(mBasePath, mNextSequence);
+		mNextSequence = allocateSequence();
+		nextFd = std::exchange(mNextFd, -1);
+		mPreopen = true;
+	}
+	if (nextFd < 0) {
+		nextFd = openSegment(nextPath);
+	}
+
+	auto finishedSegment = swapFile(nextFd, nextPath);
+	{
+		std::lock_guard<std::mutex> lock(mCompressMutex);
+		mFinishedSegments.push_back(std::move(finishedSegment));
+		takeOrphanedSegments();
+	}
+	mCompressCondition.notify_all();
+}
+
+CompressedRotatingFileSink::Segments CompressedRotatingFileSink::acquireSegments(const boost::filesystem::path& filePath) {
+	static std::mutex registryMutex;
+	static std::unordered_map<std::string, std::weak_ptr<SharedSegments>> registry;
+
+	std::lock_guard<std::mutex> registryLock(registryMutex);
+	auto& registeredSegments = registry[boost::filesystem::absolute(filePath).lexically_normal().string()];
+	auto shared = registeredSegments.lock();
+	// Uncompressed segments belong to the live instance, if there is one
+	auto segments = findSegments(filePath, !shared);
+	if (!shared) {
+		shared = std::make_shared<SharedSegments>();
+		shared->mNextSequence = segments.mNextSequence;
+		registeredSegments = shared;
+	}
+
+	std::lock_guard<std::mutex> lock(shared->mMutex);
+	std::move(shared->mOrphaned.begin(), shared->mOrphaned.end(), std::back_inserter(segments.mUncompressed));
+	shared->mOrphaned.clear();
+	segments.mNextSequence = shared->mNextSequence++;
+	segments.mShared = std::move(shared);
+	return segments;
+}
+
+CompressedRotatingFileSink::Segments CompressedRotatingFileSink::findSegments(const boost::filesystem::path& filePath,
+		bool exclusive) {
+	Segments segments;
+	const auto directory = filePath.has_parent_path() ? filePath.parent_path() : boost::filesystem::path(".");
+	if (!boost::filesystem::is_directory(directory)) {
+		return segments;
+	}
+
+	const auto prefix = filePath.stem().string() + ".";
+	const auto extension = filePath.extension().string();
+	std::vector<std::pair<uint64_t, boost::filesystem::path>> uncompressed;
+	std::vector<std::pair<uint64_t, CompressedSegment>> compressed;
+
+	for (const auto& entry: boost::filesystem::directory_iterator(directory)) {
+		const auto fileName = entry.path().filename().string();
+		if (fileName.size() <= prefix.size() || fileName.compare(0, prefix.size(), prefix) != 0
+				|| !std::isdigit(static_cast<unsigned char>(fileName[prefix.size()]))) {
+			continue;
+		}
+
+		char* suffix = nullptr;
+		const uint64_t sequence = std::strtoull(fileName.c_str() + prefix.size(), &suffix, 10);
+		if (suffix == extension && exclusive) {
+			uncompressed.emplace_back(sequence, entry.path());
+		} else if (suffix == extension + ".gz" || suffix == extension + ".zst") {
+			compressed.emplace_back(sequence, CompressedSegment(entry.path(), boost::filesystem::file_size(entry.path())));
+		} else if (exclusive && (suffix == extension + ".gz.tmp" || suffix == extension + ".zst.tmp")) {
+			boost::system::error_code ec;
+			boost::filesystem::remove(entry.path(), ec);
+			continue;
+		} else {
+			continue;
+		}
+		segments.mNextSequence = std::max(segments.mNextSequence, sequence + 1);
+	}
+
+	std::sort(uncompressed.begin(), uncompressed.end());
+	std::sort(compressed.begin(), compressed.end());
+	for (auto& segment: uncompressed) {
+		segments.mUncompressed.push_back(std::move(segment.second));
+	}
+	for (auto& segment: compressed) {
+		segments.mCompressed.push_back(std::move(segment.second));
+	}
+	return segments;
+}
+
+uint64_t CompressedRotatingFileSink::allocateSequence() {
+	std::lock_guard<std::mutex> lock(mShared->mMutex);
+	return mShared->mNextSequence++;
+}
+
+void CompressedRotatingFileSink::takeOrphanedSegments() {
+	std::lock_guard<std::mutex> lock(mShared->mMutex);
+	std::move(mShared->mOrphaned.begin(), mShared->mOrphaned.end(), std::back_inserter(mFinishedSegments));
+	mShared->mOrphaned.clear();
+}
+
+void CompressedRotatingFileSink::compressLoop() {
+	// Linux applies the nice value to the calling thread only
+	::setpriority(PRIO_PROCESS, static_cast<id_t>(::syscall(SYS_gettid)), COMPRESS_THREAD_NICE_VALUE);
+	removeExpiredSegments();
+
+	std::unique_lock<std::mutex> lock(mCompressMutex);
+	for (;;) {
+		mCompressCondition.wait(lock, [this]() { return mPreopen || !mFinishedSegments.empty() || mStopCompression; });
+
+		if (mPreopen) {
+			mPreopen = false;
+			try {
+				mNextFd = openSegment(segmentPath(mBasePath, mNextSequence));
+			} catch (const spdlog::spdlog_ex& e) {
+				fmt::print(stderr, "[*** LOG ERROR ***] {}\n", e.what());
+			}
+		} else if (!mFinishedSegments.empty()) {
+			const auto segment = std::move(mFinishedSegments.front());
+			mFinishedSegments.pop_front();
+			mCompressing = true;
+
+			lock.unlock();
+			compress(segment);
+			removeExpiredSegments();
+			lock.lock();
+
+			mCompressing = false;
+			mCompressCondition.notify_all();
+		} else {
+			break;
+		}
+	}
+}
+
+void CompressedRotatingFileSink::compress(const boost::filesystem::path& segment) {
+	const boost::filesystem::path target = segment.string() + compressedExtension(mParameters.mCompression);
+	const boost::filesystem::path temporary = target.string() + ".tmp";
+
+	try {
+		if (boost::filesystem::file_size(segment) > 0) {
+#ifdef LOGGING_WITH_ZSTD
+			if (mParameters.mCompression == Compression::ZSTD) {
+				compressZstd(segment, temporary, mParameters.mLevel);
+			} else
+#endif
+			{
+				compressGzip(segment, temporary, mParameters.mLevel);
+			}
+			boost::filesystem::rename(temporary, target);
+
+			const auto compressedSize = boost::filesystem::file_size(target);
+			mCompressedSegments.emplace_back(target, compressedSize);
+			mCompressedSize += compressedSize;
+		}
+		boost::filesystem::remove(segment);
+		if (!boost::filesystem::exists(target)) {
+			boost::filesystem::remove(LogIndex::indexPath(segment));
+		}
+	} catch (const std::exception& e) {
+		fmt::print(stderr, "[*** LOG ERROR ***] Failed to compress {}: {}\n", segment.string(), e.what());
+		boost::system::error_code ec;
+		boost::filesystem::remove(temporary, ec);
+	}
+}
+
+void CompressedRotatingFileSink::removeExpiredSegments() {
+	if (!mParameters.mMaxTotalSize) {
+		return;
+	}
+
+	while (mCompressedSize > mParameters.mMaxTotalSize && !mCompressedSegments.empty()) {
+		boost::system::error_code ec;
+		const auto& segment = mCompressedSegments.front().first;
+		boost::filesystem::remove(segment, ec);
+		boost::filesystem::remove(LogIndex::indexPath(boost::filesystem::path(segment).replace_extension()), ec);
+		mCompressedSize -= mCompressedSegments.front().second;
+		mCompressedSegments.pop_front();
+	}
+}
+
+}
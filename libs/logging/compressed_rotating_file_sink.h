@@ -0,0 +1,105 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "vectored_file_sink.h"
+
+#include <boost/filesystem.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Logging {
+
+// Rotating file sink that writes numbered segments ("name.000042.log") and compresses
+// each finished segment on a low priority background thread. Rotation only swaps to
+// the segment the background thread has opened in advance. The oldest compressed
+// segments are removed once all of them together exceed mMaxTotalSize bytes.
+// The segment that is active on destruction is compressed by the next instance. Instances
+// writing the same file share their sequence numbers, so the instance a config reload
+// creates leaves the segments of the one it replaces alone and takes over its last one.
+// Index files keep the name of the uncompressed segment and its offsets.
+class CompressedRotatingFileSink : public VectoredFileSink {
+
+public:
+
+	enum class Compression {
+		GZIP,
+		ZSTD
+	};
+
+	struct Parameters {
+		Compression mCompression;
+		int mLevel;
+		size_t mMaxFileSize;
+		size_t mMaxTotalSize;
+	};
+
+	CompressedRotatingFileSink(const boost::filesystem::path& filePath, const Parameters&,
+			const FlushPolicy& = DEFAULT_FLUSH_POLICY, const LogIndexWriter::Policy& = LogIndexWriter::DISABLED);
+	~CompressedRotatingFileSink() override;
+
+	static bool isSupported(Compression);
+	static int defaultLevel(Compression);
+
+	// Blocks until all finished segments are compressed
+	void waitForCompression();
+
+protected:
+
+	void rotate() override;
+
+private:
+
+	using CompressedSegment = std::pair<boost::filesystem::path, uintmax_t>;
+
+	struct SharedSegments {
+		std::mutex mMutex;
+		uint64_t mNextSequence = 0;
+		// Last segments of destroyed instances, compressed by a live one on its next rotation
+		std::vector<boost::filesystem::path> mOrphaned;
+	};
+
+	struct Segments {
+		uint64_t mNextSequence = 0;
+		std::vector<boost::filesystem::path> mUncompressed;
+		std::vector<CompressedSegment> mCompressed;
+		std::shared_ptr<SharedSegments> mShared;
+	};
+
+	CompressedRotatingFileSink(const boost::filesystem::path& filePath, Segments&&, const Parameters&, const FlushPolicy&,
+			const LogIndexWriter::Policy&);
+
+	static Segments acquireSegments(const boost::filesystem::path& filePath);
+	static Segments findSegments(const boost::filesystem::path& filePath, bool exclusive);
+	uint64_t allocateSequence();
+	void takeOrphanedSegments();
+	void compressLoop();
+	void compress(const boost::filesystem::path& segment);
+	void removeExpiredSegments();
+
+	const boost::filesystem::path mBasePath;
+	const Parameters mParameters;
+	const std::shared_ptr<SharedSegments> mShared;
+
+	std::mutex mCompressMutex;
+	std::condition_variable mCompressCondition;
+	std::deque<boost::filesystem::path> mFinishedSegments;
+	uint64_t mNextSequence;
+	int mNextFd = -1;
+	bool mPreopen = true;
+	bool mCompressing = false;
+	bool mStopCompression = false;
+
+	std::deque<CompressedSegment> mCompressedSegments;
+	uintmax_t mCompressedSize = 0;
+
+	std::thread mCompressThread;
+};
+
+}
@@ -0,0 +1,111 @@
+// Copyright (C) 2021 twyleg
+#include "config_watcher.h"
+
+#include <spdlog/common.h>
+
+#include <fmt/format.h>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace Logging {
+
+namespace {
+
+// Further events within this period are coalesced, editors often write in several steps
+constexpr int SETTLE_TIME_MS = 50;
+constexpr size_t EVENT_BUFFER_SIZE = 4096;
+
+}
+
+ConfigWatcher::ConfigWatcher(const boost::filesystem::path& filePath, Callback callback)
+	: mFilePath(boost::filesystem::absolute(filePath)),
+	  mCallback(std::move(callback))
+{
+	mInotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (mInotifyFd < 0) {
+		throw spdlog::spdlog_ex(fmt::format("Unable to initialize inotify: {}", std::strerror(errno)));
+	}
+
+	const auto directory = mFilePath.parent_path();
+	if (::inotify_add_watch(mInotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+		const int error = errno;
+		::close(mInotifyFd);
+		throw spdlog::spdlog_ex(fmt::format("Unable to watch \"{}\": {}", directory.string(), std::strerror(error)));
+	}
+
+	mWakeupFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (mWakeupFd < 0) {
+		const int error = errno;
+		::close(mInotifyFd);
+		throw spdlog::spdlog_ex(fmt::format("Unable to create eventfd: {}", std::strerror(error)));
+	}
+
+	mThread = std::thread(&ConfigWatcher::run, this);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+	const uint64_t value = 1;
+	if (::write(mWakeupFd, &value, sizeof(value)) != sizeof(value)) {
+		fmt::print(stderr, "[*** LOG ERROR ***] Unable to stop config watcher: {}\n", std::strerror(errno));
+	}
+	mThread.join();
+	::close(mWakeupFd);
+	::close(mInotifyFd);
+}
+
+void ConfigWatcher::run() {
+	for (;;) {
+		pollfd fds[2] = {
+			{mInotifyFd, POLLIN, 0},
+			{mWakeupFd, POLLIN, 0}
+		};
+		if (::poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fmt::print(stderr, "[*** LOG ERROR ***] Config watcher stopped: {}\n", std::strerror(errno));
+			return;
+		}
+		if (fds[1].revents) {
+			return;
+		}
+
+		if (!waitForChange(0)) {
+			continue;
+		}
+		while (waitForChange(SETTLE_TIME_MS)) {}
+		mCallback();
+	}
+}
+
+bool ConfigWatcher::waitForChange(int timeoutMs) {
+	pollfd fd{mInotifyFd, POLLIN, 0};
+	if (timeoutMs > 0 && ::poll(&fd, 1, timeoutMs) <= 0) {
+		return false;
+	}
+
+	alignas(inotify_event) char buffer[EVENT_BUFFER_SIZE];
+	bool changed = false;
+	for (;;) {
+		const ssize_t size = ::read(mInotifyFd, buffer, sizeof(buffer));
+		if (size <= 0) {
+			break;
+		}
+		for (ssize_t offset=0; offset<size;) {
+			const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			if (event->len && mFilePath.filename() == event->name) {
+				changed = true;
+			}
+			offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+		}
+	}
+	return changed;
+}
+
+}
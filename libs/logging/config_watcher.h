@@ -0,0 +1,39 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <boost/filesystem.hpp>
+
+#include <functional>
+#include <thread>
+
+namespace Logging {
+
+// Calls the callback from a background thread whenever the file was written or
+// replaced. The parent directory is watched with inotify, so editors that save by
+// renaming a temporary file are covered as well.
+class ConfigWatcher {
+
+public:
+
+	using Callback = std::function<void()>;
+
+	ConfigWatcher(const boost::filesystem::path& filePath, Callback callback);
+	~ConfigWatcher();
+
+	ConfigWatcher(const ConfigWatcher&) = delete;
+	ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+private:
+
+	void run();
+	bool waitForChange(int timeoutMs);
+
+	const boost::filesystem::path mFilePath;
+	const Callback mCallback;
+
+	int mInotifyFd = -1;
+	int mWakeupFd = -1;
+	std::thread mThread;
+};
+
+}
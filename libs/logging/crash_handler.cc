@@ -0,0 +1,205 @@
+// Copyright (C) 2021 twyleg
+#include "crash_handler.h"
+
+#include <fmt/format.h>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace Logging::CrashHandler {
+
+namespace {
+
+constexpr size_t MAX_SINKS = 64;
+constexpr size_t ALTERNATE_STACK_SIZE = 64 * 1024;
+constexpr std::array<int, 5> FATAL_SIGNALS{SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL};
+
+std::mutex registryMutex;
+std::array<std::atomic<const CrashDumpSink*>, MAX_SINKS> sinks{};
+
+std::atomic<int> dumpFd{-1};
+std::atomic<bool> handling{false};
+struct sigaction previousActions[FATAL_SIGNALS.size()];
+
+// Keeps the calling thread's alternate signal stack until the thread exits. A stack the
+// application set up itself is left in place. It is set up on the first log call of a
+// thread, so it is mapped directly instead of allocated and must not throw.
+class AlternateStack {
+
+public:
+
+	AlternateStack() noexcept {
+		stack_t currentStack{};
+		if (::sigaltstack(nullptr, &currentStack) == 0 && !(currentStack.ss_flags & SS_DISABLE)) {
+			return;
+		}
+
+		void* memory = ::mmap(nullptr, ALTERNATE_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+		if (memory == MAP_FAILED) {
+			mError = errno;
+			return;
+		}
+
+		stack_t stack{};
+		stack.ss_sp = memory;
+		stack.ss_size = ALTERNATE_STACK_SIZE;
+		if (::sigaltstack(&stack, nullptr) != 0) {
+			mError = errno;
+			::munmap(memory, ALTERNATE_STACK_SIZE);
+			return;
+		}
+		mStack = memory;
+	}
+
+	AlternateStack(const AlternateStack&) = delete;
+	AlternateStack& operator=(const AlternateStack&) = delete;
+
+	~AlternateStack() {
+		if (mStack) {
+			stack_t stack{};
+			stack.ss_flags = SS_DISABLE;
+			::sigaltstack(&stack, nullptr);
+			::munmap(mStack, ALTERNATE_STACK_SIZE);
+		}
+	}
+
+	int error() const { return mError; }
+
+private:
+
+	void* mStack = nullptr;
+	int mError = 0;
+};
+
+const AlternateStack& localAlternateStack() {
+	thread_local AlternateStack alternateStack;
+	return alternateStack;
+}
+
+void writeDecimal(int fd, int value) noexcept {
+	char digits[16];
+	size_t pos = sizeof(digits);
+	unsigned int remaining = value < 0 ? -static_cast<unsigned int>(value) : static_cast<unsigned int>(value);
+	do {
+		digits[--pos] = static_cast<char>('0' + remaining % 10);
+		remaining /= 10;
+	} while (remaining && pos > 1);
+	if (value < 0) {
+		digits[--pos] = '-';
+	}
+	write(fd, digits + pos, sizeof(digits) - pos);
+}
+
+void signalHandler(int signal) {
+	const int fd = dumpFd.load();
+	if (fd >= 0 && !handling.exchange(true)) {
+		write(fd, "*** Fatal signal ");
+		writeDecimal(fd, signal);
+		write(fd, ", dumping buffered log records ***\n");
+		dump(fd);
+		::fsync(fd);
+	}
+
+	// Handlers were installed with SA_RESETHAND, re-raising runs the default action
+	::raise(signal);
+}
+
+}
+
+namespace Detail {
+
+std::atomic<bool> installed{false};
+
+void installAlternateStack() noexcept {
+	if (const int error = localAlternateStack().error()) {
+		write(STDERR_FILENO, "[*** LOG ERROR ***] Unable to install alternate signal stack: ");
+		write(STDERR_FILENO, std::strerror(error));
+		write(STDERR_FILENO, "\n");
+	}
+}
+
+}
+
+void install(int fd) {
+	if (fd < 0) {
+		throw std::invalid_argument("Crash handler requires a valid file descriptor");
+	}
+	if (const int error = localAlternateStack().error()) {
+		throw std::runtime_error(fmt::format("Unable to install alternate signal stack: {}", std::strerror(error)));
+	}
+	dumpFd.store(fd);
+
+	struct sigaction action{};
+	action.sa_handler = signalHandler;
+	action.sa_flags = SA_RESETHAND | SA_ONSTACK;
+	sigemptyset(&action.sa_mask);
+
+	for (size_t i=0; i<FATAL_SIGNALS.size(); ++i) {
+		if (::sigaction(FATAL_SIGNALS[i], &action, &previousActions[i]) != 0) {
+			throw std::runtime_error(fmt::format("Unable to install crash handler for signal {}", FATAL_SIGNALS[i]));
+		}
+	}
+	Detail::installed.store(true);
+}
+
+void uninstall() {
+	if (dumpFd.exchange(-1) < 0) {
+		return;
+	}
+	Detail::installed.store(false);
+	for (size_t i=0; i<FATAL_SIGNALS.size(); ++i) {
+		::sigaction(FATAL_SIGNALS[i], &previousActions[i], nullptr);
+	}
+}
+
+void registerSink(const CrashDumpSink* sink) {
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (auto& slot: sinks) {
+		if (!slot.load()) {
+			slot.store(sink);
+			return;
+		}
+	}
+	throw std::runtime_error(fmt::format("Unable to register more than {} crash dump sinks", MAX_SINKS));
+}
+
+void unregisterSink(const CrashDumpSink* sink) {
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (auto& slot: sinks) {
+		if (slot.load() == sink) {
+			slot.store(nullptr);
+		}
+	}
+}
+
+void dump(int fd) noexcept {
+	for (const auto& slot: sinks) {
+		if (const CrashDumpSink* sink = slot.load()) {
+			sink->dumpPending(fd);
+		}
+	}
+}
+
+void write(int fd, const char* data, size_t size) noexcept {
+	while (size) {
+		const ssize_t written = ::write(fd, data, size);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		data += written;
+		size -= static_cast<size_t>(written);
+	}
+}
+
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+
+namespace Logging {
+
+// Sinks implementing this interface write their buffered records when the crash
+// handler catches a fatal signal. Implementations may only use async-signal-safe calls.
+class CrashDumpSink {
+
+public:
+
+	virtual ~CrashDumpSink() = default;
+	virtual void dumpPending(int fd) const noexcept = 0;
+};
+
+namespace CrashHandler {
+
+namespace Detail {
+
+extern std::atomic<bool> installed;
+
+void installAlternateStack() noexcept;
+
+}
+
+// Handlers run on a per-thread alternate stack, so that a stack overflow can still be
+// dumped. install() sets it up for the calling thread, other threads get theirs on their
+// first log call. Threads that never log run the handler on their own stack.
+void install(int fd);
+void uninstall();
+
+inline void prepareThread() noexcept {
+	thread_local bool prepared = false;
+	if (!prepared && Detail::installed.load(std::memory_order_relaxed)) {
+		prepared = true;
+		Detail::installAlternateStack();
+	}
+}
+
+void registerSink(const CrashDumpSink*);
+void unregisterSink(const CrashDumpSink*);
+
+void dump(int fd) noexcept;
+void write(int fd, const char* data, size_t size) noexcept;
+
+inline void write(int fd, std::string_view text) noexcept {
+	write(fd, text.data(), text.size());
+}
+
+}
+
+}
@@ -0,0 +1,340 @@
+// Copyright (C) 2021 twyleg
+#include "deferred.h"
+
+#include <spdlog/sinks/sink.h>
+
+#include <boost/optional.hpp>
+
+#if __has_include(<fmt/args.h>)
+#include <fmt/args.h>
+#endif
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Logging::Deferred {
+
+namespace {
+
+constexpr size_t DEFAULT_THREAD_BUFFER_SIZE = 256 * 1024;
+constexpr auto BACKEND_IDLE_SLEEP = std::chrono::microseconds(500);
+constexpr auto FLUSH_POLL_INTERVAL = std::chrono::microseconds(100);
+
+size_t roundUpToPowerOfTwo(size_t value) {
+	size_t result = 1024;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+struct PaddingHeader {
+	uint32_t mSize;
+	RecordKind mKind;
+};
+
+class Backend {
+
+public:
+
+	static Backend& instance() {
+		static Backend backend;
+		return backend;
+	}
+
+	~Backend() {
+		mStop.store(true);
+		mThread.join();
+	}
+
+	std::shared_ptr<ThreadBuffer> registerThread() {
+		auto buffer = std::make_shared<ThreadBuffer>(mThreadBufferSize.load());
+		std::lock_guard<std::mutex> lock(mMutex);
+		mBuffers.push_back(buffer);
+		return buffer;
+	}
+
+	void setThreadBufferSize(size_t size) {
+		mThreadBufferSize.store(size);
+	}
+
+	void flush() {
+		std::vector<std::pair<std::shared_ptr<ThreadBuffer>, size_t>> targets;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			for (const auto& buffer: mBuffers) {
+				targets.emplace_back(buffer, buffer->writePos());
+			}
+		}
+
+		for (const auto& [buffer, writePos]: targets) {
+			while (buffer->readPos() < writePos) {
+				std::this_thread::sleep_for(FLUSH_POLL_INTERVAL);
+			}
+		}
+	}
+
+private:
+
+	Backend()
+		: mThread(&Backend::run, this)
+	{}
+
+	void run() {
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				buffers.assign(mBuffers.begin(), mBuffers.end());
+			}
+
+			bool processed = false;
+			for (const auto& buffer: buffers) {
+				processed |= drain(*buffer);
+			}
+
+			removeRetiredBuffers();
+
+			if (!processed) {
+				if (mStop.load()) {
+					break;
+				}
+				std::this_thread::sleep_for(BACKEND_IDLE_SLEEP);
+			}
+		}
+	}
+
+	bool drain(ThreadBuffer& buffer) {
+		bool processed = false;
+		while (const char* record = buffer.peek()) {
+			RecordHeader header;
+			std::memcpy(&header, record, sizeof(header));
+			dispatch(header, record + sizeof(header));
+			buffer.release(header.mSize);
+			processed = true;
+		}
+		return processed;
+	}
+
+	void dispatch(const RecordHeader& header, const char* args) {
+		const auto level = static_cast<spdlog::level::level_enum>(header.mLevel);
+		boost::optional<spdlog::details::log_msg> msg;
+
+		const auto dispatchToSink = [&](const spdlog::sink_ptr& sink) {
+			if (!sink->should_log(level)) {
+				return;
+			}
+
+			try {
+				if (auto recordSink = dynamic_cast<RecordSink*>(sink.get())) {
+					recordSink->logRecord(header, args);
+					return;
+				}
+
+				if (!msg) {
+					mFormatted.clear();
+					formatArgs(header.mFormat, args, header.mNumArgs, mFormatted);
+					msg.emplace(header.mLogger->name(), level, spdlog::string_view_t(mFormatted.data(), mFormatted.size()));
+					msg->time = spdlog::log_clock::time_point(spdlog::log_clock::duration(header.mTimestamp));
+					msg->thread_id = header.mThreadId;
+				}
+				sink->log(*msg);
+			} catch (const std::exception& e) {
+				fmt::print(stderr, "[*** LOG ERROR ***] [{}] {}\n", header.mLogger->name(), e.what());
+			}
+		};
+
+		if (auto module = dynamic_cast<const Module*>(header.mLogger)) {
+			module->forEachSink(dispatchToSink);
+		} else {
+			for (const auto& sink: header.mLogger->sinks()) {
+				dispatchToSink(sink);
+			}
+		}
+	}
+
+	void removeRetiredBuffers() {
+		std::lock_guard<std::mutex> lock(mMutex);
+		mBuffers.erase(std::remove_if(mBuffers.begin(), mBuffers.end(), [](const auto& buffer) {
+			return buffer->retired() && buffer->readPos() == buffer->writePos();
+		}), mBuffers.end());
+	}
+
+	std::mutex mMutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> mBuffers;
+	std::atomic<size_t> mThreadBufferSize{DEFAULT_THREAD_BUFFER_SIZE};
+	spdlog::memory_buf_t mFormatted;
+	std::atomic<bool> mStop{false};
+	std::thread mThread;
+};
+
+struct ThreadBufferHolder {
+
+	ThreadBufferHolder()
+		: mBuffer(Backend::instance().registerThread())
+	{}
+
+	~ThreadBufferHolder() {
+		mBuffer->retire();
+	}
+
+	std::shared_ptr<ThreadBuffer> mBuffer;
+};
+
+}
+
+ThreadBuffer::ThreadBuffer(size_t capacity)
+	: mCapacity(roundUpToPowerOfTwo(capacity)),
+	  mMask(mCapacity - 1),
+	  mBuffer(new char[mCapacity])
+{}
+
+char* ThreadBuffer::reserve(size_t size) {
+	size_t writePos = mWritePos.load(std::memory_order_relaxed);
+	const size_t tailSpace = mCapacity - (writePos & mMask);
+	const bool wrap = tailSpace < size;
+	const size_t required = wrap ? tailSpace + size : size;
+
+	while (writePos + required - mCachedReadPos > mCapacity) {
+		mCachedReadPos = mReadPos.load(std::memory_order_acquire);
+		if (writePos + required - mCachedReadPos > mCapacity) {
+			std::this_thread::yield();
+		}
+	}
+
+	if (wrap) {
+		const PaddingHeader padding{static_cast<uint32_t>(tailSpace), RecordKind::PADDING};
+		std::memcpy(&mBuffer[writePos & mMask], &padding, sizeof(padding));
+		writePos += tailSpace;
+	}
+
+	mReservedPos = writePos + size;
+	return &mBuffer[writePos & mMask];
+}
+
+const char* ThreadBuffer::peek() {
+	size_t readPos = mReadPos.load(std::memory_order_relaxed);
+	const size_t writePos = mWritePos.load(std::memory_order_acquire);
+
+	while (readPos != writePos) {
+		PaddingHeader padding;
+		std::memcpy(&padding, &mBuffer[readPos & mMask], sizeof(padding));
+		if (padding.mKind == RecordKind::RECORD) {
+			return &mBuffer[readPos & mMask];
+		}
+		readPos += padding.mSize;
+		mReadPos.store(readPos, std::memory_order_release);
+	}
+	return nullptr;
+}
+
+void ThreadBuffer::release(size_t size) {
+	mReadPos.store(mReadPos.load(std::memory_order_relaxed) + size, std::memory_order_release);
+}
+
+ThreadBuffer& localThreadBuffer() {
+	thread_local ThreadBufferHolder holder;
+	return *holder.mBuffer;
+}
+
+void setThreadBufferSize(size_t size) {
+	Backend::instance().setThreadBufferSize(size);
+}
+
+void flush() {
+	Backend::instance().flush();
+}
+
+void formatArgs(const char* format, const char* args, uint8_t numArgs, spdlog::memory_buf_t& dst) {
+
+	fmt::dynamic_format_arg_store<fmt::format_context> store;
+
+	for (uint8_t i=0; i<numArgs; ++i) {
+		const auto type = static_cast<ArgType>(*args++);
+		switch (type) {
+		case ArgType::INT64: {
+			int64_t value;
+			std::memcpy(&value, args, sizeof(value));
+			store.push_back(value);
+			args += sizeof(value);
+			break;
+		}
+		case ArgType::UINT64: {
+			uint64_t value;
+			std::memcpy(&value, args, sizeof(value));
+			store.push_back(value);
+			args += sizeof(value);
+			break;
+		}
+		case ArgType::DOUBLE: {
+			double value;
+			std::memcpy(&value, args, sizeof(value));
+			store.push_back(value);
+			args += sizeof(value);
+			break;
+		}
+		case ArgType::BOOL: {
+			bool value;
+			std::memcpy(&value, args, sizeof(value));
+			store.push_back(value);
+			args += sizeof(value);
+			break;
+		}
+		case ArgType::CHAR:
+			store.push_back(*args);
+			args += sizeof(char);
+			break;
+		case ArgType::STRING: {
+			uint32_t length;
+			std::memcpy(&length, args, sizeof(length));
+			store.push_back(fmt::string_view(args + sizeof(length), length));
+			args += sizeof(length) + length;
+			break;
+		}
+		case ArgType::POINTER: {
+			uint64_t value;
+			std::memcpy(&value, args, sizeof(value));
+			store.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(value)));
+			args += sizeof(value);
+			break;
+		}
+		}
+	}
+
+	try {
+		fmt::vformat_to(std::back_inserter(dst), fmt::string_view(format), store);
+	} catch (const fmt::format_error& e) {
+		fmt::format_to(std::back_inserter(dst), "[format error: {}] {}", e.what(), format);
+	}
+}
+
+size_t getArgsSize(const char* args, uint8_t numArgs) {
+	const char* begin = args;
+	for (uint8_t i=0; i<numArgs; ++i) {
+		const auto type = static_cast<ArgType>(*args++);
+		switch (type) {
+		case ArgType::BOOL:
+			args += sizeof(bool);
+			break;
+		case ArgType::CHAR:
+			args += sizeof(char);
+			break;
+		case ArgType::STRING: {
+			uint32_t length;
+			std::memcpy(&length, args, sizeof(length));
+			args += sizeof(length) + length;
+			break;
+		}
+		default:
+			args += sizeof(uint64_t);
+			break;
+		}
+	}
+	return static_cast<size_t>(args - begin);
+}
+
+}
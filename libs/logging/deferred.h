@@ -0,0 +1,257 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+#include "crash_handler.h"
+#include "level.h"
+#include "module.h"
+
+#include <spdlog/logger.h>
+#include <spdlog/details/os.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#define LOG_DEFERRED(logModule, logLevel, format, ...) \
+	do { \
+		if constexpr (LOGGING_LEVEL_ACTIVE(logLevel)) { \
+			static Logging::LogCallSite logCallSite{__FILE__, __LINE__}; \
+			if (Logging::shouldLog(*logModule, logLevel) && Logging::admit(*logModule, logLevel, &logCallSite)) { \
+				Logging::Deferred::log(*logModule, logLevel, FMT_STRING("" format), ##__VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+#define FLUSH_DEFERRED(logModule) \
+	do { \
+		Logging::Deferred::flush(); \
+		logModule->flush(); \
+	} while (0)
+
+namespace Logging::Deferred {
+
+enum class ArgType : uint8_t {
+	INT64,
+	UINT64,
+	DOUBLE,
+	BOOL,
+	CHAR,
+	STRING,
+	POINTER
+};
+
+enum class RecordKind : uint32_t {
+	RECORD,
+	PADDING
+};
+
+struct RecordHeader {
+	uint32_t mSize;
+	RecordKind mKind;
+	const char* mFormat;
+	spdlog::logger* mLogger;
+	int64_t mTimestamp;
+	uint64_t mThreadId;
+	uint8_t mLevel;
+	uint8_t mNumArgs;
+};
+
+constexpr size_t RECORD_ALIGNMENT = alignof(RecordHeader);
+
+constexpr size_t alignRecordSize(size_t size) {
+	return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+namespace Detail {
+
+template<class T>
+char* writeValue(char* dst, ArgType type, const T& value) {
+	*dst++ = static_cast<char>(type);
+	std::memcpy(dst, &value, sizeof(T));
+	return dst + sizeof(T);
+}
+
+inline char* writeString(char* dst, std::string_view value) {
+	const auto length = static_cast<uint32_t>(value.size());
+	*dst++ = static_cast<char>(ArgType::STRING);
+	std::memcpy(dst, &length, sizeof(length));
+	std::memcpy(dst + sizeof(length), value.data(), length);
+	return dst + sizeof(length) + length;
+}
+
+template<class T, class Enable = void>
+struct ArgCodec {
+	static_assert(sizeof(T) == 0, "LOG_DEFERRED only supports arithmetic, enum, pointer and string arguments");
+};
+
+template<>
+struct ArgCodec<bool> {
+	using Formatted = bool;
+	static size_t size(bool) { return 1 + sizeof(bool); }
+	static char* encode(char* dst, bool value) { return writeValue(dst, ArgType::BOOL, value); }
+};
+
+template<>
+struct ArgCodec<char> {
+	using Formatted = char;
+	static size_t size(char) { return 1 + sizeof(char); }
+	static char* encode(char* dst, char value) { return writeValue(dst, ArgType::CHAR, value); }
+};
+
+template<class T>
+struct ArgCodec<T, std::enable_if_t<std::is_integral_v<T> && std::is_signed_v<T> && !std::is_same_v<T, char>>> {
+	using Formatted = int64_t;
+	static size_t size(T) { return 1 + sizeof(int64_t); }
+	static char* encode(char* dst, T value) { return writeValue(dst, ArgType::INT64, static_cast<int64_t>(value)); }
+};
+
+template<class T>
+struct ArgCodec<T, std::enable_if_t<std::is_integral_v<T> && std::is_unsigned_v<T> && !std::is_same_v<T, bool>
+		&& !std::is_same_v<T, char>>> {
+	using Formatted = uint64_t;
+	static size_t size(T) { return 1 + sizeof(uint64_t); }
+	static char* encode(char* dst, T value) { return writeValue(dst, ArgType::UINT64, static_cast<uint64_t>(value)); }
+};
+
+template<class T>
+struct ArgCodec<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+	using Formatted = double;
+	static size_t size(T) { return 1 + sizeof(double); }
+	static char* encode(char* dst, T value) { return writeValue(dst, ArgType::DOUBLE, static_cast<double>(value)); }
+};
+
+template<class T>
+struct ArgCodec<T, std::enable_if_t<std::is_enum_v<T>>> {
+	using Underlying = std::underlying_type_t<T>;
+	using Formatted = typename ArgCodec<Underlying>::Formatted;
+	static size_t size(T value) { return ArgCodec<Underlying>::size(static_cast<Underlying>(value)); }
+	static char* encode(char* dst, T value) { return ArgCodec<Underlying>::encode(dst, static_cast<Underlying>(value)); }
+};
+
+template<class T>
+struct ArgCodec<T, std::enable_if_t<std::is_same_v<T, const char*> || std::is_same_v<T, char*>>> {
+	using Formatted = std::string_view;
+	static size_t size(const char* value) { return 1 + sizeof(uint32_t) + std::strlen(value); }
+	static char* encode(char* dst, const char* value) { return writeString(dst, value); }
+};
+
+template<class T>
+struct ArgCodec<T, std::enable_if_t<std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>>> {
+	using Formatted = std::string_view;
+	static size_t size(std::string_view value) { return 1 + sizeof(uint32_t) + value.size(); }
+	static char* encode(char* dst, std::string_view value) { return writeString(dst, value); }
+};
+
+template<class T>
+struct ArgCodec<T, std::enable_if_t<std::is_pointer_v<T> && !std::is_same_v<T, const char*> && !std::is_same_v<T, char*>>> {
+	using Formatted = const void*;
+	static size_t size(T) { return 1 + sizeof(uint64_t); }
+	static char* encode(char* dst, T value) {
+		return writeValue(dst, ArgType::POINTER, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+	}
+};
+
+template<class T>
+using Codec = ArgCodec<std::decay_t<T>>;
+
+}
+
+// Checked at compile time against the argument types the backend formats
+template<class... Args>
+using FormatString = spdlog::format_string_t<typename Detail::Codec<Args>::Formatted...>;
+
+class ThreadBuffer {
+
+public:
+
+	explicit ThreadBuffer(size_t capacity);
+
+	char* reserve(size_t size);
+	void commit() { mWritePos.store(mReservedPos, std::memory_order_release); }
+
+	const char* peek();
+	void release(size_t size);
+	size_t writePos() const { return mWritePos.load(std::memory_order_acquire); }
+	size_t readPos() const { return mReadPos.load(std::memory_order_acquire); }
+	size_t capacity() const { return mCapacity; }
+
+	void retire() { mRetired.store(true, std::memory_order_release); }
+	bool retired() const { return mRetired.load(std::memory_order_acquire); }
+
+private:
+
+	const size_t mCapacity;
+	const size_t mMask;
+	std::unique_ptr<char[]> mBuffer;
+
+	alignas(64) std::atomic<size_t> mWritePos{0};
+	size_t mReservedPos = 0;
+	size_t mCachedReadPos = 0;
+
+	alignas(64) std::atomic<size_t> mReadPos{0};
+	std::atomic<bool> mRetired{false};
+};
+
+ThreadBuffer& localThreadBuffer();
+
+void setThreadBufferSize(size_t);
+void flush();
+
+void formatArgs(const char* format, const char* args, uint8_t numArgs, spdlog::memory_buf_t& dst);
+size_t getArgsSize(const char* args, uint8_t numArgs);
+
+// Sinks implementing this interface receive deferred records unformatted.
+class RecordSink {
+
+public:
+
+	virtual ~RecordSink() = default;
+	virtual void logRecord(const RecordHeader&, const char* args) = 0;
+};
+
+template<class... Args>
+void log(spdlog::logger& logger, spdlog::level::level_enum level, FormatString<Args...> formatString, const Args&... args) {
+
+	CrashHandler::prepareThread();
+	const char* format = spdlog::string_view_t(formatString).data();
+
+	const size_t size = alignRecordSize(sizeof(RecordHeader) + (Detail::Codec<Args>::size(args) + ... + 0));
+
+	ThreadBuffer& buffer = localThreadBuffer();
+	if (size > buffer.capacity() / 2) {
+		std::unique_ptr<char[]> encodedArgs(new char[size]);
+		char* argDst = encodedArgs.get();
+		((argDst = Detail::Codec<Args>::encode(argDst, args)), ...);
+		(void) argDst;
+
+		spdlog::memory_buf_t formatted;
+		formatArgs(format, encodedArgs.get(), sizeof...(Args), formatted);
+		logger.log(level, spdlog::string_view_t(formatted.data(), formatted.size()));
+		return;
+	}
+
+	char* dst = buffer.reserve(size);
+
+	const RecordHeader header{
+		static_cast<uint32_t>(size),
+		RecordKind::RECORD,
+		format,
+		&logger,
+		spdlog::log_clock::now().time_since_epoch().count(),
+		spdlog::details::os::thread_id(),
+		static_cast<uint8_t>(level),
+		static_cast<uint8_t>(sizeof...(Args))
+	};
+	std::memcpy(dst, &header, sizeof(header));
+
+	char* argDst = dst + sizeof(header);
+	((argDst = Detail::Codec<Args>::encode(argDst, args)), ...);
+	(void) argDst;
+
+	buffer.commit();
+}
+
+}
@@ -0,0 +1,206 @@
+// Copyright (C) 2021 twyleg
+#include "json_sink.h"
+
+#include <spdlog/details/os.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cmath>
+#include <iterator>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Logging {
+
+namespace {
+
+const std::array<std::string, spdlog::level::n_levels> LEVEL_MEMBERS = []() {
+	std::array<std::string, spdlog::level::n_levels> members;
+	for (size_t level=0; level<members.size(); ++level) {
+		const auto name = spdlog::level::to_string_view(static_cast<spdlog::level::level_enum>(level));
+		members[level] = fmt::format("Z\",\"level\":\"{}\",\"module\":\"", std::string_view(name.data(), name.size()));
+	}
+	return members;
+}();
+
+void appendText(spdlog::memory_buf_t& dst, std::string_view string) {
+	dst.append(string.data(), string.data() + string.size());
+}
+
+bool needsEscape(char c) {
+	return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+// Returns the position of the first character that needs escaping or value.size()
+size_t findEscape(std::string_view value) {
+	const char* const data = value.data();
+	const size_t size = value.size();
+	size_t pos = 0;
+
+#ifdef __SSE2__
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i maxControl = _mm_set1_epi8(0x1f);
+	for (; pos + 16 <= size; pos += 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+		const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, maxControl), chunk);
+		const __m128i special = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+		const int mask = _mm_movemask_epi8(_mm_or_si128(control, special));
+		if (mask) {
+			return pos + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+		}
+	}
+#endif
+
+	for (; pos < size; ++pos) {
+		if (needsEscape(data[pos])) {
+			return pos;
+		}
+	}
+	return size;
+}
+
+void appendEscapedChar(char c, spdlog::memory_buf_t& dst) {
+	switch (c) {
+	case '"':
+		appendText(dst, "\\\"");
+		break;
+	case '\\':
+		appendText(dst, "\\\\");
+		break;
+	case '\n':
+		appendText(dst, "\\n");
+		break;
+	case '\r':
+		appendText(dst, "\\r");
+		break;
+	case '\t':
+		appendText(dst, "\\t");
+		break;
+	case '\b':
+		appendText(dst, "\\b");
+		break;
+	case '\f':
+		appendText(dst, "\\f");
+		break;
+	default: {
+		static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+		const auto byte = static_cast<unsigned char>(c);
+		const char escaped[6] = {'\\', 'u', '0', '0', HEX_DIGITS[byte >> 4], HEX_DIGITS[byte & 0xf]};
+		dst.append(escaped, escaped + sizeof(escaped));
+		break;
+	}
+	}
+}
+
+void appendValue(const Structured::FieldValue& value, spdlog::memory_buf_t& dst) {
+	switch (value.mType) {
+	case Deferred::ArgType::INT64: {
+		const fmt::format_int text(value.mInt);
+		dst.append(text.data(), text.data() + text.size());
+		break;
+	}
+	case Deferred::ArgType::UINT64: {
+		const fmt::format_int text(value.mUint);
+		dst.append(text.data(), text.data() + text.size());
+		break;
+	}
+	case Deferred::ArgType::DOUBLE:
+		if (std::isfinite(value.mDouble)) {
+			fmt::format_to(std::back_inserter(dst), "{}", value.mDouble);
+		} else {
+			appendText(dst, "null");
+		}
+		break;
+	case Deferred::ArgType::BOOL:
+		appendText(dst, value.mBool ? "true" : "false");
+		break;
+	case Deferred::ArgType::CHAR:
+		dst.push_back('"');
+		JsonSink::appendEscaped(std::string_view(&value.mChar, 1), dst);
+		dst.push_back('"');
+		break;
+	case Deferred::ArgType::STRING:
+		dst.push_back('"');
+		JsonSink::appendEscaped(value.mString, dst);
+		dst.push_back('"');
+		break;
+	case Deferred::ArgType::POINTER:
+		fmt::format_to(std::back_inserter(dst), "\"{:#x}\"", value.mUint);
+		break;
+	}
+}
+
+}
+
+void JsonSink::appendEscaped(std::string_view value, spdlog::memory_buf_t& dst) {
+	while (!value.empty()) {
+		const size_t pos = findEscape(value);
+		dst.append(value.data(), value.data() + pos);
+		if (pos == value.size()) {
+			break;
+		}
+		appendEscapedChar(value[pos], dst);
+		value.remove_prefix(pos + 1);
+	}
+}
+
+void JsonSink::logStructured(const spdlog::details::log_msg& msg, const Structured::Fields& fields) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	format(msg, &fields);
+	writeRecord(msg, mJson);
+}
+
+void JsonSink::sink_it_(const spdlog::details::log_msg& msg) {
+	format(msg, nullptr);
+	writeRecord(msg, mJson);
+}
+
+void JsonSink::format(const spdlog::details::log_msg& msg, const Structured::Fields* fields) {
+	const auto sinceEpoch = msg.time.time_since_epoch();
+	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+	if (seconds.count() != mCachedSecond) {
+		renderTimePrefix(static_cast<std::time_t>(seconds.count()));
+	}
+	const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch - seconds).count();
+
+	mJson.clear();
+	mJson.append(mTimePrefix.data(), mTimePrefix.data() + TIME_PREFIX_SIZE);
+	fmt::format_to(std::back_inserter(mJson), "{:06}", microseconds);
+	appendText(mJson, LEVEL_MEMBERS[static_cast<size_t>(msg.level)]);
+	appendEscaped(std::string_view(msg.logger_name.data(), msg.logger_name.size()), mJson);
+	appendText(mJson, "\",\"thread\":");
+	const fmt::format_int threadId(msg.thread_id);
+	mJson.append(threadId.data(), threadId.data() + threadId.size());
+	appendText(mJson, ",\"message\":\"");
+	appendEscaped(std::string_view(msg.payload.data(), msg.payload.size()), mJson);
+	mJson.push_back('"');
+
+	// Fields are nested, a key like "time" or "message" would duplicate a record member otherwise
+	if (fields && fields->mNumFields) {
+		appendText(mJson, ",\"fields\":");
+		char separator = '{';
+		Structured::forEachField(*fields, [this, &separator](std::string_view key, const Structured::FieldValue& value) {
+			mJson.push_back(separator);
+			mJson.push_back('"');
+			appendEscaped(key, mJson);
+			appendText(mJson, "\":");
+			appendValue(value, mJson);
+			separator = ',';
+		});
+		mJson.push_back('}');
+	}
+	appendText(mJson, "}\n");
+}
+
+void JsonSink::renderTimePrefix(std::time_t seconds) {
+	const std::tm tm = spdlog::details::os::gmtime(seconds);
+	fmt::format_to_n(mTimePrefix.data(), mTimePrefix.size(), "{{\"time\":\"{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.",
+			tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+	mCachedSecond = seconds;
+}
+
+}
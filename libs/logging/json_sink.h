@@ -0,0 +1,45 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "structured.h"
+#include "vectored_file_sink.h"
+
+#include <array>
+#include <ctime>
+#include <string_view>
+
+namespace Logging {
+
+// Writes one JSON object per line (NDJSON). LOG_KV fields become members of a nested
+// "fields" object with their original types, plain records only carry the message.
+// The configured pattern is ignored.
+class JsonSink : public VectoredFileSink, public Structured::StructuredSink {
+
+public:
+
+	using VectoredFileSink::VectoredFileSink;
+
+	void logStructured(const spdlog::details::log_msg&, const Structured::Fields&) override;
+
+	// Appends value as JSON string content without the enclosing quotes
+	static void appendEscaped(std::string_view value, spdlog::memory_buf_t& dst);
+
+protected:
+
+	void sink_it_(const spdlog::details::log_msg&) override;
+	void set_pattern_(const std::string&) override {}
+	void set_formatter_(std::unique_ptr<spdlog::formatter>) override {}
+
+private:
+
+	static constexpr size_t TIME_PREFIX_SIZE = sizeof("{\"time\":\"YYYY-mm-ddTHH:MM:SS.") - 1;
+
+	void format(const spdlog::details::log_msg&, const Structured::Fields*);
+	void renderTimePrefix(std::time_t);
+
+	spdlog::memory_buf_t mJson;
+	std::time_t mCachedSecond = -1;
+	std::array<char, TIME_PREFIX_SIZE + 1> mTimePrefix;
+};
+
+}
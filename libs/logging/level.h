@@ -0,0 +1,20 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <spdlog/common.h>
+
+#define LL_DEBUG spdlog::level::level_enum::debug
+#define LL_INFO spdlog::level::level_enum::info
+#define LL_WARN spdlog::level::level_enum::warn
+#define LL_ERROR spdlog::level::level_enum::err
+
+#define LOGGING_LEVEL_DEBUG SPDLOG_LEVEL_DEBUG
+#define LOGGING_LEVEL_INFO SPDLOG_LEVEL_INFO
+#define LOGGING_LEVEL_WARN SPDLOG_LEVEL_WARN
+#define LOGGING_LEVEL_ERROR SPDLOG_LEVEL_ERROR
+
+#ifndef LOGGING_ACTIVE_LEVEL
+#define LOGGING_ACTIVE_LEVEL LOGGING_LEVEL_DEBUG
+#endif
+
+#define LOGGING_LEVEL_ACTIVE(logLevel) (static_cast<int>(logLevel) >= LOGGING_ACTIVE_LEVEL)
@@ -0,0 +1,145 @@
+// Copyright (C) 2021 twyleg
+#include "log_index.h"
+
+#include <spdlog/common.h>
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace Logging {
+
+namespace LogIndex {
+
+boost::filesystem::path indexPath(const boost::filesystem::path& logFilePath) {
+	return logFilePath.string() + FILE_EXTENSION;
+}
+
+uint64_t moduleBit(std::string_view moduleName) {
+	uint64_t hash = 14695981039346656037ull;
+	for (const char c: moduleName) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return uint64_t(1) << (hash % 64);
+}
+
+std::vector<Entry> read(const boost::filesystem::path& indexPath) {
+	std::ifstream ifs(indexPath.string(), std::ios::binary);
+	if (!ifs) {
+		return {};
+	}
+	const std::vector<char> data((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+	if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+		throw std::runtime_error(fmt::format("\"{}\" is not a log index", indexPath.string()));
+	}
+
+	// A partially written last entry is ignored
+	std::vector<Entry> entries((data.size() - sizeof(MAGIC)) / sizeof(Entry));
+	if (!entries.empty()) {
+		std::memcpy(entries.data(), data.data() + sizeof(MAGIC), entries.size() * sizeof(Entry));
+	}
+	return entries;
+}
+
+}
+
+const LogIndexWriter::Policy LogIndexWriter::DISABLED{0, 0};
+
+LogIndexWriter::LogIndexWriter(const boost::filesystem::path& logFilePath, bool truncate, const Policy& policy)
+	: mIndexPath(LogIndex::indexPath(logFilePath)),
+	  mPolicy(policy)
+{
+	const int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+	mFd = ::open(mIndexPath.c_str(), flags, 0644);
+	if (mFd < 0) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to open log index {}", mIndexPath.string()), errno);
+	}
+
+	struct stat fileStat;
+	if (::fstat(mFd, &fileStat) == 0 && fileStat.st_size == 0) {
+		if (::write(mFd, LogIndex::MAGIC, sizeof(LogIndex::MAGIC)) != static_cast<ssize_t>(sizeof(LogIndex::MAGIC))) {
+			::close(mFd);
+			throw spdlog::spdlog_ex(fmt::format("Failed to write log index {}", mIndexPath.string()), errno);
+		}
+	}
+}
+
+LogIndexWriter::~LogIndexWriter() {
+	finishBlock();
+	try {
+		write();
+	} catch (const spdlog::spdlog_ex& e) {
+		fmt::print(stderr, "[*** LOG ERROR ***] {}\n", e.what());
+	}
+	::close(mFd);
+}
+
+void LogIndexWriter::add(const spdlog::details::log_msg& msg, size_t offset, size_t size) {
+	const int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count();
+
+	if (mBlock.mNumRecords == 0) {
+		mBlock.mOffset = offset;
+		mBlock.mMinTimestamp = timestamp;
+		mBlock.mMaxTimestamp = timestamp;
+	}
+
+	const std::string_view moduleName(msg.logger_name.data(), msg.logger_name.size());
+	if (moduleName != mLastModuleName) {
+		mLastModuleName.assign(moduleName.data(), moduleName.size());
+		mLastModuleBit = LogIndex::moduleBit(moduleName);
+	}
+
+	mBlock.mSize = offset + size - mBlock.mOffset;
+	mBlock.mMinTimestamp = std::min(mBlock.mMinTimestamp, timestamp);
+	mBlock.mMaxTimestamp = std::max(mBlock.mMaxTimestamp, timestamp);
+	mBlock.mModuleMask |= mLastModuleBit;
+	mBlock.mLevelMask |= 1u << msg.level;
+	mBlock.mNumRecords++;
+
+	if ((mPolicy.mMaxRecords && mBlock.mNumRecords >= mPolicy.mMaxRecords)
+			|| (mPolicy.mMaxBytes && mBlock.mSize >= mPolicy.mMaxBytes)) {
+		finishBlock();
+	}
+}
+
+void LogIndexWriter::write() {
+	if (mFinishedBlocks.empty()) {
+		return;
+	}
+
+	const auto* data = reinterpret_cast<const char*>(mFinishedBlocks.data());
+	size_t remaining = mFinishedBlocks.size() * sizeof(LogIndex::Entry);
+	while (remaining > 0) {
+		const ssize_t written = ::write(mFd, data, remaining);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			mFinishedBlocks.clear();
+			throw spdlog::spdlog_ex(fmt::format("Failed to write log index {}", mIndexPath.string()), errno);
+		}
+		data += written;
+		remaining -= static_cast<size_t>(written);
+	}
+	mFinishedBlocks.clear();
+}
+
+void LogIndexWriter::finishBlock() {
+	if (mBlock.mNumRecords > 0) {
+		mFinishedBlocks.push_back(mBlock);
+		mBlock = LogIndex::Entry{};
+	}
+}
+
+}
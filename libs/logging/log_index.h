@@ -0,0 +1,85 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <spdlog/details/log_msg.h>
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Logging {
+
+// Sidecar index of a text log file, stored next to it as "<file>.idx": MAGIC followed
+// by one Entry per block of consecutive records. A reader only has to scan the blocks
+// whose time range, levels and modules can match, plus the bytes no entry covers yet.
+namespace LogIndex {
+
+constexpr char MAGIC[8] = {'L', 'O', 'G', 'I', 'D', 'X', '\0', '\1'};
+constexpr const char* FILE_EXTENSION = ".idx";
+
+struct Entry {
+	uint64_t mOffset;
+	uint64_t mSize;
+	int64_t mMinTimestamp;
+	int64_t mMaxTimestamp;
+	uint64_t mModuleMask;
+	uint32_t mNumRecords;
+	uint32_t mLevelMask;
+};
+
+static_assert(sizeof(Entry) == 48, "Entry is written to the index file as is");
+
+boost::filesystem::path indexPath(const boost::filesystem::path& logFilePath);
+
+// Modules are hashed into a 64 bit mask, so a set bit means "may contain the module"
+uint64_t moduleBit(std::string_view moduleName);
+
+// Returns no entries when the log file has no index
+std::vector<Entry> read(const boost::filesystem::path& indexPath);
+
+}
+
+class LogIndexWriter {
+
+public:
+
+	// A block ends after mMaxRecords records or mMaxBytes bytes, whatever comes first
+	struct Policy {
+		size_t mMaxRecords;
+		size_t mMaxBytes;
+
+		bool enabled() const { return mMaxRecords || mMaxBytes; }
+	};
+
+	static const Policy DISABLED;
+
+	LogIndexWriter(const boost::filesystem::path& logFilePath, bool truncate, const Policy&);
+	~LogIndexWriter();
+
+	LogIndexWriter(const LogIndexWriter&) = delete;
+	LogIndexWriter& operator=(const LogIndexWriter&) = delete;
+
+	void add(const spdlog::details::log_msg&, size_t offset, size_t size);
+
+	// Writes the finished blocks. Must only be called once their records are in the log file.
+	void write();
+
+private:
+
+	void finishBlock();
+
+	const boost::filesystem::path mIndexPath;
+	const Policy mPolicy;
+	int mFd = -1;
+
+	LogIndex::Entry mBlock{};
+	std::vector<LogIndex::Entry> mFinishedBlocks;
+
+	std::string mLastModuleName;
+	uint64_t mLastModuleBit = 0;
+};
+
+}
@@ -0,0 +1,84 @@
+// Copyright (C) 2021 twyleg
+#include "log_pattern_formatter.h"
+
+#include <spdlog/details/os.h>
+#include <spdlog/pattern_formatter.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <string_view>
+
+namespace Logging {
+
+namespace {
+
+const std::array<std::string, spdlog::level::n_levels> LEVEL_SUFFIXES = []() {
+	std::array<std::string, spdlog::level::n_levels> suffixes;
+	for (size_t level=0; level<suffixes.size(); ++level) {
+		const auto name = spdlog::level::to_string_view(static_cast<spdlog::level::level_enum>(level));
+		suffixes[level] = fmt::format("] [{}]: ", std::string_view(name.data(), name.size()));
+	}
+	return suffixes;
+}();
+
+void append(spdlog::memory_buf_t& dest, const char* data, size_t size) {
+	dest.append(data, data + size);
+}
+
+void append(spdlog::memory_buf_t& dest, std::string_view string) {
+	append(dest, string.data(), string.size());
+}
+
+}
+
+void LogPatternFormatter::format(const spdlog::details::log_msg& msg, spdlog::memory_buf_t& dest) {
+	const auto sinceEpoch = msg.time.time_since_epoch();
+	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+	if (seconds.count() != mCachedSecond) {
+		renderTimePrefix(static_cast<std::time_t>(seconds.count()));
+	}
+	const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch - seconds).count();
+	const char millisecondDigits[3] = {
+		static_cast<char>('0' + milliseconds / 100),
+		static_cast<char>('0' + milliseconds / 10 % 10),
+		static_cast<char>('0' + milliseconds % 10)
+	};
+	append(dest, mTimePrefix.data(), TIME_PREFIX_SIZE);
+	append(dest, millisecondDigits, sizeof(millisecondDigits));
+
+	auto& threadId = mThreadIds[msg.thread_id % NUM_CACHED_THREAD_IDS];
+	if (threadId.mThreadId != msg.thread_id || !threadId.mSize) {
+		const fmt::format_int text(msg.thread_id);
+		threadId.mThreadId = msg.thread_id;
+		threadId.mSize = static_cast<uint8_t>(text.size());
+		std::copy(text.data(), text.data() + text.size(), threadId.mText);
+	}
+	append(dest, "] [");
+	append(dest, threadId.mText, threadId.mSize);
+	append(dest, "] [");
+	append(dest, msg.logger_name.data(), msg.logger_name.size());
+	append(dest, LEVEL_SUFFIXES[static_cast<size_t>(msg.level)]);
+	append(dest, msg.payload.data(), msg.payload.size());
+	append(dest, spdlog::details::os::default_eol);
+}
+
+std::unique_ptr<spdlog::formatter> LogPatternFormatter::clone() const {
+	return std::make_unique<LogPatternFormatter>();
+}
+
+void LogPatternFormatter::renderTimePrefix(std::time_t seconds) {
+	const std::tm tm = spdlog::details::os::localtime(seconds);
+	fmt::format_to_n(mTimePrefix.data(), mTimePrefix.size(), "[{:04}{:02}{:02}-{:02}:{:02}:{:02}.",
+			tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+	mCachedSecond = seconds;
+}
+
+std::unique_ptr<spdlog::formatter> createFormatter(const std::string& pattern) {
+	if (pattern == LogPatternFormatter::PATTERN) {
+		return std::make_unique<LogPatternFormatter>();
+	}
+	return std::make_unique<spdlog::pattern_formatter>(pattern);
+}
+
+}
@@ -0,0 +1,47 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <spdlog/formatter.h>
+
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+
+namespace Logging {
+
+// Produces the same output as spdlog::pattern_formatter for PATTERN. The date/time
+// prefix is rendered once per second and thread ids once per thread, so a record is
+// mostly copied together from cached pieces.
+class LogPatternFormatter : public spdlog::formatter {
+
+public:
+
+	static constexpr const char* PATTERN = "[%Y%m%d-%T.%e] [%t] [%n] [%l]: %v";
+
+	void format(const spdlog::details::log_msg&, spdlog::memory_buf_t& dest) override;
+	std::unique_ptr<spdlog::formatter> clone() const override;
+
+private:
+
+	static constexpr size_t NUM_CACHED_THREAD_IDS = 64;
+	static constexpr size_t TIME_PREFIX_SIZE = sizeof("[YYYYmmdd-HH:MM:SS.") - 1;
+
+	struct ThreadIdEntry {
+		size_t mThreadId = 0;
+		uint8_t mSize = 0;
+		char mText[24];
+	};
+
+	void renderTimePrefix(std::time_t);
+
+	std::time_t mCachedSecond = -1;
+	std::array<char, TIME_PREFIX_SIZE + 1> mTimePrefix;
+	std::array<ThreadIdEntry, NUM_CACHED_THREAD_IDS> mThreadIds;
+};
+
+// LogPatternFormatter for its pattern, spdlog::pattern_formatter for any other
+std::unique_ptr<spdlog::formatter> createFormatter(const std::string& pattern);
+
+}
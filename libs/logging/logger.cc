@@ -1,21 +1,38 @@
 // Copyright (C) 2021 twyleg
 #include "logger.h"
+#include "binary_file_sink.h"
+#include "compressed_rotating_file_sink.h"
+#include "crash_handler.h"
+#include "json_sink.h"
+#include "log_pattern_formatter.h"
+#include "ring_buffer_sink.h"
+#include "uring_file_sink.h"
+#include "vectored_file_sink.h"
 
 #include <spdlog/sinks/stdout_color_sinks.h>
-#include "spdlog/sinks/basic_file_sink.h"
-#include "spdlog/sinks/rotating_file_sink.h"
 #include <spdlog/pattern_formatter.h>
 
 #include <boost/dll.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <ctime>
+#include <sstream>
+#include <utility>
 
 namespace Logging {
 
 namespace {
 
-constexpr const char* LOG_PATTERN = "[%Y%m%d-%T.%e] [%t] [%n] [%l]: %v";
+constexpr const char* LOG_PATTERN = LogPatternFormatter::PATTERN;
+constexpr size_t DEFAULT_BINARY_SEGMENT_SIZE = 16 * 1024 * 1024;
+constexpr size_t DEFAULT_RING_BUFFER_CAPACITY = 1024;
+constexpr size_t DEFAULT_RING_BUFFER_RECORD_SIZE = 512;
+constexpr RateLimit NO_RATE_LIMIT{0.0, 0, 0};
 
 constexpr const char* LOG_CONFIG_XSD = R"(<?xml version="1.0"?>
 <xs:schema
@@ -34,9 +51,32 @@ constexpr const char* LOG_CONFIG_XSD = R"(<?xml version="1.0"?>
 		   </xs:restriction>
 	   </xs:simpleType>
 
+	   <xs:simpleType name="ModuleNameType">
+		   <xs:restriction base="xs:string">
+			   <xs:pattern value="([^*]+\.)?\*|[^*]+"/>
+		   </xs:restriction>
+	   </xs:simpleType>
+
+	   <xs:simpleType name="PositiveDecimalType">
+		   <xs:restriction base="xs:decimal">
+			   <xs:minExclusive value="0"/>
+		   </xs:restriction>
+	   </xs:simpleType>
+
+	   <xs:simpleType name="SampleRateType">
+		   <xs:restriction base="xs:decimal">
+			   <xs:minInclusive value="0"/>
+			   <xs:maxInclusive value="1"/>
+		   </xs:restriction>
+	   </xs:simpleType>
+
 	   <xs:complexType name="ModuleType">
-		   <xs:attribute name="name" type="xs:string"/>
+		   <xs:attribute name="name" type="logging:ModuleNameType"/>
 		   <xs:attribute name="logLevel" type="logging:LogLevelEnum"/>
+		   <xs:attribute name="maxRate" type="logging:PositiveDecimalType"/>
+		   <xs:attribute name="burst" type="xs:positiveInteger"/>
+		   <xs:attribute name="maxRepeats" type="xs:positiveInteger"/>
+		   <xs:attribute name="sampleRate" type="logging:SampleRateType"/>
 	   </xs:complexType>
 
 	   <xs:complexType name="LogModulesType">
@@ -52,33 +92,163 @@ constexpr const char* LOG_CONFIG_XSD = R"(<?xml version="1.0"?>
 		<xs:attribute name="defaultLogLevel" type="logging:LogLevelEnum" use="required"/>
 	   </xs:complexType>
 
-	   <xs:complexType name="ConsoleSinkType"/>
+	   <xs:simpleType name="ModuleNameListType">
+		   <xs:list itemType="logging:ModuleNameType"/>
+	   </xs:simpleType>
+
+	   <xs:simpleType name="SinkNameListType">
+		   <xs:list itemType="xs:string"/>
+	   </xs:simpleType>
+
+	   <xs:complexType name="SinkType">
+		   <xs:attribute name="name" type="xs:string"/>
+		   <xs:attribute name="level" type="logging:LogLevelEnum"/>
+		   <xs:attribute name="pattern" type="xs:string"/>
+		   <xs:attribute name="modules" type="logging:ModuleNameListType"/>
+	   </xs:complexType>
+
+	   <xs:complexType name="ConsoleSinkType">
+		   <xs:complexContent>
+			   <xs:extension base="logging:SinkType"/>
+		   </xs:complexContent>
+	   </xs:complexType>
 
 	   <xs:complexType name="FileSinkType">
-		   <xs:attribute name="outputDir" use="required">
-			   <xs:simpleType>
-				   <xs:restriction base="xs:string">
-					   <xs:minLength value="1"/>
-				   </xs:restriction>
-			   </xs:simpleType>
-		   </xs:attribute>
+		   <xs:complexContent>
+			   <xs:extension base="logging:SinkType">
+				   <xs:attribute name="outputDir" use="required">
+					   <xs:simpleType>
+						   <xs:restriction base="xs:string">
+							   <xs:minLength value="1"/>
+						   </xs:restriction>
+					   </xs:simpleType>
+				   </xs:attribute>
+				   <xs:attribute name="fileName" type="xs:string"/>
+			   </xs:extension>
+		   </xs:complexContent>
 	   </xs:complexType>
 
-	   <xs:complexType name="RotatingFileSinkType">
+	   <xs:complexType name="TextFileSinkType">
 		   <xs:complexContent>
 			   <xs:extension base="logging:FileSinkType">
+				   <xs:attribute name="flushLevel" type="logging:LogLevelEnum"/>
+				   <xs:attribute name="flushRecords" type="xs:nonNegativeInteger"/>
+				   <xs:attribute name="flushInterval" type="xs:nonNegativeInteger"/>
+				   <xs:attribute name="flushSize" type="xs:nonNegativeInteger"/>
+				   <xs:attribute name="indexRecords" type="xs:nonNegativeInteger"/>
+				   <xs:attribute name="indexSize" type="xs:nonNegativeInteger"/>
+			   </xs:extension>
+		   </xs:complexContent>
+	   </xs:complexType>
+
+	   <xs:simpleType name="CompressionEnum">
+		   <xs:restriction base="xs:string">
+			   <xs:enumeration value="gzip"/>
+			   <xs:enumeration value="zstd"/>
+		   </xs:restriction>
+	   </xs:simpleType>
+
+	   <xs:complexType name="RotatingFileSinkType">
+		   <xs:complexContent>
+			   <xs:extension base="logging:TextFileSinkType">
 				   <xs:attribute name="maxSize" type="xs:integer" use="required"/>
 				   <xs:attribute name="maxNumFiles" type="xs:integer" use="required"/>
+				   <xs:attribute name="compress" type="logging:CompressionEnum"/>
+				   <xs:attribute name="compressionLevel" type="xs:integer"/>
+				   <xs:attribute name="maxTotalSize" type="xs:nonNegativeInteger"/>
+			   </xs:extension>
+		   </xs:complexContent>
+	   </xs:complexType>
+
+	   <xs:complexType name="BinaryFileSinkType">
+		   <xs:complexContent>
+			   <xs:extension base="logging:FileSinkType">
+				   <xs:attribute name="segmentSize" type="xs:positiveInteger"/>
+			   </xs:extension>
+		   </xs:complexContent>
+	   </xs:complexType>
+
+	   <xs:complexType name="UringFileSinkType">
+		   <xs:complexContent>
+			   <xs:extension base="logging:FileSinkType">
+				   <xs:attribute name="maxSize" type="xs:nonNegativeInteger"/>
+				   <xs:attribute name="maxNumFiles" type="xs:nonNegativeInteger"/>
+				   <xs:attribute name="queueDepth" type="xs:positiveInteger"/>
+				   <xs:attribute name="bufferSize" type="xs:positiveInteger"/>
+				   <xs:attribute name="flushLevel" type="logging:LogLevelEnum"/>
+			   </xs:extension>
+		   </xs:complexContent>
+	   </xs:complexType>
+
+	   <xs:complexType name="RingBufferSinkType">
+		   <xs:complexContent>
+			   <xs:extension base="logging:SinkType">
+				   <xs:attribute name="capacity" type="xs:positiveInteger"/>
+				   <xs:attribute name="recordSize" type="xs:positiveInteger"/>
 			   </xs:extension>
 		   </xs:complexContent>
 	   </xs:complexType>
 
 	   <xs:complexType name="SinksType">
+		   <xs:choice minOccurs="0" maxOccurs="unbounded">
+			   <xs:element name="ConsoleSink" type="logging:ConsoleSinkType"/>
+			   <xs:element name="SingleFileSink" type="logging:TextFileSinkType"/>
+			   <xs:element name="RotatingFileSink" type="logging:RotatingFileSinkType"/>
+			   <xs:element name="TimestampFileSink" type="logging:TextFileSinkType"/>
+			   <xs:element name="JsonSink" type="logging:TextFileSinkType"/>
+			   <xs:element name="BinaryFileSink" type="logging:BinaryFileSinkType"/>
+			   <xs:element name="UringFileSink" type="logging:UringFileSinkType"/>
+			   <xs:element name="RingBufferSink" type="logging:RingBufferSinkType"/>
+		   </xs:choice>
+	   </xs:complexType>
+
+	   <xs:complexType name="RouteType">
+		   <xs:attribute name="modules" type="logging:ModuleNameListType" use="required"/>
+		   <xs:attribute name="sinks" type="logging:SinkNameListType" use="required"/>
+	   </xs:complexType>
+
+	   <xs:complexType name="RoutesType">
+		   <xs:sequence>
+			   <xs:element name="Route" type="logging:RouteType" minOccurs="0" maxOccurs="unbounded"/>
+		   </xs:sequence>
+	   </xs:complexType>
+
+	   <xs:simpleType name="OverflowPolicyEnum">
+		   <xs:restriction base = "xs:string">
+			   <xs:enumeration value="block"/>
+			   <xs:enumeration value="dropNewest"/>
+			   <xs:enumeration value="dropOldest"/>
+		   </xs:restriction>
+	   </xs:simpleType>
+
+	   <xs:complexType name="AsyncType">
+		   <xs:attribute name="queueSize" type="xs:positiveInteger" use="required"/>
+		   <xs:attribute name="overflowPolicy" type="logging:OverflowPolicyEnum"/>
+		   <xs:attribute name="workerThreads" type="xs:positiveInteger">
+			   <xs:annotation>
+				   <xs:documentation>Workers write records concurrently, so with more than one worker the records of a thread may reach a sink out of order</xs:documentation>
+			   </xs:annotation>
+		   </xs:attribute>
+	   </xs:complexType>
+
+	   <xs:complexType name="CrashHandlerType">
+		   <xs:attribute name="dumpFile" use="required">
+			   <xs:simpleType>
+				   <xs:restriction base="xs:string">
+					   <xs:minLength value="1"/>
+				   </xs:restriction>
+			   </xs:simpleType>
+		   </xs:attribute>
+	   </xs:complexType>
+
+	   <xs:complexType name="CategoryType">
+		   <xs:attribute name="name" type="xs:string" use="required"/>
+		   <xs:attribute name="module" type="xs:string" use="required"/>
+	   </xs:complexType>
+
+	   <xs:complexType name="CategoriesType">
 		   <xs:sequence>
-			   <xs:element name="ConsoleSink" type="logging:ConsoleSinkType" minOccurs="0" maxOccurs="1"/>
-			   <xs:element name="SingleFileSink" type="logging:FileSinkType" minOccurs="0" maxOccurs="unbounded"/>
-			   <xs:element name="RotatingFileSink" type="logging:RotatingFileSinkType" minOccurs="0" maxOccurs="unbounded"/>
-			   <xs:element name="TimestampFileSink" type="logging:FileSinkType" minOccurs="0" maxOccurs="unbounded"/>
+			   <xs:element name="Category" type="logging:CategoryType" minOccurs="0" maxOccurs="unbounded"/>
 		   </xs:sequence>
 	   </xs:complexType>
 
@@ -86,6 +256,10 @@ constexpr const char* LOG_CONFIG_XSD = R"(<?xml version="1.0"?>
 		   <xs:sequence>
 			   <xs:element name="LogLevel" type="logging:LogLevelType"/>
 			   <xs:element name="Sinks" type="logging:SinksType" minOccurs="0"/>
+			   <xs:element name="Routes" type="logging:RoutesType" minOccurs="0"/>
+			   <xs:element name="Async" type="logging:AsyncType" minOccurs="0"/>
+			   <xs:element name="CrashHandler" type="logging:CrashHandlerType" minOccurs="0"/>
+			   <xs:element name="Categories" type="logging:CategoriesType" minOccurs="0"/>
 		   </xs:sequence>
 	   </xs:complexType>
 
@@ -109,6 +283,65 @@ Logger::Config::LogLevel logLevelFromString(const std::string& logLevelString) {
 	return logLevelIt->second;
 }
 
+const std::unordered_map<std::string, AsyncSink::OverflowPolicy> stringToOverflowPolicyMapping{
+	{"block", AsyncSink::OverflowPolicy::BLOCK},
+	{"dropNewest", AsyncSink::OverflowPolicy::DROP_NEWEST},
+	{"dropOldest", AsyncSink::OverflowPolicy::DROP_OLDEST}
+};
+
+AsyncSink::OverflowPolicy overflowPolicyFromString(const std::string& overflowPolicyString) {
+
+	auto overflowPolicyIt = stringToOverflowPolicyMapping.find(overflowPolicyString);
+	if (overflowPolicyIt == stringToOverflowPolicyMapping.end()) {
+		throw std::runtime_error(fmt::format("Unable to convert \"{}\" into an overflow policy", overflowPolicyString));
+	}
+	return overflowPolicyIt->second;
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+	std::vector<std::string> items;
+	std::istringstream iss(list);
+	std::string item;
+	while (iss >> item) {
+		items.push_back(item);
+	}
+	return items;
+}
+
+const std::unordered_map<std::string, CompressedRotatingFileSink::Compression> stringToCompressionMapping{
+	{"gzip", CompressedRotatingFileSink::Compression::GZIP},
+	{"zstd", CompressedRotatingFileSink::Compression::ZSTD}
+};
+
+CompressedRotatingFileSink::Compression compressionFromString(const std::string& compressionString) {
+
+	auto compressionIt = stringToCompressionMapping.find(compressionString);
+	if (compressionIt == stringToCompressionMapping.end()) {
+		throw std::runtime_error(fmt::format("Unable to convert \"{}\" into a compression", compressionString));
+	}
+	return compressionIt->second;
+}
+
+VectoredFileSink::FlushPolicy flushPolicyFromParameters(const Logger::Config::SinkParameterMap& parameters) {
+	const auto& defaultPolicy = VectoredFileSink::DEFAULT_FLUSH_POLICY;
+	const auto flushLevel = parameters.getParameter<std::string>("flushLevel");
+	const auto flushInterval = parameters.getParameter<size_t>("flushInterval");
+
+	return {
+		flushLevel ? logLevelFromString(*flushLevel) : defaultPolicy.mFlushLevel,
+		parameters.getParameter<size_t>("flushRecords").value_or(defaultPolicy.mMaxRecords),
+		flushInterval ? std::chrono::milliseconds(*flushInterval) : defaultPolicy.mInterval,
+		parameters.getParameter<size_t>("flushSize").value_or(defaultPolicy.mMaxBytes)
+	};
+}
+
+LogIndexWriter::Policy indexPolicyFromParameters(const Logger::Config::SinkParameterMap& parameters) {
+	return {
+		parameters.getParameter<size_t>("indexRecords").value_or(0),
+		parameters.getParameter<size_t>("indexSize").value_or(0)
+	};
+}
+
 std::string getBinaryName() {
 	return boost::dll::program_location().filename().string();
 }
@@ -132,81 +365,434 @@ Logger::Logger() {
 }
 
 void Logger::configure(const Config& config) {
+	std::lock_guard<std::mutex> configureLock(mConfigureMutex);
+
+	std::unordered_map<std::string, std::vector<std::string>> routedModulePatterns;
+	for (const auto& route: config.mRoutes) {
+		for (const auto& sinkName: route.mSinks) {
+			auto& modulePatterns = routedModulePatterns[sinkName];
+			modulePatterns.insert(modulePatterns.end(), route.mModules.begin(), route.mModules.end());
+		}
+	}
+
+	// Files of a reload are appended to, the sinks being replaced may still write their last records
+	const bool truncate = mConfiguredSinks.empty();
+	auto reusableSinks = mConfiguredSinks;
+
+	std::vector<ConfiguredSink> configuredSinks;
+	std::vector<SinkEntry> sinkEntries;
+	for (const auto& sinkDefinition: config.mSinks) {
+		const auto& parameters = sinkDefinition.mParameters;
+		const auto logLevel = parameters.getParameter<std::string>("level");
+		const auto pattern = parameters.getParameter<std::string>("pattern");
+		const auto sinkName = parameters.getParameter<std::string>("name");
+
+		auto sink = takeConfiguredSink(reusableSinks, sinkDefinition);
+		if (!sink) {
+			sink = createSink(sinkDefinition, truncate);
+			if (!sink) {
+				continue;
+			}
+			sink->set_formatter(createFormatter(pattern.value_or(LOG_PATTERN)));
+		}
+		sink->set_level(logLevel ? logLevelFromString(*logLevel) : LL_DEBUG);
+		configuredSinks.push_back({sinkDefinition, sink});
+
+		auto modulePatterns = splitList(parameters.getParameter<std::string>("modules").value_or(""));
+		if (sinkName) {
+			const auto it = routedModulePatterns.find(*sinkName);
+			if (it != routedModulePatterns.end()) {
+				modulePatterns.insert(modulePatterns.end(), it->second.begin(), it->second.end());
+			}
+		}
+
+		std::shared_ptr<const ModuleFilter> moduleFilter;
+		if (!modulePatterns.empty()) {
+			moduleFilter = std::make_shared<const ModuleFilter>(modulePatterns, true);
+		}
+		sinkEntries.push_back({sink, moduleFilter, modulePatterns});
+	}
+
+	std::shared_ptr<AsyncSink> asyncSink;
+	if (config.mAsync) {
+		std::vector<spdlog::sink_ptr> asyncTargets;
+		std::vector<std::shared_ptr<const ModuleFilter>> asyncTargetFilters;
+		std::vector<std::string> asyncModulePatterns;
+		auto asyncLogLevel = spdlog::level::level_enum::off;
+		bool asyncForAllModules = false;
+		for (const auto& sinkEntry: sinkEntries) {
+			asyncTargets.push_back(sinkEntry.mSink);
+			asyncTargetFilters.push_back(sinkEntry.mModuleFilter);
+			if (sinkEntry.mModuleFilter) {
+				asyncModulePatterns.insert(asyncModulePatterns.end(),
+						sinkEntry.mModulePatterns.begin(), sinkEntry.mModulePatterns.end());
+			} else {
+				asyncForAllModules = true;
+			}
+			asyncLogLevel = std::min(asyncLogLevel, sinkEntry.mSink->level());
+		}
+
+		asyncSink = std::make_shared<AsyncSink>(*config.mAsync, asyncTargets, asyncTargetFilters);
+		asyncSink->set_level(asyncLogLevel);
+		if (asyncForAllModules) {
+			asyncModulePatterns.clear();
+		}
+		std::shared_ptr<const ModuleFilter> asyncModuleFilter;
+		if (!asyncModulePatterns.empty()) {
+			asyncModuleFilter = std::make_shared<const ModuleFilter>(asyncModulePatterns, true);
+		}
+		sinkEntries = {{asyncSink, asyncModuleFilter, asyncModulePatterns}};
+	}
 
-	mModuleLogLevel = config.mModuleLogLevel;
+	// Replaced sinks are released only after the new snapshot is published and no
+	// logging thread uses the old one anymore; the async sink drains its queue then
+	std::vector<ConfiguredSink> retiredConfiguredSinks = std::move(mConfiguredSinks);
+	std::vector<SinkEntry> retiredSinkEntries;
+	std::shared_ptr<AsyncSink> retiredAsyncSink;
+	std::shared_ptr<const ModuleSnapshot> retiredSnapshot;
+	{
+		std::lock_guard<std::mutex> lock(mModulesMutex);
+		mDefaultLogLevel = config.mDefaultLogLevel;
+		mModuleLevelRules = ModuleLevelRules(config.mModuleLogLevel);
+		mModuleRateLimitRules = ModuleRateLimitRules(config.mModuleRateLimits);
+		mModuleSampleRateRules = ModuleSampleRateRules(config.mModuleSampleRates);
+		for (const auto& module: mModules) {
+			mModuleLogLevels[module->id()] = getModuleLogLevel(module->name());
+			module->rateLimiter().configure(getModuleRateLimit(module->name()));
+			module->sampler().setRate(getModuleSampleRate(module->name()));
+		}
+
+		for (const auto& sinkEntry: mConfigSinks) {
+			if (auto crashDumpSink = dynamic_cast<const CrashDumpSink*>(sinkEntry.mSink.get())) {
+				CrashHandler::unregisterSink(crashDumpSink);
+			}
+		}
+		for (const auto& sinkEntry: sinkEntries) {
+			if (auto crashDumpSink = dynamic_cast<const CrashDumpSink*>(sinkEntry.mSink.get())) {
+				CrashHandler::registerSink(crashDumpSink);
+			}
+		}
+
+		retiredSinkEntries = std::exchange(mConfigSinks, std::move(sinkEntries));
+		retiredAsyncSink = std::exchange(mAsyncSink, asyncSink);
+		mConfiguredSinks = std::move(configuredSinks);
+		retiredSnapshot = publishSnapshot();
+	}
+
+	// A crash handler installed with installCrashHandler() is left alone by configs without one
+	if (config.mCrashDumpFile) {
+		if (config.mCrashDumpFile != mCrashDumpFile) {
+			installCrashHandler(*config.mCrashDumpFile);
+		}
+		mCrashHandlerConfigured = true;
+	} else if (mCrashHandlerConfigured) {
+		uninstallCrashHandler();
+	}
+}
 
-	spdlog::set_level(config.mDefaultLogLevel);
-	spdlog::details::registry::instance().apply_all([this](auto logger) {
-		setModuleLogLevel(*logger);
+void Logger::watchConfigFile(const boost::filesystem::path& configFile, ConfigReader configReader) {
+	unwatchConfigFile();
+	mConfigWatcher = std::make_unique<ConfigWatcher>(configFile, [this, configFile, configReader]() {
+		reloadConfigFile(configFile, configReader);
 	});
+}
+
+void Logger::unwatchConfigFile() {
+	mConfigWatcher.reset();
+}
 
-	for (const auto sink: config.mSinks) {
-		if (sink.first == "ConsoleSink") {
-			createConsoleSink();
-		} else if (sink.first == "SingleFileSink") {
-			auto outputDir = sink.second.getParameter<std::string>("outputDir");
-			createSingleFileSink(*outputDir);
-		} else if (sink.first == "RotatingFileSink") {
-			auto outputDir = sink.second.getParameter<std::string>("outputDir");
-			auto maxSize = sink.second.getParameter<int>("maxSize");
-			auto maxNumFiles = sink.second.getParameter<int>("maxNumFiles");
-			createRotatingFileSink(*outputDir, *maxSize, *maxNumFiles);
-		} else if (sink.first == "TimestampFileSink") {
-			auto outputDir = sink.second.getParameter<std::string>("outputDir");
-			createTimestampFileSink(*outputDir);
+void Logger::reloadConfigFile(const boost::filesystem::path& configFile, const ConfigReader& configReader) {
+	try {
+		configure(configReader(configFile));
+		LOG(LM, LL_INFO, "Reloaded log config \"{}\"", configFile.string());
+	} catch (const std::exception& e) {
+		fmt::print(stderr, "[*** LOG ERROR ***] Unable to reload log config \"{}\", keeping the current one: {}\n",
+				configFile.string(), e.what());
+	}
+}
+
+spdlog::sink_ptr Logger::takeConfiguredSink(std::vector<ConfiguredSink>& configuredSinks,
+		const Config::SinkDefinition& sinkDefinition) {
+	// Level and module assignment are applied from outside, they don't require a new sink
+	const auto withoutRouting = [](const Config::SinkParameterMap& parameters) {
+		auto result = parameters;
+		result.erase("level");
+		result.erase("modules");
+		return result;
+	};
+
+	const auto parameters = withoutRouting(sinkDefinition.mParameters);
+	for (auto& configuredSink: configuredSinks) {
+		const auto& definition = configuredSink.mDefinition;
+		if (configuredSink.mSink && definition.mType == sinkDefinition.mType && withoutRouting(definition.mParameters) == parameters) {
+			return std::move(configuredSink.mSink);
 		}
 	}
+	return nullptr;
 }
 
-void Logger::setModuleLogLevel(spdlog::logger& logger) {
-	auto moduleSpecificLogLevelIt = mModuleLogLevel.find(logger.name());
-	if (moduleSpecificLogLevelIt != mModuleLogLevel.end()) {
-		logger.set_level(moduleSpecificLogLevelIt->second);
-	} else {
-		logger.set_level(spdlog::get_level());
+spdlog::sink_ptr Logger::createSink(const Config::SinkDefinition& sinkDefinition, bool truncate) {
+	const auto& type = sinkDefinition.mType;
+	const auto& parameters = sinkDefinition.mParameters;
+	const auto outputDir = parameters.getParameter<std::string>("outputDir");
+	const auto fileName = parameters.getParameter<std::string>("fileName").value_or(getBinaryName());
+
+	if (type == "ConsoleSink") {
+		return createConsoleSink();
+	} else if (type == "SingleFileSink") {
+		return createSingleFileSink(*outputDir, fileName, truncate, flushPolicyFromParameters(parameters),
+				indexPolicyFromParameters(parameters));
+	} else if (type == "RotatingFileSink") {
+		auto maxSize = parameters.getParameter<int>("maxSize");
+		auto maxNumFiles = parameters.getParameter<int>("maxNumFiles");
+		auto compress = parameters.getParameter<std::string>("compress");
+		if (compress) {
+			const auto compression = compressionFromString(*compress);
+			const auto defaultMaxTotalSize = static_cast<size_t>(*maxSize) * static_cast<size_t>(*maxNumFiles);
+			const CompressedRotatingFileSink::Parameters compressedParameters{
+				compression,
+				parameters.getParameter<int>("compressionLevel").value_or(CompressedRotatingFileSink::defaultLevel(compression)),
+				static_cast<size_t>(*maxSize),
+				parameters.getParameter<size_t>("maxTotalSize").value_or(defaultMaxTotalSize)
+			};
+			return createCompressedRotatingFileSink(*outputDir, fileName, compressedParameters, flushPolicyFromParameters(parameters),
+					indexPolicyFromParameters(parameters));
+		}
+		return createRotatingFileSink(*outputDir, fileName, *maxSize, *maxNumFiles, flushPolicyFromParameters(parameters),
+				indexPolicyFromParameters(parameters));
+	} else if (type == "TimestampFileSink") {
+		return createTimestampFileSink(*outputDir, fileName, flushPolicyFromParameters(parameters),
+				indexPolicyFromParameters(parameters));
+	} else if (type == "JsonSink") {
+		return createJsonSink(*outputDir, fileName, truncate, flushPolicyFromParameters(parameters),
+				indexPolicyFromParameters(parameters));
+	} else if (type == "BinaryFileSink") {
+		auto segmentSize = parameters.getParameter<size_t>("segmentSize");
+		return createBinaryFileSink(*outputDir, fileName, segmentSize.value_or(DEFAULT_BINARY_SEGMENT_SIZE));
+	} else if (type == "RingBufferSink") {
+		auto capacity = parameters.getParameter<size_t>("capacity");
+		auto recordSize = parameters.getParameter<size_t>("recordSize");
+		return createRingBufferSink(capacity.value_or(DEFAULT_RING_BUFFER_CAPACITY),
+				recordSize.value_or(DEFAULT_RING_BUFFER_RECORD_SIZE));
+	} else if (type == "UringFileSink") {
+		const auto& defaultParameters = UringFileSink::DEFAULT_PARAMETERS;
+		const auto flushLevel = parameters.getParameter<std::string>("flushLevel");
+		const UringFileSink::Parameters uringParameters{
+			parameters.getParameter<size_t>("queueDepth").value_or(defaultParameters.mQueueDepth),
+			parameters.getParameter<size_t>("bufferSize").value_or(defaultParameters.mBufferSize),
+			flushLevel ? logLevelFromString(*flushLevel) : defaultParameters.mFlushLevel
+		};
+		return createUringFileSink(*outputDir, fileName, truncate, parameters.getParameter<size_t>("maxSize").value_or(0),
+				parameters.getParameter<size_t>("maxNumFiles").value_or(0), uringParameters);
+	}
+	return nullptr;
+}
+
+Logger::Config::LogLevel Logger::getModuleLogLevel(const std::string& name) const {
+	return mModuleLevelRules.resolve(name).value_or(mDefaultLogLevel);
+}
+
+RateLimit Logger::getModuleRateLimit(const std::string& name) const {
+	return mModuleRateLimitRules.resolve(name).value_or(NO_RATE_LIMIT);
+}
+
+void Logger::setModuleRateLimit(Module& module, const RateLimit& rateLimit) {
+	std::lock_guard<std::mutex> lock(mModulesMutex);
+	module.rateLimiter().configure(rateLimit);
+}
+
+double Logger::getModuleSampleRate(const std::string& name) const {
+	return mModuleSampleRateRules.resolve(name).value_or(1.0);
+}
+
+void Logger::setModuleSampleRate(Module& module, double sampleRate) {
+	std::lock_guard<std::mutex> lock(mModulesMutex);
+	module.sampler().setRate(sampleRate);
+}
+
+void Logger::setModuleLogLevel(Module& module, Config::LogLevel logLevel) {
+	std::lock_guard<std::mutex> lock(mModulesMutex);
+	mModuleLogLevels[module.id()] = logLevel;
+	if (const auto snapshot = mModuleSnapshot.read()) {
+		applyModuleLogLevel(module, *snapshot);
+	}
+}
+
+std::shared_ptr<const ModuleSnapshot> Logger::publishSnapshot() {
+	auto snapshot = std::make_shared<ModuleSnapshot>();
+	snapshot->mSinks.resize(mModules.size());
+
+	for (const auto& module: mModules) {
+		auto& moduleSinks = snapshot->mSinks[module->id()];
+		for (const auto* sinkEntries: {&mConfigSinks, &mSinks}) {
+			for (const auto& sinkEntry: *sinkEntries) {
+				if (!sinkEntry.mModuleFilter || sinkEntry.mModuleFilter->matches(module->name())) {
+					// The async sink resolves the module's target sinks here, its workers don't filter
+					const bool async = sinkEntry.mSink == mAsyncSink;
+					moduleSinks.push_back(async ? mAsyncSink->createModuleRoute(module->name()) : sinkEntry.mSink);
+				}
+			}
+		}
+	}
+
+	// Levels are stored before the sinks they belong to are published, see ModuleSnapshot
+	for (const auto& module: mModules) {
+		applyModuleLogLevel(*module, *snapshot);
+	}
+	return mModuleSnapshot.update(snapshot);
+}
+
+void Logger::applyModuleLogLevel(Module& module, const ModuleSnapshot& snapshot) {
+	// Records no attached sink accepts are rejected by the level check, before any formatting
+	auto logLevel = mModuleLogLevels[module.id()];
+	const auto& moduleSinks = snapshot.getSinks(module.id());
+	if (!moduleSinks.empty()) {
+		auto lowestSinkLogLevel = spdlog::level::level_enum::off;
+		for (const auto& sink: moduleSinks) {
+			lowestSinkLogLevel = std::min(lowestSinkLogLevel, sink->level());
+		}
+		logLevel = std::max(logLevel, lowestSinkLogLevel);
 	}
+	mModuleLevelTable.setLevel(module.id(), logLevel);
+	module.set_level(logLevel);
 }
 
 void Logger::addSink(spdlog::sink_ptr sink) {
-	sink->set_pattern(LOG_PATTERN);
+	sink->set_formatter(createFormatter(LOG_PATTERN));
 	sink->set_level(spdlog::level::level_enum::debug);
-	attachSinkToLoggers(sink);
+
+	std::shared_ptr<const ModuleSnapshot> retiredSnapshot;
+	std::lock_guard<std::mutex> lock(mModulesMutex);
+	mSinks.push_back({sink, nullptr, {}});
+	if (auto crashDumpSink = dynamic_cast<const CrashDumpSink*>(sink.get())) {
+		CrashHandler::registerSink(crashDumpSink);
+	}
+	retiredSnapshot = publishSnapshot();
 }
 
 void Logger::removeAllSinks() {
-	mSinks.clear();
+	std::lock_guard<std::mutex> configureLock(mConfigureMutex);
+
+	std::vector<ConfiguredSink> retiredConfiguredSinks = std::move(mConfiguredSinks);
+	std::vector<SinkEntry> retiredSinkEntries;
+	std::vector<SinkEntry> retiredConfigSinkEntries;
+	std::shared_ptr<AsyncSink> retiredAsyncSink;
+	std::shared_ptr<const ModuleSnapshot> retiredSnapshot;
+	{
+		std::lock_guard<std::mutex> lock(mModulesMutex);
+		for (const auto* sinkEntries: {&mConfigSinks, &mSinks}) {
+			for (const auto& sinkEntry: *sinkEntries) {
+				if (auto crashDumpSink = dynamic_cast<const CrashDumpSink*>(sinkEntry.mSink.get())) {
+					CrashHandler::unregisterSink(crashDumpSink);
+				}
+			}
+		}
+		retiredSinkEntries = std::move(mSinks);
+		retiredConfigSinkEntries = std::move(mConfigSinks);
+		mSinks.clear();
+		mConfigSinks.clear();
+		retiredAsyncSink = std::move(mAsyncSink);
+		retiredSnapshot = publishSnapshot();
+	}
+}
 
-	spdlog::details::registry::instance().apply_all([](auto logger) {
-		logger->sinks().clear();
-	});
+void Logger::installCrashHandler(const boost::filesystem::path& dumpFile) {
+	uninstallCrashHandler();
+
+	if (dumpFile.has_parent_path()) {
+		boost::filesystem::create_directories(dumpFile.parent_path());
+	}
+	mCrashDumpFd = ::open(dumpFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (mCrashDumpFd < 0) {
+		throw std::runtime_error(fmt::format("Unable to open crash dump file \"{}\"", dumpFile.string()));
+	}
+	CrashHandler::install(mCrashDumpFd);
+	mCrashDumpFile = dumpFile.string();
 }
 
-void Logger::createConsoleSink() {
-	addSink(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
+void Logger::uninstallCrashHandler() {
+	if (mCrashDumpFd >= 0) {
+		CrashHandler::uninstall();
+		::close(mCrashDumpFd);
+		mCrashDumpFd = -1;
+		mCrashDumpFile = boost::none;
+	}
+	mCrashHandlerConfigured = false;
 }
 
-void Logger::createSingleFileSink(const boost::filesystem::path& outputDir) {
-	auto filePath = outputDir / fmt::format("{}.log", getBinaryName());
-	addSink(std::make_shared<spdlog::sinks::basic_file_sink_mt>(filePath.string(), true));
+boost::optional<AsyncSink::Statistics> Logger::getAsyncStatistics() const {
+	if (mAsyncSink) {
+		return mAsyncSink->getStatistics();
+	} else {
+		return boost::none;
+	}
 }
 
-void Logger::createRotatingFileSink(const boost::filesystem::path& outputDir, size_t maxSize, int maxNumFiles) {
-	auto filePath = outputDir / fmt::format("{}.rotating.log", getBinaryName());
-	addSink(std::make_shared<spdlog::sinks::rotating_file_sink_mt>(filePath.string(), maxSize, maxNumFiles));
+spdlog::sink_ptr Logger::createConsoleSink() {
+	return std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
 }
 
-void Logger::createTimestampFileSink(const boost::filesystem::path& outputDir) {
-	auto filePath = outputDir / fmt::format("{}_{}.log", getTimestampPrefix(), getBinaryName());
-	addSink(std::make_shared<spdlog::sinks::basic_file_sink_mt>(filePath.string(), true));
+spdlog::sink_ptr Logger::createSingleFileSink(const boost::filesystem::path& outputDir, const std::string& fileName,
+		bool truncate, const VectoredFileSink::FlushPolicy& flushPolicy, const LogIndexWriter::Policy& indexPolicy) {
+	auto filePath = outputDir / fmt::format("{}.log", fileName);
+	return std::make_shared<VectoredFileSink>(filePath, truncate, flushPolicy, 0, 0, indexPolicy);
 }
 
-void Logger::attachSinkToLoggers(std::shared_ptr<spdlog::sinks::sink> sink) {
+spdlog::sink_ptr Logger::createRotatingFileSink(const boost::filesystem::path& outputDir, const std::string& fileName,
+		size_t maxSize, int maxNumFiles, const VectoredFileSink::FlushPolicy& flushPolicy, const LogIndexWriter::Policy& indexPolicy) {
+	auto filePath = outputDir / fmt::format("{}.rotating.log", fileName);
+	return std::make_shared<VectoredFileSink>(filePath, false, flushPolicy, maxSize, maxNumFiles, indexPolicy);
+}
 
-	mSinks.push_back(sink);
+spdlog::sink_ptr Logger::createCompressedRotatingFileSink(const boost::filesystem::path& outputDir, const std::string& fileName,
+		CompressedRotatingFileSink::Parameters parameters, const VectoredFileSink::FlushPolicy& flushPolicy,
+		const LogIndexWriter::Policy& indexPolicy) {
+	auto filePath = outputDir / fmt::format("{}.rotating.log", fileName);
+	if (!CompressedRotatingFileSink::isSupported(parameters.mCompression)) {
+		fmt::print(stderr, "[*** LOG ERROR ***] zstd compression is not available, falling back to gzip\n");
+		parameters.mCompression = CompressedRotatingFileSink::Compression::GZIP;
+		parameters.mLevel = CompressedRotatingFileSink::defaultLevel(parameters.mCompression);
+	}
+	return std::make_shared<CompressedRotatingFileSink>(filePath, parameters, flushPolicy, indexPolicy);
+}
 
-	spdlog::details::registry::instance().apply_all([sink](auto logger) {
-		logger->sinks().push_back(sink);
-	});
+spdlog::sink_ptr Logger::createTimestampFileSink(const boost::filesystem::path& outputDir, const std::string& fileName,
+		const VectoredFileSink::FlushPolicy& flushPolicy, const LogIndexWriter::Policy& indexPolicy) {
+	auto filePath = outputDir / fmt::format("{}_{}.log", getTimestampPrefix(), fileName);
+	return std::make_shared<VectoredFileSink>(filePath, true, flushPolicy, 0, 0, indexPolicy);
+}
+
+spdlog::sink_ptr Logger::createJsonSink(const boost::filesystem::path& outputDir, const std::string& fileName,
+		bool truncate, const VectoredFileSink::FlushPolicy& flushPolicy, const LogIndexWriter::Policy& indexPolicy) {
+	auto filePath = outputDir / fmt::format("{}.ndjson", fileName);
+	return std::make_shared<JsonSink>(filePath, truncate, flushPolicy, 0, 0, indexPolicy);
+}
+
+spdlog::sink_ptr Logger::createBinaryFileSink(const boost::filesystem::path& outputDir, const std::string& fileName,
+		size_t segmentSize) {
+	auto baseName = fmt::format("{}_{}", getTimestampPrefix(), fileName);
+	return std::make_shared<BinaryFileSink>(outputDir, baseName, segmentSize);
+}
+
+spdlog::sink_ptr Logger::createRingBufferSink(size_t capacity, size_t recordSize) {
+	return std::make_shared<RingBufferSink>(capacity, recordSize);
+}
+
+spdlog::sink_ptr Logger::createUringFileSink(const boost::filesystem::path& outputDir, const std::string& fileName,
+		bool truncate, size_t maxSize, size_t maxNumFiles, const UringFileSink::Parameters& parameters) {
+	auto filePath = outputDir / fmt::format("{}.uring.log", fileName);
+	if (UringFileSink::isSupported()) {
+		try {
+			return std::make_shared<UringFileSink>(filePath, truncate, parameters, maxSize, maxNumFiles);
+		} catch (const spdlog::spdlog_ex& e) {
+			fmt::print(stderr, "[*** LOG ERROR ***] {}, falling back to regular file sink\n", e.what());
+		}
+	}
+
+	// The regular file sink path is VectoredFileSink, it replaced basic_file_sink_mt for all file sinks
+	auto flushPolicy = VectoredFileSink::DEFAULT_FLUSH_POLICY;
+	flushPolicy.mFlushLevel = parameters.mFlushLevel;
+	return std::make_shared<VectoredFileSink>(filePath, truncate, flushPolicy, maxSize, maxNumFiles);
 }
 
 Logger& Logger::instance(){
@@ -214,13 +800,25 @@ Logger& Logger::instance(){
 	return logger;
 }
 
-std::shared_ptr<spdlog::logger> Logger::addModule(const std::string& name) {
-	auto logger = std::make_shared<spdlog::logger>(name);
-	logger->set_pattern(LOG_PATTERN);
-	logger->sinks() = Logger::instance().mSinks;
-	Logger::instance().setModuleLogLevel(*logger);
-	spdlog::register_logger(logger);
-	return logger;
+std::shared_ptr<Module> Logger::addModule(const std::string& name) {
+	Logger& logger = Logger::instance();
+	std::lock_guard<std::mutex> lock(logger.mModulesMutex);
+
+	const auto logLevel = logger.getModuleLogLevel(name);
+	const auto id = logger.mModuleLevelTable.allocate(logLevel);
+	auto module = std::make_shared<Module>(name, id, logger.mModuleLevelTable.getLevelSlot(id), logger.mModuleSnapshot);
+	module->set_formatter(createFormatter(LOG_PATTERN));
+	module->rateLimiter().configure(logger.getModuleRateLimit(name));
+	module->sampler().setRate(logger.getModuleSampleRate(name));
+	logger.mModuleLogLevels.push_back(logLevel);
+	logger.mModules.push_back(module);
+	logger.publishSnapshot();
+	spdlog::register_logger(module);
+	return module;
+}
+
+const char* Logger::getLogPattern() {
+	return LOG_PATTERN;
 }
 
 const char* Logger::Config::getXsdSchema() {
@@ -233,26 +831,97 @@ Logger::Config Logger::Config::readConfig(const SimpleXercesc::XmlElement& logEl
 	auto defaultLogLevel = logLevelFromString(*logLevelElem->getAttributeByName<std::string>("defaultLogLevel"));
 
 	ModuleLogLevelMap moduleLogLevelsMap;
+	ModuleRateLimitMap moduleRateLimitMap;
+	ModuleSampleRateMap moduleSampleRateMap;
 	auto moduleLogLevelElemVector = logLevelElem->getChildElementsByTag("Module");
 	for (const auto moduleLogLevelElem: moduleLogLevelElemVector) {
 		const auto moduleName = *moduleLogLevelElem.getAttributeByName<std::string>("name");
-		const auto moduleLogLevel = logLevelFromString(*moduleLogLevelElem.getAttributeByName<std::string>("logLevel"));
-		moduleLogLevelsMap.emplace(moduleName, moduleLogLevel);
+		const auto moduleLogLevel = moduleLogLevelElem.getAttributeByName<std::string>("logLevel");
+		if (moduleLogLevel) {
+			moduleLogLevelsMap.emplace(moduleName, logLevelFromString(*moduleLogLevel));
+		}
+
+		const auto maxRate = moduleLogLevelElem.getAttributeByName<double>("maxRate");
+		const auto maxRepeats = moduleLogLevelElem.getAttributeByName<uint32_t>("maxRepeats");
+		if (maxRate || maxRepeats) {
+			const auto defaultBurst = static_cast<uint32_t>(std::ceil(maxRate.value_or(1.0)));
+			moduleRateLimitMap.emplace(moduleName, RateLimit{
+				maxRate.value_or(0.0),
+				moduleLogLevelElem.getAttributeByName<uint32_t>("burst").value_or(defaultBurst),
+				maxRepeats.value_or(0)
+			});
+		}
+
+		const auto sampleRate = moduleLogLevelElem.getAttributeByName<double>("sampleRate");
+		if (sampleRate) {
+			moduleSampleRateMap.emplace(moduleName, *sampleRate);
+		}
 	}
 
-	SinkMap sinksMap;
+	SinkList sinkList;
 	auto sinksElem = logElem.getFirstChildElementByTag("Sinks");
 	auto sinksElemVec = sinksElem->getChildElements();
 	for (const auto sinksElem: sinksElemVec) {
-		const auto sinkName = sinksElem.getTagName();
+		const auto sinkType = sinksElem.getTagName();
 		const auto sinkAttributes = sinksElem.getAttributes();
-		sinksMap.emplace(sinkName, SinkParameterMap(sinkAttributes));
+		sinkList.push_back({sinkType, SinkParameterMap(sinkAttributes)});
+	}
+
+	RouteList routeList;
+	auto routesElem = logElem.getFirstChildElementByTag("Routes");
+	if (routesElem) {
+		for (const auto routeElem: routesElem->getChildElementsByTag("Route")) {
+			Route route{
+				splitList(*routeElem.getAttributeByName<std::string>("modules")),
+				splitList(*routeElem.getAttributeByName<std::string>("sinks"))
+			};
+			for (const auto& sinkName: route.mSinks) {
+				const bool sinkDefined = std::any_of(sinkList.begin(), sinkList.end(), [&sinkName](const auto& sink) {
+					return sink.mParameters.count("name") && sink.mParameters.at("name") == sinkName;
+				});
+				if (!sinkDefined) {
+					throw std::runtime_error(fmt::format("Log route references unknown sink \"{}\"", sinkName));
+				}
+			}
+			routeList.push_back(route);
+		}
+	}
+
+	boost::optional<AsyncParameters> asyncParameters;
+	auto asyncElem = logElem.getFirstChildElementByTag("Async");
+	if (asyncElem) {
+		asyncParameters = AsyncParameters{
+			*asyncElem->getAttributeByName<size_t>("queueSize"),
+			overflowPolicyFromString(asyncElem->getAttributeByName<std::string>("overflowPolicy").value_or("block")),
+			asyncElem->getAttributeByName<size_t>("workerThreads").value_or(1)
+		};
+	}
+
+	boost::optional<std::string> crashDumpFile;
+	auto crashHandlerElem = logElem.getFirstChildElementByTag("CrashHandler");
+	if (crashHandlerElem) {
+		crashDumpFile = crashHandlerElem->getAttributeByName<std::string>("dumpFile");
+	}
+
+	CategoryModuleMap categoryModuleMap;
+	auto categoriesElem = logElem.getFirstChildElementByTag("Categories");
+	if (categoriesElem) {
+		for (const auto categoryElem: categoriesElem->getChildElementsByTag("Category")) {
+			categoryModuleMap[*categoryElem.getAttributeByName<std::string>("name")] =
+					*categoryElem.getAttributeByName<std::string>("module");
+		}
 	}
 
 	return {
 		defaultLogLevel,
 		moduleLogLevelsMap,
-		sinksMap
+		sinkList,
+		routeList,
+		asyncParameters,
+		crashDumpFile,
+		categoryModuleMap,
+		moduleRateLimitMap,
+		moduleSampleRateMap
 	};
 }
 
@@ -1,5 +1,16 @@
 // Copyright (C) 2021 twyleg
 #pragma once
+#include "async_sink.h"
+#include "compressed_rotating_file_sink.h"
+#include "config_watcher.h"
+#include "deferred.h"
+#include "level.h"
+#include "module.h"
+#include "module_rules.h"
+#include "structured.h"
+#include "uring_file_sink.h"
+#include "vectored_file_sink.h"
+
 #include <simple_xercesc/xml_element.h>
 
 #include <spdlog/spdlog.h>
@@ -7,14 +18,20 @@
 
 #include <boost/filesystem.hpp>
 
+#include <functional>
 #include <iosfwd>
+#include <memory>
+
+#define LOG(logModule, logLevel, format, ...) \
+	do { \
+		if constexpr (LOGGING_LEVEL_ACTIVE(logLevel)) { \
+			static Logging::LogCallSite logCallSite{__FILE__, __LINE__}; \
+			if (Logging::shouldLog(*logModule, logLevel) && Logging::admit(*logModule, logLevel, &logCallSite)) { \
+				logModule->log(logLevel, FMT_STRING(format), ##__VA_ARGS__); \
+			} \
+		} \
+	} while (0)
 
-#define LL_DEBUG spdlog::level::level_enum::debug
-#define LL_INFO spdlog::level::level_enum::info
-#define LL_WARN spdlog::level::level_enum::warn
-#define LL_ERROR spdlog::level::level_enum::err
-
-#define LOG(logModule, logLevel, ...) logModule->log(logLevel, __VA_ARGS__)
 #define FLUSH(logModule) logModule->flush()
 
 
@@ -47,39 +64,130 @@ public:
 
 		using LogLevel = spdlog::level::level_enum;
 		using ModuleLogLevelMap = std::unordered_map<std::string, LogLevel>;
-		using SinkMap = std::unordered_map<std::string, SinkParameterMap>;
+
+		struct SinkDefinition {
+			std::string mType;
+			SinkParameterMap mParameters;
+		};
+
+		using SinkList = std::vector<SinkDefinition>;
+
+		struct Route {
+			std::vector<std::string> mModules;
+			std::vector<std::string> mSinks;
+		};
+
+		using RouteList = std::vector<Route>;
+		using AsyncParameters = AsyncSink::Parameters;
+
+		// Names of foreign log categories (e.g. QLoggingCategory) mapped to module names
+		using CategoryModuleMap = std::unordered_map<std::string, std::string>;
+		using ModuleRateLimitMap = std::unordered_map<std::string, RateLimit>;
+		using ModuleSampleRateMap = std::unordered_map<std::string, double>;
 
 		static Config readConfig(const SimpleXercesc::XmlElement& logElem);
 		static const char* getXsdSchema();
 
 		const LogLevel mDefaultLogLevel;
 		const ModuleLogLevelMap mModuleLogLevel;
-		const SinkMap mSinks;
+		const SinkList mSinks;
+		const RouteList mRoutes;
+		const boost::optional<AsyncParameters> mAsync;
+		const boost::optional<std::string> mCrashDumpFile;
+		const CategoryModuleMap mCategoryModules;
+		const ModuleRateLimitMap mModuleRateLimits;
+		const ModuleSampleRateMap mModuleSampleRates;
 
 	};
 
+	using ConfigReader = std::function<Config(const boost::filesystem::path&)>;
+
 	Logger();
+
+	// Replaces the previously configured sinks and levels. Sinks whose definition did
+	// not change are kept open; sinks added with addSink() stay attached.
 	void configure(const Config&);
 
+	void watchConfigFile(const boost::filesystem::path& configFile, ConfigReader);
+	void unwatchConfigFile();
+
 	void addSink(spdlog::sink_ptr);
 	void removeAllSinks();
 
+	void setModuleLogLevel(Module&, Config::LogLevel);
+	// Overrides the configured rate limit of the module until the next configure()
+	void setModuleRateLimit(Module&, const RateLimit&);
+	// Fraction of the module's Debug records to keep until the next configure()
+	void setModuleSampleRate(Module&, double sampleRate);
+
+	void installCrashHandler(const boost::filesystem::path& dumpFile);
+	void uninstallCrashHandler();
+
+	boost::optional<AsyncSink::Statistics> getAsyncStatistics() const;
+
 	static Logger& instance();
-	static std::shared_ptr<spdlog::logger> addModule(const std::string& name);
+	static const char* getLogPattern();
+	static std::shared_ptr<Module> addModule(const std::string& name);
 
 private:
 
-	void setModuleLogLevel(spdlog::logger&);
-
-	void createConsoleSink();
-	void createSingleFileSink(const boost::filesystem::path&);
-	void createRotatingFileSink(const boost::filesystem::path&, size_t, int maxNumFiles);
-	void createTimestampFileSink(const boost::filesystem::path&);
-	void attachSinkToLoggers(std::shared_ptr<spdlog::sinks::sink> sink);
+	struct SinkEntry {
+		spdlog::sink_ptr mSink;
+		std::shared_ptr<const ModuleFilter> mModuleFilter;
+		std::vector<std::string> mModulePatterns;
+	};
 
-	std::unordered_map<std::string, Config::LogLevel> mModuleLogLevel;
-	std::vector<std::shared_ptr<spdlog::sinks::sink>> mSinks;
+	struct ConfiguredSink {
+		Config::SinkDefinition mDefinition;
+		spdlog::sink_ptr mSink;
+	};
 
+	Config::LogLevel getModuleLogLevel(const std::string& name) const;
+	RateLimit getModuleRateLimit(const std::string& name) const;
+	double getModuleSampleRate(const std::string& name) const;
+	std::shared_ptr<const ModuleSnapshot> publishSnapshot();
+	void applyModuleLogLevel(Module&, const ModuleSnapshot&);
+	static spdlog::sink_ptr takeConfiguredSink(std::vector<ConfiguredSink>&, const Config::SinkDefinition&);
+	void reloadConfigFile(const boost::filesystem::path&, const ConfigReader&);
+
+	spdlog::sink_ptr createSink(const Config::SinkDefinition&, bool truncate);
+	spdlog::sink_ptr createConsoleSink();
+	spdlog::sink_ptr createSingleFileSink(const boost::filesystem::path&, const std::string& fileName, bool truncate,
+			const VectoredFileSink::FlushPolicy&, const LogIndexWriter::Policy&);
+	spdlog::sink_ptr createRotatingFileSink(const boost::filesystem::path&, const std::string& fileName, size_t, int maxNumFiles,
+			const VectoredFileSink::FlushPolicy&, const LogIndexWriter::Policy&);
+	spdlog::sink_ptr createCompressedRotatingFileSink(const boost::filesystem::path&, const std::string& fileName,
+			CompressedRotatingFileSink::Parameters, const VectoredFileSink::FlushPolicy&, const LogIndexWriter::Policy&);
+	spdlog::sink_ptr createJsonSink(const boost::filesystem::path&, const std::string& fileName, bool truncate,
+			const VectoredFileSink::FlushPolicy&, const LogIndexWriter::Policy&);
+	spdlog::sink_ptr createTimestampFileSink(const boost::filesystem::path&, const std::string& fileName,
+			const VectoredFileSink::FlushPolicy&, const LogIndexWriter::Policy&);
+	spdlog::sink_ptr createRingBufferSink(size_t capacity, size_t recordSize);
+	spdlog::sink_ptr createUringFileSink(const boost::filesystem::path&, const std::string& fileName, bool truncate,
+			size_t maxSize, size_t maxNumFiles, const UringFileSink::Parameters&);
+	spdlog::sink_ptr createBinaryFileSink(const boost::filesystem::path&, const std::string& fileName, size_t segmentSize);
+
+	std::mutex mConfigureMutex;
+	std::vector<ConfiguredSink> mConfiguredSinks;
+	boost::optional<std::string> mCrashDumpFile;
+	bool mCrashHandlerConfigured = false;
+
+	Config::LogLevel mDefaultLogLevel = LL_DEBUG;
+	ModuleLevelRules mModuleLevelRules;
+	ModuleRateLimitRules mModuleRateLimitRules;
+	ModuleSampleRateRules mModuleSampleRateRules;
+	std::vector<SinkEntry> mSinks;
+	std::vector<SinkEntry> mConfigSinks;
+
+	std::mutex mModulesMutex;
+	ModuleLevelTable mModuleLevelTable;
+	ModuleSnapshotPointer mModuleSnapshot;
+	std::vector<std::shared_ptr<Module>> mModules;
+	std::vector<Config::LogLevel> mModuleLogLevels;
+	std::shared_ptr<AsyncSink> mAsyncSink;
+	int mCrashDumpFd = -1;
+
+	std::unique_ptr<ConfigWatcher> mConfigWatcher;
 
 };
 
@@ -118,11 +226,28 @@ Stream& operator<<(Stream& os, const Logger::Config& config) {
 	} else {
 		os  << std::endl << "none";
 	}
+	os << std::endl << "  Module rate limits:";
+	if (config.mModuleRateLimits.size()) {
+		for (const auto& [moduleName, rateLimit]: config.mModuleRateLimits) {
+			os << std::endl << "    \"" << moduleName << "\": maxRate=" << rateLimit.mMaxRate
+			   << " burst=" << rateLimit.mBurst << " maxRepeats=" << rateLimit.mMaxRepeats;
+		}
+	} else {
+		os  << std::endl << "none";
+	}
+	os << std::endl << "  Module sample rates:";
+	if (config.mModuleSampleRates.size()) {
+		for (const auto& [moduleName, sampleRate]: config.mModuleSampleRates) {
+			os << std::endl << "    \"" << moduleName << "\": " << sampleRate;
+		}
+	} else {
+		os  << std::endl << "none";
+	}
 	os << std::endl << "  Sinks:";
 	if (config.mSinks.size()) {
-		for (const auto sink: config.mSinks) {
-			os << std::endl << "    " << sink.first << ": ";
-			const Logger::Config::SinkParameterMap& sinkParameterMap = sink.second;
+		for (const auto& sink: config.mSinks) {
+			os << std::endl << "    " << sink.mType << ": ";
+			const Logger::Config::SinkParameterMap& sinkParameterMap = sink.mParameters;
 			if (sinkParameterMap.size()) {
 				for (const auto parameterMap: sinkParameterMap) {
 					os << "\"" << parameterMap.first << "\":\"" << parameterMap.second << "\" ";
@@ -134,6 +259,38 @@ Stream& operator<<(Stream& os, const Logger::Config& config) {
 	} else {
 		os  << std::endl << "none";
 	}
+	os << std::endl << "  Routes:";
+	if (config.mRoutes.size()) {
+		for (const auto& route: config.mRoutes) {
+			os << std::endl << "    ";
+			for (const auto& module: route.mModules) {
+				os << "\"" << module << "\" ";
+			}
+			os << "->";
+			for (const auto& sink: route.mSinks) {
+				os << " \"" << sink << "\"";
+			}
+		}
+	} else {
+		os  << std::endl << "none";
+	}
+	os << std::endl << "  Async:";
+	if (config.mAsync) {
+		os << " queueSize=" << config.mAsync->mQueueSize
+		   << " overflowPolicy=" << config.mAsync->mOverflowPolicy
+		   << " workerThreads=" << config.mAsync->mWorkerThreads;
+	} else {
+		os << " disabled";
+	}
+	os << std::endl << "  Crash handler: " << config.mCrashDumpFile.value_or("disabled");
+	os << std::endl << "  Categories:";
+	if (config.mCategoryModules.size()) {
+		for (const auto& categoryModule: config.mCategoryModules) {
+			os << std::endl << "    \"" << categoryModule.first << "\" -> \"" << categoryModule.second << "\"";
+		}
+	} else {
+		os  << std::endl << "none";
+	}
 
 	return os;
 }
@@ -0,0 +1,92 @@
+// Copyright (C) 2021 twyleg
+#include "module.h"
+#include "crash_handler.h"
+
+#include <spdlog/sinks/sink.h>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <stdexcept>
+
+namespace Logging {
+
+ModuleLevelTable::ModuleLevelTable() {
+	for (auto& level: mLevels) {
+		level.store(static_cast<uint8_t>(spdlog::level::level_enum::off), std::memory_order_relaxed);
+	}
+}
+
+ModuleId ModuleLevelTable::allocate(spdlog::level::level_enum level) {
+	if (mSize == mLevels.size()) {
+		throw std::runtime_error(fmt::format("Unable to add more than {} log modules", mLevels.size()));
+	}
+	const auto id = static_cast<ModuleId>(mSize++);
+	setLevel(id, level);
+	return id;
+}
+
+std::vector<spdlog::sink_ptr> Module::getSinks() const {
+	std::vector<spdlog::sink_ptr> sinks;
+	forEachSink([&sinks](const spdlog::sink_ptr& sink) {
+		sinks.push_back(sink);
+	});
+	return sinks;
+}
+
+bool Module::admitLimited(spdlog::level::level_enum level, LogCallSite* callSite) {
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+	const auto admission = mRateLimiter.admit(callSite, std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+	if (!admission.mAdmitted) {
+		return false;
+	}
+
+	if (admission.mSuppressedRepeats) {
+		log(level, "Suppressed {} repeated messages from {}:{}", admission.mSuppressedRepeats, callSite->mFile, callSite->mLine);
+	}
+	if (admission.mSuppressedByRate) {
+		log(level, "Suppressed {} messages exceeding the rate limit of the module", admission.mSuppressedByRate);
+	}
+	return true;
+}
+
+void Module::sink_it_(const spdlog::details::log_msg& msg) {
+	CrashHandler::prepareThread();
+
+	const auto snapshot = mSnapshot.read();
+	if (!snapshot) {
+		return;
+	}
+
+	for (const auto& sink: snapshot->getSinks(mId)) {
+		if (sink->should_log(msg.level)) {
+			try {
+				sink->log(msg);
+			} catch (const std::exception& e) {
+				err_handler_(e.what());
+			}
+		}
+	}
+
+	if (should_flush_(msg)) {
+		for (const auto& sink: snapshot->getSinks(mId)) {
+			try {
+				sink->flush();
+			} catch (const std::exception& e) {
+				err_handler_(e.what());
+			}
+		}
+	}
+}
+
+void Module::flush_() {
+	forEachSink([this](const spdlog::sink_ptr& sink) {
+		try {
+			sink->flush();
+		} catch (const std::exception& e) {
+			err_handler_(e.what());
+		}
+	});
+}
+
+}
@@ -0,0 +1,136 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "rate_limiter.h"
+#include "rcu.h"
+#include "sampler.h"
+
+#include <spdlog/logger.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef LOGGING_MAX_MODULES
+#define LOGGING_MAX_MODULES 4096
+#endif
+
+namespace Logging {
+
+using ModuleId = uint32_t;
+
+class ModuleLevelTable {
+
+public:
+
+	ModuleLevelTable();
+
+	ModuleId allocate(spdlog::level::level_enum);
+
+	void setLevel(ModuleId id, spdlog::level::level_enum level) {
+		mLevels[id].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+	}
+
+	spdlog::level::level_enum getLevel(ModuleId id) const {
+		return static_cast<spdlog::level::level_enum>(mLevels[id].load(std::memory_order_relaxed));
+	}
+
+	const std::atomic<uint8_t>& getLevelSlot(ModuleId id) const { return mLevels[id]; }
+	size_t size() const { return mSize; }
+
+private:
+
+	alignas(64) std::array<std::atomic<uint8_t>, LOGGING_MAX_MODULES> mLevels;
+	size_t mSize = 0;
+};
+
+// Sinks of all modules, published as a whole by the Logger. A module only ever logs
+// through one snapshot, so it never sees a half-applied sink config. The module levels
+// in the ModuleLevelTable are stored one by one before the snapshot is published, so
+// for a moment records may pass a new level check and still go to the old sinks, which
+// apply their own levels.
+struct ModuleSnapshot {
+
+	using SinkList = std::vector<spdlog::sink_ptr>;
+
+	const SinkList& getSinks(ModuleId id) const {
+		static const SinkList noSinks;
+		return id < mSinks.size() ? mSinks[id] : noSinks;
+	}
+
+	std::vector<SinkList> mSinks;
+};
+
+using ModuleSnapshotPointer = RcuPointer<ModuleSnapshot>;
+
+class Module : public spdlog::logger {
+
+public:
+
+	Module(const std::string& name, ModuleId id, const std::atomic<uint8_t>& levelSlot,
+			const ModuleSnapshotPointer& snapshot)
+		: spdlog::logger(name),
+		  mId(id),
+		  mLevel(levelSlot),
+		  mSnapshot(snapshot)
+	{}
+
+	ModuleId id() const { return mId; }
+
+	bool shouldLog(spdlog::level::level_enum level) const {
+		return static_cast<uint8_t>(level) >= mLevel.load(std::memory_order_relaxed);
+	}
+
+	template<class Callback>
+	void forEachSink(Callback&& callback) const {
+		const auto snapshot = mSnapshot.read();
+		if (snapshot) {
+			for (const auto& sink: snapshot->getSinks(mId)) {
+				callback(sink);
+			}
+		}
+	}
+
+	std::vector<spdlog::sink_ptr> getSinks() const;
+
+	RateLimiter& rateLimiter() { return mRateLimiter; }
+	Sampler& sampler() { return mSampler; }
+
+	// Applies the rate limit, logs a summary of the records it suppressed before
+	// admitting the next one
+	bool admitLimited(spdlog::level::level_enum, LogCallSite*);
+
+protected:
+
+	void sink_it_(const spdlog::details::log_msg&) override;
+	void flush_() override;
+
+private:
+
+	const ModuleId mId;
+	const std::atomic<uint8_t>& mLevel;
+	const ModuleSnapshotPointer& mSnapshot;
+	RateLimiter mRateLimiter;
+	Sampler mSampler;
+};
+
+inline bool shouldLog(const Module& module, spdlog::level::level_enum level) {
+	return module.shouldLog(level);
+}
+
+inline bool shouldLog(const spdlog::logger& logger, spdlog::level::level_enum level) {
+	return logger.should_log(level);
+}
+
+inline bool admit(Module& module, spdlog::level::level_enum level, LogCallSite* callSite) {
+	return module.sampler().sample(level)
+			&& (!module.rateLimiter().enabled() || module.admitLimited(level, callSite));
+}
+
+inline bool admit(spdlog::logger&, spdlog::level::level_enum, LogCallSite*) {
+	return true;
+}
+
+}
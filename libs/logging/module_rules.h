@@ -0,0 +1,130 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "rate_limiter.h"
+
+#include <spdlog/common.h>
+
+#include <boost/optional.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Logging {
+
+// Maps module names to values using exact names ("net.http.client") and
+// hierarchical wildcard rules ("net.*", "*"). Exact names take precedence,
+// otherwise the most specific wildcard wins.
+template<class Value>
+class ModuleRules {
+
+public:
+
+	ModuleRules()
+		: mRoot(std::make_unique<Node>())
+	{}
+
+	explicit ModuleRules(const std::unordered_map<std::string, Value>& rules)
+		: ModuleRules()
+	{
+		for (const auto& [pattern, value]: rules) {
+			addRule(pattern, value);
+		}
+	}
+
+	ModuleRules(const std::vector<std::string>& patterns, const Value& value)
+		: ModuleRules()
+	{
+		for (const auto& pattern: patterns) {
+			addRule(pattern, value);
+		}
+	}
+
+	void addRule(const std::string& pattern, const Value& value) {
+		Node* node = mRoot.get();
+		forEachSegment(pattern, [&node, &value](std::string_view segment, bool last) {
+			if (last && segment == WILDCARD) {
+				node->mWildcardValue = value;
+				return;
+			}
+
+			auto& child = node->mChildren[std::string(segment)];
+			if (!child) {
+				child = std::make_unique<Node>();
+			}
+			node = child.get();
+
+			if (last) {
+				node->mExactValue = value;
+			}
+		});
+	}
+
+	boost::optional<Value> resolve(const std::string& moduleName) const {
+		const Node* node = mRoot.get();
+		boost::optional<Value> wildcardValue = node->mWildcardValue;
+		boost::optional<Value> exactValue;
+
+		forEachSegment(moduleName, [&](std::string_view segment, bool last) {
+			if (!node) {
+				return;
+			}
+
+			const auto childIt = node->mChildren.find(std::string(segment));
+			if (childIt == node->mChildren.end()) {
+				node = nullptr;
+				return;
+			}
+			node = childIt->second.get();
+
+			if (last) {
+				exactValue = node->mExactValue;
+			} else if (node->mWildcardValue) {
+				wildcardValue = node->mWildcardValue;
+			}
+		});
+
+		return exactValue ? exactValue : wildcardValue;
+	}
+
+	bool matches(const std::string& moduleName) const {
+		return resolve(moduleName).has_value();
+	}
+
+private:
+
+	static constexpr char SEPARATOR = '.';
+	static constexpr std::string_view WILDCARD = "*";
+
+	struct Node {
+		boost::optional<Value> mExactValue;
+		boost::optional<Value> mWildcardValue;
+		std::unordered_map<std::string, std::unique_ptr<Node>> mChildren;
+	};
+
+	template<class Callback>
+	static void forEachSegment(std::string_view name, Callback callback) {
+		size_t begin = 0;
+		for (;;) {
+			const size_t end = name.find(SEPARATOR, begin);
+			if (end == std::string_view::npos) {
+				callback(name.substr(begin), true);
+				return;
+			}
+			callback(name.substr(begin, end - begin), false);
+			begin = end + 1;
+		}
+	}
+
+	std::unique_ptr<Node> mRoot;
+};
+
+using ModuleLevelRules = ModuleRules<spdlog::level::level_enum>;
+using ModuleFilter = ModuleRules<bool>;
+using ModuleRateLimitRules = ModuleRules<RateLimit>;
+using ModuleSampleRateRules = ModuleRules<double>;
+
+}
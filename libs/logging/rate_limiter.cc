@@ -0,0 +1,69 @@
+// Copyright (C) 2021 twyleg
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Logging {
+
+namespace {
+
+constexpr int64_t NANOSECONDS_PER_SECOND = 1000000000;
+
+}
+
+void RateLimiter::configure(const RateLimit& rateLimit) {
+	const int64_t interval = rateLimit.mMaxRate > 0
+			? std::max<int64_t>(1, std::llround(NANOSECONDS_PER_SECOND / rateLimit.mMaxRate))
+			: 0;
+	const int64_t burst = std::max<int64_t>(1, rateLimit.mBurst);
+
+	mInterval.store(interval, std::memory_order_relaxed);
+	mTolerance.store(interval * (burst - 1), std::memory_order_relaxed);
+	mMaxRepeats.store(rateLimit.mMaxRepeats, std::memory_order_relaxed);
+	mEnabled.store(rateLimit.enabled(), std::memory_order_relaxed);
+}
+
+RateLimiter::Admission RateLimiter::admit(LogCallSite* callSite, int64_t nowNs) {
+
+	const uint32_t maxRepeats = mMaxRepeats.load(std::memory_order_relaxed);
+	if (maxRepeats && callSite) {
+		const int64_t second = nowNs / NANOSECONDS_PER_SECOND;
+		int64_t callSiteSecond = callSite->mSecond.load(std::memory_order_relaxed);
+		if (callSiteSecond != second
+				&& callSite->mSecond.compare_exchange_strong(callSiteSecond, second, std::memory_order_relaxed)) {
+			callSite->mCount.store(0, std::memory_order_relaxed);
+		}
+		if (callSite->mCount.fetch_add(1, std::memory_order_relaxed) >= maxRepeats) {
+			callSite->mSuppressed.fetch_add(1, std::memory_order_relaxed);
+			return {false, 0, 0};
+		}
+	}
+
+	const int64_t interval = mInterval.load(std::memory_order_relaxed);
+	if (interval) {
+		const int64_t tolerance = mTolerance.load(std::memory_order_relaxed);
+		int64_t theoreticalArrival = mTheoreticalArrival.load(std::memory_order_relaxed);
+		for (;;) {
+			const int64_t start = std::max(theoreticalArrival, nowNs);
+			if (start - nowNs > tolerance) {
+				mSuppressed.fetch_add(1, std::memory_order_relaxed);
+				return {false, 0, 0};
+			}
+			if (mTheoreticalArrival.compare_exchange_weak(theoreticalArrival, start + interval, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+	}
+
+	Admission admission{true, 0, 0};
+	if (callSite && callSite->mSuppressed.load(std::memory_order_relaxed)) {
+		admission.mSuppressedRepeats = callSite->mSuppressed.exchange(0, std::memory_order_relaxed);
+	}
+	if (mSuppressed.load(std::memory_order_relaxed)) {
+		admission.mSuppressedByRate = mSuppressed.exchange(0, std::memory_order_relaxed);
+	}
+	return admission;
+}
+
+}
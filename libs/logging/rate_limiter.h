@@ -0,0 +1,61 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Logging {
+
+struct RateLimit {
+	// Records per second of the whole module, 0 for no limit
+	double mMaxRate;
+	// Records the module may log at once before mMaxRate applies
+	uint32_t mBurst;
+	// Records per second of a single LOG statement, 0 for no limit
+	uint32_t mMaxRepeats;
+
+	bool enabled() const { return mMaxRate > 0 || mMaxRepeats > 0; }
+	bool operator==(const RateLimit& other) const {
+		return mMaxRate == other.mMaxRate && mBurst == other.mBurst && mMaxRepeats == other.mMaxRepeats;
+	}
+};
+
+// State of one LOG statement, a static inside the LOG macros
+struct LogCallSite {
+	const char* const mFile;
+	const int mLine;
+	std::atomic<int64_t> mSecond{-1};
+	std::atomic<uint32_t> mCount{0};
+	std::atomic<uint32_t> mSuppressed{0};
+};
+
+// Token bucket (GCRA) of a module plus the per call site repeat limit. All state is
+// kept in atomics, so the check costs a few relaxed operations and no lock.
+class RateLimiter {
+
+public:
+
+	struct Admission {
+		bool mAdmitted;
+		// Records dropped since the last admitted one, to be reported by the caller
+		uint32_t mSuppressedRepeats;
+		uint64_t mSuppressedByRate;
+	};
+
+	void configure(const RateLimit&);
+	bool enabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+	// Without a call site only the module limit applies
+	Admission admit(LogCallSite*, int64_t nowNs);
+
+private:
+
+	std::atomic<bool> mEnabled{false};
+	std::atomic<int64_t> mInterval{0};
+	std::atomic<int64_t> mTolerance{0};
+	std::atomic<uint32_t> mMaxRepeats{0};
+	std::atomic<int64_t> mTheoreticalArrival{0};
+	std::atomic<uint64_t> mSuppressed{0};
+};
+
+}
@@ -0,0 +1,115 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Logging {
+
+// Pointer to an immutable object that readers access without locking or waiting.
+// Readers announce themselves in a striped counter of the current epoch; update()
+// publishes the new object, flips the epoch and waits until all readers of the old
+// epoch are gone before the old object is released.
+template<class T>
+class RcuPointer {
+
+public:
+
+	class ReadGuard {
+
+	public:
+
+		ReadGuard(const ReadGuard&) = delete;
+		ReadGuard& operator=(const ReadGuard&) = delete;
+
+		~ReadGuard() {
+			mCounter.fetch_sub(1, std::memory_order_release);
+		}
+
+		const T* get() const { return mObject; }
+		const T* operator->() const { return mObject; }
+		const T& operator*() const { return *mObject; }
+		explicit operator bool() const { return mObject != nullptr; }
+
+	private:
+
+		friend class RcuPointer;
+
+		ReadGuard(std::atomic<size_t>& counter, const T* object)
+			: mCounter(counter),
+			  mObject(object)
+		{}
+
+		std::atomic<size_t>& mCounter;
+		const T* mObject;
+	};
+
+	explicit RcuPointer(std::shared_ptr<const T> object = nullptr)
+		: mObject(std::move(object)),
+		  mPointer(mObject.get())
+	{}
+
+	RcuPointer(const RcuPointer&) = delete;
+	RcuPointer& operator=(const RcuPointer&) = delete;
+
+	ReadGuard read() const {
+		auto& stripe = mStripes[localStripe()];
+		for (;;) {
+			const size_t epoch = mEpoch.load(std::memory_order_seq_cst);
+			stripe.mReaders[epoch].fetch_add(1, std::memory_order_seq_cst);
+			if (mEpoch.load(std::memory_order_seq_cst) == epoch) {
+				return ReadGuard(stripe.mReaders[epoch], mPointer.load(std::memory_order_seq_cst));
+			}
+			stripe.mReaders[epoch].fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	// Returns once no reader can observe the previous object anymore. The previous
+	// object is returned so the caller decides where it is destroyed.
+	std::shared_ptr<const T> update(std::shared_ptr<const T> object) {
+		std::lock_guard<std::mutex> lock(mUpdateMutex);
+		mPointer.store(object.get(), std::memory_order_seq_cst);
+		std::swap(mObject, object);
+
+		const size_t epoch = mEpoch.load(std::memory_order_relaxed);
+		mEpoch.store(epoch ^ 1, std::memory_order_seq_cst);
+		for (auto& stripe: mStripes) {
+			while (stripe.mReaders[epoch].load(std::memory_order_seq_cst) != 0) {
+				std::this_thread::yield();
+			}
+		}
+		return object;
+	}
+
+	std::shared_ptr<const T> load() const {
+		std::lock_guard<std::mutex> lock(mUpdateMutex);
+		return mObject;
+	}
+
+private:
+
+	static constexpr size_t NUM_STRIPES = 16;
+
+	struct alignas(64) Stripe {
+		std::array<std::atomic<size_t>, 2> mReaders{};
+	};
+
+	static size_t localStripe() {
+		static std::atomic<size_t> nextStripe{0};
+		thread_local const size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % NUM_STRIPES;
+		return stripe;
+	}
+
+	mutable std::mutex mUpdateMutex;
+	std::shared_ptr<const T> mObject;
+
+	std::atomic<const T*> mPointer;
+	std::atomic<size_t> mEpoch{0};
+	mutable std::array<Stripe, NUM_STRIPES> mStripes;
+};
+
+}
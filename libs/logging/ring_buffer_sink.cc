@@ -0,0 +1,139 @@
+// Copyright (C) 2021 twyleg
+#include "ring_buffer_sink.h"
+
+#include <spdlog/pattern_formatter.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace Logging {
+
+namespace {
+
+std::atomic<uint64_t> nextInstanceId{1};
+
+size_t roundUpToPowerOfTwo(size_t value) {
+	size_t result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+constexpr size_t LOCAL_FORMATTER_CACHE_SIZE = 8;
+
+struct LocalFormatter {
+	uint64_t mInstanceId = 0;
+	uint64_t mGeneration = 0;
+	std::unique_ptr<spdlog::formatter> mFormatter;
+};
+
+// Formatter clones of the sinks a thread logs to, replaced round robin
+struct LocalFormatterCache {
+	std::array<LocalFormatter, LOCAL_FORMATTER_CACHE_SIZE> mFormatters;
+	size_t mNextReplaced = 0;
+	spdlog::memory_buf_t mBuffer;
+};
+
+thread_local LocalFormatterCache localFormatterCache;
+
+}
+
+RingBufferSink::RingBufferSink(size_t capacity, size_t recordSize)
+	: mCapacity(roundUpToPowerOfTwo(std::max<size_t>(1, capacity))),
+	  mMask(mCapacity - 1),
+	  mRecordSize(std::max<size_t>(1, recordSize)),
+	  mInstanceId(nextInstanceId.fetch_add(1)),
+	  mSlots(new Slot[mCapacity]),
+	  mData(new char[mCapacity * mRecordSize]),
+	  mFormatter(std::make_unique<spdlog::pattern_formatter>())
+{}
+
+void RingBufferSink::log(const spdlog::details::log_msg& msg) {
+	auto& buffer = localFormatterCache.mBuffer;
+	auto& formatter = localFormatter();
+	buffer.clear();
+	formatter.format(msg, buffer);
+
+	const uint64_t pos = mWritePos.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = mSlots[pos & mMask];
+
+	// A slot still being written by a producer one lap behind, or already claimed
+	// by one a lap ahead, is left alone rather than waited for
+	uint64_t sequence = slot.mSequence.load(std::memory_order_relaxed);
+	do {
+		if ((sequence & 1) || sequence >= writingSequence(pos)) {
+			mDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	} while (!slot.mSequence.compare_exchange_weak(sequence, writingSequence(pos), std::memory_order_acquire));
+
+	char* data = &mData[(pos & mMask) * mRecordSize];
+	size_t size = std::min(buffer.size(), mRecordSize);
+	std::memcpy(data, buffer.data(), size);
+	if (size < buffer.size()) {
+		data[size - 1] = '\n';
+	}
+
+	slot.mSize.store(static_cast<uint32_t>(size), std::memory_order_relaxed);
+	slot.mSequence.store(completeSequence(pos), std::memory_order_release);
+}
+
+spdlog::formatter& RingBufferSink::localFormatter() {
+	auto& cache = localFormatterCache;
+	auto it = std::find_if(cache.mFormatters.begin(), cache.mFormatters.end(), [this](const LocalFormatter& localFormatter) {
+		return localFormatter.mInstanceId == mInstanceId;
+	});
+	if (it == cache.mFormatters.end()) {
+		it = cache.mFormatters.begin() + cache.mNextReplaced;
+		cache.mNextReplaced = (cache.mNextReplaced + 1) % cache.mFormatters.size();
+		it->mInstanceId = mInstanceId;
+		it->mFormatter.reset();
+	}
+
+	const uint64_t generation = mFormatterGeneration.load(std::memory_order_acquire);
+	if (it->mGeneration != generation || !it->mFormatter) {
+		std::lock_guard<std::mutex> lock(mFormatterMutex);
+		it->mFormatter = mFormatter->clone();
+		it->mGeneration = mFormatterGeneration.load(std::memory_order_relaxed);
+	}
+	return *it->mFormatter;
+}
+
+void RingBufferSink::set_pattern(const std::string& pattern) {
+	set_formatter(std::make_unique<spdlog::pattern_formatter>(pattern));
+}
+
+void RingBufferSink::set_formatter(std::unique_ptr<spdlog::formatter> formatter) {
+	std::lock_guard<std::mutex> lock(mFormatterMutex);
+	mFormatter = std::move(formatter);
+	mFormatterGeneration.fetch_add(1, std::memory_order_release);
+}
+
+void RingBufferSink::dumpPending(int fd) const noexcept {
+	CrashHandler::write(fd, "--- recent log records ---\n");
+	forEachRecord([fd](const char* data, size_t size) {
+		CrashHandler::write(fd, data, size);
+	});
+}
+
+std::vector<std::string> RingBufferSink::getRecords() const {
+	std::vector<std::string> records;
+	const uint64_t end = mWritePos.load(std::memory_order_acquire);
+	const uint64_t begin = end > mCapacity ? end - mCapacity : 0;
+	for (uint64_t pos=begin; pos<end; ++pos) {
+		const Slot& slot = mSlots[pos & mMask];
+		if (slot.mSequence.load(std::memory_order_acquire) != completeSequence(pos)) {
+			continue;
+		}
+		std::string record(&mData[(pos & mMask) * mRecordSize], slot.mSize.load(std::memory_order_relaxed));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.mSequence.load(std::memory_order_relaxed) == completeSequence(pos)) {
+			records.push_back(std::move(record));
+		}
+	}
+	return records;
+}
+
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "crash_handler.h"
+
+#include <spdlog/sinks/sink.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Logging {
+
+// Keeps the most recent formatted records in preallocated fixed-size slots. Producers
+// claim slots with a single fetch_add and overwrite the oldest record; nothing is
+// allocated or locked on the logging path.
+class RingBufferSink : public spdlog::sinks::sink, public CrashDumpSink {
+
+public:
+
+	RingBufferSink(size_t capacity, size_t recordSize);
+
+	void log(const spdlog::details::log_msg&) override;
+	void flush() override {}
+	void set_pattern(const std::string&) override;
+	void set_formatter(std::unique_ptr<spdlog::formatter>) override;
+
+	size_t capacity() const { return mCapacity; }
+	size_t recordSize() const { return mRecordSize; }
+	uint64_t droppedRecords() const { return mDropped.load(std::memory_order_relaxed); }
+
+	// Calls callback(const char* data, size_t size) for every completely written record,
+	// oldest first. Neither allocates nor locks, so it may be used from a signal handler.
+	template<class Callback>
+	void forEachRecord(Callback&& callback) const {
+		const uint64_t end = mWritePos.load(std::memory_order_acquire);
+		const uint64_t begin = end > mCapacity ? end - mCapacity : 0;
+		for (uint64_t pos=begin; pos<end; ++pos) {
+			const Slot& slot = mSlots[pos & mMask];
+			if (slot.mSequence.load(std::memory_order_acquire) != completeSequence(pos)) {
+				continue;
+			}
+			callback(&mData[(pos & mMask) * mRecordSize], slot.mSize.load(std::memory_order_relaxed));
+		}
+	}
+
+	std::vector<std::string> getRecords() const;
+
+	void dumpPending(int fd) const noexcept override;
+
+private:
+
+	struct Slot {
+		std::atomic<uint64_t> mSequence{0};
+		std::atomic<uint32_t> mSize{0};
+	};
+
+	static uint64_t writingSequence(uint64_t pos) { return 2 * pos + 1; }
+	static uint64_t completeSequence(uint64_t pos) { return 2 * pos + 2; }
+
+	spdlog::formatter& localFormatter();
+
+	const size_t mCapacity;
+	const size_t mMask;
+	const size_t mRecordSize;
+	const uint64_t mInstanceId;
+
+	std::unique_ptr<Slot[]> mSlots;
+	std::unique_ptr<char[]> mData;
+
+	alignas(64) std::atomic<uint64_t> mWritePos{0};
+	std::atomic<uint64_t> mDropped{0};
+
+	std::mutex mFormatterMutex;
+	std::unique_ptr<spdlog::formatter> mFormatter;
+	std::atomic<uint64_t> mFormatterGeneration{0};
+};
+
+}
@@ -0,0 +1,74 @@
+// Copyright (C) 2021 twyleg
+#include "sampler.h"
+
+#include <spdlog/details/os.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Logging {
+
+namespace {
+
+uint64_t mix(uint64_t value) {
+	value += 0x9e3779b97f4a7c15ull;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+	return value ^ (value >> 31);
+}
+
+uint64_t hashTraceId(std::string_view traceId) {
+	uint64_t hash = 14695981039346656037ull;
+	for (const char c: traceId) {
+		hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+	}
+	return mix(hash);
+}
+
+void setTrace(uint64_t traceHash, bool traced) {
+	auto& state = Detail::localSamplingState();
+	state.mTraceHash = traceHash;
+	state.mTraced = traced;
+}
+
+}
+
+namespace Detail {
+
+SamplingState initSamplingState() {
+	const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+	const uint64_t seed = mix(spdlog::details::os::thread_id() ^ mix(static_cast<uint64_t>(now)));
+	return {seed ? seed : 1, 0, false};
+}
+
+}
+
+void Sampler::setRate(double rate) {
+	const double clampedRate = std::clamp(rate, 0.0, 1.0);
+	mThreshold.store(static_cast<uint64_t>(std::llround(clampedRate * static_cast<double>(ALL))), std::memory_order_relaxed);
+}
+
+double Sampler::getRate() const {
+	return static_cast<double>(mThreshold.load(std::memory_order_relaxed)) / static_cast<double>(ALL);
+}
+
+TraceScope::TraceScope(uint64_t traceId)
+	: mPreviousTraceHash(Detail::localSamplingState().mTraceHash),
+	  mPreviousTraced(Detail::localSamplingState().mTraced)
+{
+	setTrace(mix(traceId), true);
+}
+
+TraceScope::TraceScope(std::string_view traceId)
+	: mPreviousTraceHash(Detail::localSamplingState().mTraceHash),
+	  mPreviousTraced(Detail::localSamplingState().mTraced)
+{
+	setTrace(hashTraceId(traceId), true);
+}
+
+TraceScope::~TraceScope() {
+	setTrace(mPreviousTraceHash, mPreviousTraced);
+}
+
+}
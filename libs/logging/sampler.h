@@ -0,0 +1,87 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <spdlog/common.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+namespace Logging {
+
+namespace Detail {
+
+struct SamplingState {
+	uint64_t mRandom;
+	uint64_t mTraceHash;
+	bool mTraced;
+};
+
+SamplingState initSamplingState();
+
+inline SamplingState& localSamplingState() {
+	thread_local SamplingState state = initSamplingState();
+	return state;
+}
+
+}
+
+// Keeps a fraction of a module's Debug records, all other levels pass. The decision
+// uses a thread local xorshift generator, or the hash of the thread's trace id while
+// a TraceScope is active, so that the records of a trace are kept or dropped together
+// in every module with the same or a higher rate.
+class Sampler {
+
+public:
+
+	static constexpr spdlog::level::level_enum MAX_SAMPLED_LEVEL = spdlog::level::level_enum::debug;
+
+	void setRate(double rate);
+	double getRate() const;
+	bool enabled() const { return mThreshold.load(std::memory_order_relaxed) != ALL; }
+
+	bool sample(spdlog::level::level_enum level) const {
+		if (level > MAX_SAMPLED_LEVEL) {
+			return true;
+		}
+		const uint64_t threshold = mThreshold.load(std::memory_order_relaxed);
+		if (threshold == ALL) {
+			return true;
+		}
+
+		auto& state = Detail::localSamplingState();
+		if (state.mTraced) {
+			return (state.mTraceHash >> 32) < threshold;
+		}
+		state.mRandom ^= state.mRandom << 13;
+		state.mRandom ^= state.mRandom >> 7;
+		state.mRandom ^= state.mRandom << 17;
+		return (state.mRandom >> 32) < threshold;
+	}
+
+private:
+
+	static constexpr uint64_t ALL = uint64_t(1) << 32;
+
+	std::atomic<uint64_t> mThreshold{ALL};
+};
+
+// Sets the trace id sampling decisions of the current thread are based on
+class TraceScope {
+
+public:
+
+	explicit TraceScope(uint64_t traceId);
+	explicit TraceScope(std::string_view traceId);
+	~TraceScope();
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+
+	const uint64_t mPreviousTraceHash;
+	const bool mPreviousTraced;
+};
+
+}
@@ -9,6 +9,7 @@
 #include <mutex>
 #include <list>
 #include <algorithm>
+#include <ostream>
 #include <string>
 
 namespace Logging {
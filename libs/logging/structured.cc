@@ -0,0 +1,175 @@
+// Copyright (C) 2021 twyleg
+#include "structured.h"
+
+#include <fmt/format.h>
+
+#include <cstring>
+#include <exception>
+#include <iterator>
+
+namespace Logging::Structured {
+
+namespace {
+
+template<class T>
+const char* readValue(const char* src, T& value) {
+	std::memcpy(&value, src, sizeof(T));
+	return src + sizeof(T);
+}
+
+bool needsQuotes(std::string_view value) {
+	if (value.empty()) {
+		return true;
+	}
+	for (const char c: value) {
+		if (c == ' ' || c == '=' || c == '"' || static_cast<unsigned char>(c) < 0x20) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void appendString(std::string_view value, spdlog::memory_buf_t& dst) {
+	if (!needsQuotes(value)) {
+		dst.append(value.data(), value.data() + value.size());
+		return;
+	}
+
+	dst.push_back('"');
+	for (const char c: value) {
+		switch (c) {
+		case '"':
+			dst.append(std::string_view("\\\""));
+			break;
+		case '\\':
+			dst.append(std::string_view("\\\\"));
+			break;
+		case '\n':
+			dst.append(std::string_view("\\n"));
+			break;
+		default:
+			dst.push_back(c);
+			break;
+		}
+	}
+	dst.push_back('"');
+}
+
+}
+
+const char* decodeValue(const char* src, FieldValue& value) {
+	value.mType = static_cast<Deferred::ArgType>(*src++);
+	switch (value.mType) {
+	case Deferred::ArgType::INT64:
+		return readValue(src, value.mInt);
+	case Deferred::ArgType::UINT64:
+	case Deferred::ArgType::POINTER:
+		return readValue(src, value.mUint);
+	case Deferred::ArgType::DOUBLE:
+		return readValue(src, value.mDouble);
+	case Deferred::ArgType::BOOL:
+		return readValue(src, value.mBool);
+	case Deferred::ArgType::CHAR:
+		return readValue(src, value.mChar);
+	case Deferred::ArgType::STRING: {
+		uint32_t length;
+		src = readValue(src, length);
+		value.mString = std::string_view(src, length);
+		return src + length;
+	}
+	}
+	return src;
+}
+
+void appendFields(const Fields& fields, spdlog::memory_buf_t& dst) {
+	forEachField(fields, [&dst](std::string_view key, const FieldValue& value) {
+		dst.push_back(' ');
+		dst.append(key.data(), key.data() + key.size());
+		dst.push_back('=');
+		switch (value.mType) {
+		case Deferred::ArgType::INT64:
+			fmt::format_to(std::back_inserter(dst), "{}", value.mInt);
+			break;
+		case Deferred::ArgType::UINT64:
+			fmt::format_to(std::back_inserter(dst), "{}", value.mUint);
+			break;
+		case Deferred::ArgType::DOUBLE:
+			fmt::format_to(std::back_inserter(dst), "{}", value.mDouble);
+			break;
+		case Deferred::ArgType::BOOL:
+			dst.append(std::string_view(value.mBool ? "true" : "false"));
+			break;
+		case Deferred::ArgType::CHAR:
+			appendString(std::string_view(&value.mChar, 1), dst);
+			break;
+		case Deferred::ArgType::STRING:
+			appendString(value.mString, dst);
+			break;
+		case Deferred::ArgType::POINTER:
+			fmt::format_to(std::back_inserter(dst), "{:#x}", value.mUint);
+			break;
+		}
+	});
+}
+
+void RecordDispatcher::dispatch(spdlog::sinks::sink& sink) {
+	if (auto structuredSink = dynamic_cast<StructuredSink*>(&sink)) {
+		structuredSink->logStructured(mMsg, mFields);
+		return;
+	}
+
+	if (!mTextMsg) {
+		mText.append(mMsg.payload.data(), mMsg.payload.data() + mMsg.payload.size());
+		appendFields(mFields, mText);
+		mTextMsg.emplace(mMsg);
+		mTextMsg->payload = spdlog::string_view_t(mText.data(), mText.size());
+	}
+	sink.log(*mTextMsg);
+}
+
+void logFields(spdlog::logger& logger, spdlog::level::level_enum level, std::string_view message, const Fields& fields) {
+	CrashHandler::prepareThread();
+
+	const spdlog::details::log_msg msg(logger.name(), level, spdlog::string_view_t(message.data(), message.size()));
+	RecordDispatcher dispatcher(msg, fields);
+	bool logged = false;
+
+	const auto dispatchToSink = [&](const spdlog::sink_ptr& sink) {
+		if (!sink->should_log(level)) {
+			return;
+		}
+		try {
+			dispatcher.dispatch(*sink);
+			logged = true;
+		} catch (const std::exception& e) {
+			fmt::print(stderr, "[*** LOG ERROR ***] [{}] {}\n", logger.name(), e.what());
+		}
+	};
+
+	const auto flushSink = [&](const spdlog::sink_ptr& sink) {
+		try {
+			sink->flush();
+		} catch (const std::exception& e) {
+			fmt::print(stderr, "[*** LOG ERROR ***] [{}] {}\n", logger.name(), e.what());
+		}
+	};
+
+	const bool flush = level >= logger.flush_level() && level != spdlog::level::level_enum::off;
+	if (auto module = dynamic_cast<const Module*>(&logger)) {
+		module->forEachSink(dispatchToSink);
+		if (logged && flush) {
+			module->forEachSink(flushSink);
+		}
+	} else {
+		for (const auto& sink: logger.sinks()) {
+			dispatchToSink(sink);
+		}
+		if (logged && flush) {
+			for (const auto& sink: logger.sinks()) {
+				flushSink(sink);
+			}
+		}
+	}
+}
+
+}
@@ -0,0 +1,134 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+#include "deferred.h"
+#include "level.h"
+
+#include <spdlog/details/log_msg.h>
+#include <spdlog/logger.h>
+#include <spdlog/sinks/sink.h>
+
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#define LOG_KV(logModule, logLevel, message, ...) \
+	do { \
+		if constexpr (LOGGING_LEVEL_ACTIVE(logLevel)) { \
+			static Logging::LogCallSite logCallSite{__FILE__, __LINE__}; \
+			if (Logging::shouldLog(*logModule, logLevel) && Logging::admit(*logModule, logLevel, &logCallSite)) { \
+				Logging::Structured::log(*logModule, logLevel, message, ##__VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
+namespace Logging::Structured {
+
+// Key value pairs of a LOG_KV record. Keys and values use the argument encoding of
+// LOG_DEFERRED, every key is a STRING.
+struct Fields {
+	const char* mData;
+	size_t mSize;
+	uint8_t mNumFields;
+};
+
+struct FieldValue {
+	Deferred::ArgType mType;
+	union {
+		int64_t mInt;
+		uint64_t mUint;
+		double mDouble;
+		bool mBool;
+		char mChar;
+	};
+	std::string_view mString;
+};
+
+const char* decodeValue(const char* src, FieldValue& value);
+
+template<class Callback>
+void forEachField(const Fields& fields, Callback&& callback) {
+	const char* src = fields.mData;
+	FieldValue key;
+	FieldValue value;
+	for (uint8_t i=0; i<fields.mNumFields; ++i) {
+		src = decodeValue(decodeValue(src, key), value);
+		callback(key.mString, value);
+	}
+}
+
+// Renders the fields as " key=value" pairs for text sinks
+void appendFields(const Fields&, spdlog::memory_buf_t& dst);
+
+// Sinks implementing this interface receive LOG_KV records with the bare message as
+// payload and the typed fields. All other sinks get the fields rendered into the payload.
+class StructuredSink {
+
+public:
+
+	virtual ~StructuredSink() = default;
+	virtual void logStructured(const spdlog::details::log_msg&, const Fields&) = 0;
+};
+
+// Hands one LOG_KV record to sinks and renders the text for the others at most once
+class RecordDispatcher {
+
+public:
+
+	RecordDispatcher(const spdlog::details::log_msg& msg, const Fields& fields)
+		: mMsg(msg),
+		  mFields(fields)
+	{}
+
+	void dispatch(spdlog::sinks::sink&);
+
+private:
+
+	const spdlog::details::log_msg& mMsg;
+	const Fields& mFields;
+	spdlog::memory_buf_t mText;
+	boost::optional<spdlog::details::log_msg> mTextMsg;
+};
+
+namespace Detail {
+
+inline size_t fieldsSize() {
+	return 0;
+}
+
+template<class Key, class Value, class... Rest>
+size_t fieldsSize(const Key& key, const Value& value, const Rest&... rest) {
+	static_assert(std::is_convertible_v<const Key&, std::string_view>, "LOG_KV keys must be strings");
+	return 1 + sizeof(uint32_t) + std::string_view(key).size() + Deferred::Detail::Codec<Value>::size(value)
+			+ fieldsSize(rest...);
+}
+
+inline char* encodeFields(char* dst) {
+	return dst;
+}
+
+template<class Key, class Value, class... Rest>
+char* encodeFields(char* dst, const Key& key, const Value& value, const Rest&... rest) {
+	dst = Deferred::Detail::writeString(dst, key);
+	dst = Deferred::Detail::Codec<Value>::encode(dst, value);
+	return encodeFields(dst, rest...);
+}
+
+}
+
+void logFields(spdlog::logger&, spdlog::level::level_enum, std::string_view message, const Fields&);
+
+template<class... Args>
+void log(spdlog::logger& logger, spdlog::level::level_enum level, std::string_view message, const Args&... args) {
+	static_assert(sizeof...(Args) % 2 == 0, "LOG_KV expects key value pairs");
+	static_assert(sizeof...(Args) / 2 <= UINT8_MAX, "LOG_KV supports at most 255 fields");
+
+	thread_local std::vector<char> encoded;
+	encoded.resize(Detail::fieldsSize(args...));
+	Detail::encodeFields(encoded.data(), args...);
+	logFields(logger, level, message, {encoded.data(), encoded.size(), static_cast<uint8_t>(sizeof...(Args) / 2)});
+}
+
+}
@@ -0,0 +1,443 @@
+// Copyright (C) 2021 twyleg
+#include "uring_file_sink.h"
+
+#include <spdlog/sinks/rotating_file_sink.h>
+
+#include <fmt/format.h>
+
+#include <linux/io_uring.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+namespace Logging {
+
+namespace {
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+	return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+	return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned numArgs) {
+	return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, numArgs));
+}
+
+template<class T>
+T* ringPointer(void* ring, uint32_t offset) {
+	return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+constexpr uint64_t FILE_OPERATION_USER_DATA = UINT64_MAX;
+constexpr unsigned PROBE_OPS = 256;
+
+}
+
+const UringFileSink::Parameters UringFileSink::DEFAULT_PARAMETERS{
+	8,
+	256 * 1024,
+	spdlog::level::level_enum::err
+};
+
+class UringFileSink::Ring {
+
+public:
+
+	explicit Ring(unsigned entries) {
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+
+		mFd = ioUringSetup(entries, &params);
+		if (mFd < 0) {
+			throw spdlog::spdlog_ex("Failed to set up io_uring", errno);
+		}
+
+		mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+		mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		if (params.features & IORING_FEAT_SINGLE_MMAP) {
+			mSqRingSize = mCqRingSize = std::max(mSqRingSize, mCqRingSize);
+		}
+
+		mSqRing = map(mSqRingSize, IORING_OFF_SQ_RING);
+		mCqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? mSqRing : map(mCqRingSize, IORING_OFF_CQ_RING);
+		mSqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		mSqes = static_cast<io_uring_sqe*>(map(mSqesSize, IORING_OFF_SQES));
+
+		mSqTail = ringPointer<uint32_t>(mSqRing, params.sq_off.tail);
+		mSqMask = *ringPointer<uint32_t>(mSqRing, params.sq_off.ring_mask);
+		mSqArray = ringPointer<uint32_t>(mSqRing, params.sq_off.array);
+		mCqHead = ringPointer<uint32_t>(mCqRing, params.cq_off.head);
+		mCqTail = ringPointer<uint32_t>(mCqRing, params.cq_off.tail);
+		mCqMask = *ringPointer<uint32_t>(mCqRing, params.cq_off.ring_mask);
+		mCqes = ringPointer<io_uring_cqe>(mCqRing, params.cq_off.cqes);
+
+		mFileOperations = probeFileOperations();
+	}
+
+	~Ring() {
+		unmap(mSqes, mSqesSize);
+		if (mCqRing != mSqRing) {
+			unmap(mCqRing, mCqRingSize);
+		}
+		unmap(mSqRing, mSqRingSize);
+		if (mFd >= 0) {
+			::close(mFd);
+		}
+	}
+
+	void registerBuffers(const std::vector<iovec>& buffers) {
+		if (ioUringRegister(mFd, IORING_REGISTER_BUFFERS, buffers.data(), static_cast<unsigned>(buffers.size())) < 0) {
+			throw spdlog::spdlog_ex("Failed to register io_uring buffers", errno);
+		}
+	}
+
+	void submitWriteFixed(int fd, const char* data, size_t size, uint16_t bufferIndex, uint64_t userData) {
+		io_uring_sqe& sqe = prepare(IORING_OP_WRITE_FIXED, fd, userData);
+		sqe.addr = reinterpret_cast<uint64_t>(data);
+		sqe.len = static_cast<uint32_t>(size);
+		sqe.buf_index = bufferIndex;
+		// The file is opened with O_APPEND, which ignores the offset, so the writes must not overtake each other
+		sqe.flags = IOSQE_IO_DRAIN;
+		submit();
+	}
+
+	// Open, close and rename run on the ring if the kernel supports it (5.11), synchronously otherwise.
+	// They are only called while no write is in flight and return -errno on failure.
+	int openFile(const char* path, int flags, mode_t mode) {
+		if (!mFileOperations) {
+			const int fd = ::open(path, flags, mode);
+			return fd < 0 ? -errno : fd;
+		}
+		io_uring_sqe& sqe = prepare(IORING_OP_OPENAT, AT_FDCWD, FILE_OPERATION_USER_DATA);
+		sqe.addr = reinterpret_cast<uint64_t>(path);
+		sqe.len = mode;
+		sqe.open_flags = static_cast<uint32_t>(flags);
+		return runFileOperation();
+	}
+
+	int closeFile(int fd) {
+		if (!mFileOperations) {
+			return ::close(fd) < 0 ? -errno : 0;
+		}
+		prepare(IORING_OP_CLOSE, fd, FILE_OPERATION_USER_DATA);
+		return runFileOperation();
+	}
+
+	int renameFile(const char* source, const char* target) {
+		if (!mFileOperations) {
+			return ::rename(source, target) < 0 ? -errno : 0;
+		}
+		io_uring_sqe& sqe = prepare(IORING_OP_RENAMEAT, AT_FDCWD, FILE_OPERATION_USER_DATA);
+		sqe.addr = reinterpret_cast<uint64_t>(source);
+		sqe.len = static_cast<uint32_t>(AT_FDCWD);
+		sqe.addr2 = reinterpret_cast<uint64_t>(target);
+		return runFileOperation();
+	}
+
+	void waitForCompletion() {
+		while (ioUringEnter(mFd, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+			if (errno != EINTR) {
+				throw spdlog::spdlog_ex("Failed to wait for io_uring completion", errno);
+			}
+		}
+	}
+
+	template<class Callback>
+	void forEachCompletion(Callback callback) {
+		uint32_t head = *mCqHead;
+		const uint32_t tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			const io_uring_cqe cqe = mCqes[head & mCqMask];
+			__atomic_store_n(mCqHead, ++head, __ATOMIC_RELEASE);
+			callback(cqe.user_data, cqe.res);
+		}
+	}
+
+private:
+
+	io_uring_sqe& prepare(uint8_t opcode, int fd, uint64_t userData) {
+		const uint32_t tail = *mSqTail;
+		const uint32_t index = tail & mSqMask;
+
+		io_uring_sqe& sqe = mSqes[index];
+		std::memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = opcode;
+		sqe.fd = fd;
+		sqe.user_data = userData;
+
+		mSqArray[index] = index;
+		__atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+		return sqe;
+	}
+
+	// The kernel may consume nothing, for example while it runs short of request memory
+	void submit() {
+		int submitted = 0;
+		while (submitted == 0) {
+			submitted = ioUringEnter(mFd, 1, 0, 0);
+			if (submitted < 0) {
+				if (errno != EINTR && errno != EAGAIN) {
+					throw spdlog::spdlog_ex("Failed to submit io_uring operation", errno);
+				}
+				submitted = 0;
+			}
+		}
+	}
+
+	int runFileOperation() {
+		submit();
+		std::optional<int> result;
+		while (!result) {
+			waitForCompletion();
+			forEachCompletion([&result](uint64_t, int32_t completionResult) {
+				result = completionResult;
+			});
+		}
+		return *result;
+	}
+
+	bool probeFileOperations() {
+		std::vector<char> probeMemory(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+		auto* probe = reinterpret_cast<io_uring_probe*>(probeMemory.data());
+		if (ioUringRegister(mFd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0) {
+			return false;
+		}
+		return std::all_of(std::begin(FILE_OPERATIONS), std::end(FILE_OPERATIONS), [probe](uint8_t opcode) {
+			return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+		});
+	}
+
+	void* map(size_t size, off_t offset) {
+		void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFd, offset);
+		if (ptr == MAP_FAILED) {
+			throw spdlog::spdlog_ex("Failed to map io_uring", errno);
+		}
+		return ptr;
+	}
+
+	static void unmap(void* ptr, size_t size) {
+		if (ptr) {
+			::munmap(ptr, size);
+		}
+	}
+
+	int mFd = -1;
+	size_t mSqRingSize = 0;
+	size_t mCqRingSize = 0;
+	size_t mSqesSize = 0;
+	void* mSqRing = nullptr;
+	void* mCqRing = nullptr;
+	io_uring_sqe* mSqes = nullptr;
+
+	uint32_t* mSqTail = nullptr;
+	uint32_t mSqMask = 0;
+	uint32_t* mSqArray = nullptr;
+	uint32_t* mCqHead = nullptr;
+	uint32_t* mCqTail = nullptr;
+	uint32_t mCqMask = 0;
+	io_uring_cqe* mCqes = nullptr;
+
+	static constexpr uint8_t FILE_OPERATIONS[] = {IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_RENAMEAT};
+	bool mFileOperations = false;
+};
+
+UringFileSink::UringFileSink(const boost::filesystem::path& filePath, bool truncate, const Parameters& parameters,
+		size_t maxFileSize, size_t maxNumFiles)
+	: mFilePath(filePath),
+	  mParameters(parameters),
+	  mMaxFileSize(maxFileSize),
+	  mMaxNumFiles(maxNumFiles),
+	  mRing(std::make_unique<Ring>(static_cast<unsigned>(parameters.mQueueDepth)))
+{
+	const size_t numBuffers = std::max<size_t>(2, mParameters.mQueueDepth);
+	mBufferMemory.reset(new char[numBuffers * mParameters.mBufferSize]);
+
+	std::vector<iovec> iovecs;
+	for (size_t i=0; i<numBuffers; ++i) {
+		char* data = mBufferMemory.get() + i * mParameters.mBufferSize;
+		mBuffers.push_back({data, 0, false});
+		iovecs.push_back({data, mParameters.mBufferSize});
+	}
+	mRing->registerBuffers(iovecs);
+
+	if (mFilePath.has_parent_path()) {
+		boost::filesystem::create_directories(mFilePath.parent_path());
+	}
+	openFile(truncate);
+	mCurrentBuffer = &mBuffers.front();
+}
+
+UringFileSink::~UringFileSink() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	try {
+		submitCurrentBuffer();
+		waitForAllCompletions();
+		closeFile();
+	} catch (const spdlog::spdlog_ex& e) {
+		fmt::print(stderr, "[*** LOG ERROR ***] {}\n", e.what());
+	}
+}
+
+bool UringFileSink::isSupported() {
+	static const bool supported = []() {
+		try {
+			Ring ring(1);
+			return true;
+		} catch (const spdlog::spdlog_ex&) {
+			return false;
+		}
+	}();
+	return supported;
+}
+
+void UringFileSink::dumpPending(int fd) const noexcept {
+	CrashHandler::write(fd, "--- unflushed records of ");
+	CrashHandler::write(fd, mFilePath.native());
+	CrashHandler::write(fd, " ---\n");
+	if (mCurrentBuffer) {
+		CrashHandler::write(fd, mCurrentBuffer->mData, mCurrentBuffer->mSize);
+	}
+}
+
+void UringFileSink::sink_it_(const spdlog::details::log_msg& msg) {
+	mRecord.clear();
+	formatter_->format(msg, mRecord);
+
+	if (mMaxFileSize && mFileSize + mCurrentBuffer->mSize + mRecord.size() > mMaxFileSize) {
+		submitCurrentBuffer();
+		waitForAllCompletions();
+		rotate();
+	}
+
+	if (mRecord.size() > mParameters.mBufferSize) {
+		submitCurrentBuffer();
+		waitForAllCompletions();
+		if (::write(mFd, mRecord.data(), mRecord.size()) != static_cast<ssize_t>(mRecord.size())) {
+			throw spdlog::spdlog_ex(fmt::format("Failed to write log file {}", mFilePath.string()), errno);
+		}
+		mFileSize += mRecord.size();
+		return;
+	}
+
+	if (mCurrentBuffer->mSize + mRecord.size() > mParameters.mBufferSize) {
+		submitCurrentBuffer();
+	}
+
+	std::memcpy(mCurrentBuffer->mData + mCurrentBuffer->mSize, mRecord.data(), mRecord.size());
+	mCurrentBuffer->mSize += mRecord.size();
+
+	if (mParameters.mFlushLevel != spdlog::level::level_enum::off && msg.level >= mParameters.mFlushLevel) {
+		submitCurrentBuffer();
+	}
+}
+
+void UringFileSink::flush_() {
+	submitCurrentBuffer();
+	waitForAllCompletions();
+}
+
+void UringFileSink::submitCurrentBuffer() {
+	if (mCurrentBuffer->mSize == 0) {
+		return;
+	}
+
+	const auto bufferIndex = static_cast<uint16_t>(mCurrentBuffer - mBuffers.data());
+	mCurrentBuffer->mInFlight = true;
+	mRing->submitWriteFixed(mFd, mCurrentBuffer->mData, mCurrentBuffer->mSize, bufferIndex, bufferIndex);
+	mFileSize += mCurrentBuffer->mSize;
+	mInFlight++;
+
+	mCurrentBuffer = &acquireBuffer();
+}
+
+UringFileSink::Buffer& UringFileSink::acquireBuffer() {
+	for (;;) {
+		reapCompletions(false);
+		for (auto& buffer: mBuffers) {
+			if (!buffer.mInFlight) {
+				buffer.mSize = 0;
+				return buffer;
+			}
+		}
+		reapCompletions(true);
+	}
+}
+
+void UringFileSink::reapCompletions(bool wait) {
+	if (wait && mInFlight) {
+		mRing->waitForCompletion();
+	}
+
+	mRing->forEachCompletion([this](uint64_t bufferIndex, int32_t result) {
+		Buffer& buffer = mBuffers[bufferIndex];
+		buffer.mInFlight = false;
+		mInFlight--;
+
+		if (result < 0) {
+			throw spdlog::spdlog_ex(fmt::format("Failed to write log file {}", mFilePath.string()), -result);
+		}
+
+		// Short writes are rare for regular files, the remainder is written synchronously
+		const size_t written = static_cast<size_t>(result);
+		if (written < buffer.mSize) {
+			const size_t remaining = buffer.mSize - written;
+			if (::write(mFd, buffer.mData + written, remaining) != static_cast<ssize_t>(remaining)) {
+				throw spdlog::spdlog_ex(fmt::format("Failed to write log file {}", mFilePath.string()), errno);
+			}
+		}
+	});
+}
+
+void UringFileSink::waitForAllCompletions() {
+	while (mInFlight) {
+		reapCompletions(true);
+	}
+}
+
+void UringFileSink::openFile(bool truncate) {
+	// Appending keeps the records of another instance on the same file, e.g. during a config reload
+	const int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+	const int fd = mRing->openFile(mFilePath.c_str(), flags, 0644);
+	if (fd < 0) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to open log file {}", mFilePath.string()), -fd);
+	}
+	mFd = fd;
+
+	struct stat fileStat;
+	mFileSize = ::fstat(mFd, &fileStat) == 0 ? static_cast<size_t>(fileStat.st_size) : 0;
+}
+
+void UringFileSink::closeFile() {
+	if (mFd >= 0) {
+		mRing->closeFile(std::exchange(mFd, -1));
+	}
+}
+
+void UringFileSink::rotate() {
+	using RotatingFileSink = spdlog::sinks::rotating_file_sink_mt;
+
+	closeFile();
+	for (size_t i=mMaxNumFiles; i>0; --i) {
+		const auto source = RotatingFileSink::calc_filename(mFilePath.string(), i - 1);
+		const auto target = RotatingFileSink::calc_filename(mFilePath.string(), i);
+		// Files that don't exist yet fail with ENOENT, which is fine
+		mRing->renameFile(source.c_str(), target.c_str());
+	}
+	openFile(true);
+}
+
+}
@@ -0,0 +1,81 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "crash_handler.h"
+
+#include <spdlog/sinks/base_sink.h>
+
+#include <boost/filesystem.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Logging {
+
+// File sink that submits its writes through io_uring from a set of registered
+// buffers, so the logging thread only blocks when every buffer is in flight.
+// Rotation opens, closes and renames the files through the ring as well.
+// The file is opened with O_APPEND, so instances sharing it don't overwrite each other.
+// The constructor throws spdlog::spdlog_ex when the kernel does not provide io_uring.
+class UringFileSink : public spdlog::sinks::base_sink<std::mutex>, public CrashDumpSink {
+
+public:
+
+	struct Parameters {
+		size_t mQueueDepth;
+		size_t mBufferSize;
+		spdlog::level::level_enum mFlushLevel;
+	};
+
+	static const Parameters DEFAULT_PARAMETERS;
+
+	UringFileSink(const boost::filesystem::path& filePath, bool truncate, const Parameters& = DEFAULT_PARAMETERS,
+			size_t maxFileSize = 0, size_t maxNumFiles = 0);
+	~UringFileSink() override;
+
+	static bool isSupported();
+
+	void dumpPending(int fd) const noexcept override;
+
+protected:
+
+	void sink_it_(const spdlog::details::log_msg&) override;
+	void flush_() override;
+
+private:
+
+	class Ring;
+
+	struct Buffer {
+		char* mData;
+		size_t mSize;
+		bool mInFlight;
+	};
+
+	void submitCurrentBuffer();
+	Buffer& acquireBuffer();
+	void reapCompletions(bool wait);
+	void waitForAllCompletions();
+	void openFile(bool truncate);
+	void closeFile();
+	void rotate();
+
+	const boost::filesystem::path mFilePath;
+	const Parameters mParameters;
+	const size_t mMaxFileSize;
+	const size_t mMaxNumFiles;
+
+	int mFd = -1;
+	size_t mFileSize = 0;
+
+	std::unique_ptr<Ring> mRing;
+	std::unique_ptr<char[]> mBufferMemory;
+	std::vector<Buffer> mBuffers;
+	Buffer* mCurrentBuffer = nullptr;
+	size_t mInFlight = 0;
+
+	spdlog::memory_buf_t mRecord;
+};
+
+}
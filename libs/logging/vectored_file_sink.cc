@@ -0,0 +1,240 @@
+// Copyright (C) 2021 twyleg
+#include "vectored_file_sink.h"
+
+#include <spdlog/sinks/rotating_file_sink.h>
+
+#include <fmt/format.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+
+namespace Logging {
+
+namespace {
+
+constexpr size_t CHUNK_SIZE = 16 * 1024;
+constexpr size_t MAX_IOVECS = IOV_MAX < 1024 ? IOV_MAX : 1024;
+
+}
+
+const VectoredFileSink::FlushPolicy VectoredFileSink::DEFAULT_FLUSH_POLICY{
+	spdlog::level::level_enum::err,
+	0,
+	std::chrono::milliseconds(0),
+	64 * 1024
+};
+
+VectoredFileSink::VectoredFileSink(const boost::filesystem::path& filePath, bool truncate, const FlushPolicy& flushPolicy,
+		size_t maxFileSize, size_t maxNumFiles, const LogIndexWriter::Policy& indexPolicy)
+	: mFilePath(filePath),
+	  mFlushPolicy(flushPolicy),
+	  mMaxFileSize(maxFileSize),
+	  mMaxNumFiles(maxNumFiles),
+	  mIndexPolicy(indexPolicy)
+{
+	if (mFilePath.has_parent_path()) {
+		boost::filesystem::create_directories(mFilePath.parent_path());
+	}
+	openFile(truncate);
+
+	if (mFlushPolicy.mInterval.count() > 0) {
+		mFlushThread = std::thread(&VectoredFileSink::flushLoop, this);
+	}
+}
+
+VectoredFileSink::~VectoredFileSink() {
+	close();
+}
+
+void VectoredFileSink::close() {
+	if (mFlushThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mFlushMutex);
+			mStop = true;
+		}
+		mFlushCondition.notify_one();
+		mFlushThread.join();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	try {
+		writePending();
+	} catch (const spdlog::spdlog_ex& e) {
+		fmt::print(stderr, "[*** LOG ERROR ***] {}\n", e.what());
+	}
+	closeFile();
+}
+
+void VectoredFileSink::sink_it_(const spdlog::details::log_msg& msg) {
+	mRecord.clear();
+	formatter_->format(msg, mRecord);
+	writeRecord(msg, mRecord);
+}
+
+void VectoredFileSink::writeRecord(const spdlog::details::log_msg& msg, const spdlog::memory_buf_t& record) {
+	// A record larger than the maximum file size gets a file of its own, rotating out an
+	// empty file would only drop an older one
+	const size_t currentSize = mFileSize + mPendingBytes;
+	if (mMaxFileSize && currentSize > 0 && currentSize + record.size() > mMaxFileSize) {
+		writePending();
+		rotate();
+	}
+
+	const size_t offset = mFileSize + mPendingBytes;
+	append(record);
+	if (mIndexWriter) {
+		mIndexWriter->add(msg, offset, record.size());
+	}
+
+	const bool flushLevelReached = mFlushPolicy.mFlushLevel != spdlog::level::level_enum::off
+			&& msg.level >= mFlushPolicy.mFlushLevel;
+	const bool maxRecordsReached = mFlushPolicy.mMaxRecords && mPendingRecords >= mFlushPolicy.mMaxRecords;
+	const bool maxBytesReached = mFlushPolicy.mMaxBytes && mPendingBytes >= mFlushPolicy.mMaxBytes;
+	if (flushLevelReached || maxRecordsReached || maxBytesReached) {
+		writePending();
+	}
+}
+
+void VectoredFileSink::flush_() {
+	writePending();
+}
+
+void VectoredFileSink::dumpPending(int fd) const noexcept {
+	CrashHandler::write(fd, "--- unflushed records of ");
+	CrashHandler::write(fd, mFilePath.native());
+	CrashHandler::write(fd, " ---\n");
+	for (size_t i=0; i<mActiveChunks; ++i) {
+		CrashHandler::write(fd, mChunks[i].data(), mChunks[i].size());
+	}
+}
+
+void VectoredFileSink::append(const spdlog::memory_buf_t& record) {
+	if (mActiveChunks == 0 || mChunks[mActiveChunks - 1].size() + record.size() > CHUNK_SIZE) {
+		if (mActiveChunks == mChunks.size()) {
+			mChunks.emplace_back();
+		}
+		mChunks[mActiveChunks++].clear();
+	}
+
+	mChunks[mActiveChunks - 1].append(record.data(), record.data() + record.size());
+	mPendingRecords++;
+	mPendingBytes += record.size();
+}
+
+void VectoredFileSink::writePending() {
+	size_t chunk = 0;
+	size_t offset = 0;
+
+	while (chunk < mActiveChunks) {
+		iovec iov[MAX_IOVECS];
+		size_t iovCount = 0;
+		for (size_t i=chunk; i<mActiveChunks && iovCount<MAX_IOVECS; ++i, ++iovCount) {
+			const size_t skip = i == chunk ? offset : 0;
+			iov[iovCount].iov_base = mChunks[i].data() + skip;
+			iov[iovCount].iov_len = mChunks[i].size() - skip;
+		}
+
+		const ssize_t written = ::writev(mFd, iov, static_cast<int>(iovCount));
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw spdlog::spdlog_ex(fmt::format("Failed to write log file {}", mFilePath.string()), errno);
+		}
+		mFileSize += static_cast<size_t>(written);
+
+		size_t remaining = static_cast<size_t>(written);
+		while (chunk < mActiveChunks && remaining >= mChunks[chunk].size() - offset) {
+			remaining -= mChunks[chunk].size() - offset;
+			offset = 0;
+			chunk++;
+		}
+		offset += remaining;
+	}
+
+	mActiveChunks = 0;
+	mPendingRecords = 0;
+	mPendingBytes = 0;
+
+	if (mIndexWriter) {
+		mIndexWriter->write();
+	}
+}
+
+void VectoredFileSink::openFile(bool truncate) {
+	const int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+	mFd = ::open(mFilePath.c_str(), flags, 0644);
+	if (mFd < 0) {
+		throw spdlog::spdlog_ex(fmt::format("Failed to open log file {}", mFilePath.string()), errno);
+	}
+
+	struct stat fileStat;
+	mFileSize = ::fstat(mFd, &fileStat) == 0 ? static_cast<size_t>(fileStat.st_size) : 0;
+
+	if (mIndexPolicy.enabled()) {
+		mIndexWriter = std::make_unique<LogIndexWriter>(mFilePath, truncate, mIndexPolicy);
+	} else if (truncate) {
+		boost::system::error_code ec;
+		boost::filesystem::remove(LogIndex::indexPath(mFilePath), ec);
+	}
+}
+
+void VectoredFileSink::closeFile() {
+	mIndexWriter.reset();
+	if (mFd >= 0) {
+		::close(mFd);
+		mFd = -1;
+	}
+}
+
+void VectoredFileSink::rotate() {
+	using RotatingFileSink = spdlog::sinks::rotating_file_sink_mt;
+
+	closeFile();
+	for (size_t i=mMaxNumFiles; i>0; --i) {
+		const auto source = RotatingFileSink::calc_filename(mFilePath.string(), i - 1);
+		const auto target = RotatingFileSink::calc_filename(mFilePath.string(), i);
+		if (boost::filesystem::exists(source)) {
+			boost::system::error_code ec;
+			boost::filesystem::rename(source, target, ec);
+			boost::filesystem::remove(LogIndex::indexPath(target), ec);
+			boost::filesystem::rename(LogIndex::indexPath(source), LogIndex::indexPath(target), ec);
+		}
+	}
+	openFile(true);
+}
+
+boost::filesystem::path VectoredFileSink::swapFile(int fd, const boost::filesystem::path& filePath) {
+	closeFile();
+	mFd = fd;
+
+	struct stat fileStat;
+	mFileSize = ::fstat(mFd, &fileStat) == 0 ? static_cast<size_t>(fileStat.st_size) : 0;
+
+	auto previousFilePath = std::move(mFilePath);
+	mFilePath = filePath;
+	if (mIndexPolicy.enabled()) {
+		mIndexWriter = std::make_unique<LogIndexWriter>(mFilePath, true, mIndexPolicy);
+	}
+	return previousFilePath;
+}
+
+void VectoredFileSink::flushLoop() {
+	std::unique_lock<std::mutex> flushLock(mFlushMutex);
+	while (!mFlushCondition.wait_for(flushLock, mFlushPolicy.mInterval, [this]() { return mStop; })) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		try {
+			writePending();
+		} catch (const spdlog::spdlog_ex& e) {
+			fmt::print(stderr, "[*** LOG ERROR ***] {}\n", e.what());
+		}
+	}
+}
+
+}
@@ -0,0 +1,89 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "crash_handler.h"
+#include "log_index.h"
+
+#include <spdlog/sinks/base_sink.h>
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Logging {
+
+// File sink that gathers formatted records in memory and writes them with writev
+// whenever the flush policy triggers. Rotates like spdlog's rotating_file_sink when
+// a maximum file size is given. Writes a LogIndex next to the file when an index
+// policy is given.
+class VectoredFileSink : public spdlog::sinks::base_sink<std::mutex>, public CrashDumpSink {
+
+public:
+
+	struct FlushPolicy {
+		spdlog::level::level_enum mFlushLevel;
+		size_t mMaxRecords;
+		std::chrono::milliseconds mInterval;
+		size_t mMaxBytes;
+	};
+
+	static const FlushPolicy DEFAULT_FLUSH_POLICY;
+
+	VectoredFileSink(const boost::filesystem::path& filePath, bool truncate, const FlushPolicy& = DEFAULT_FLUSH_POLICY,
+			size_t maxFileSize = 0, size_t maxNumFiles = 0, const LogIndexWriter::Policy& = LogIndexWriter::DISABLED);
+	~VectoredFileSink() override;
+
+	const boost::filesystem::path& getFilePath() const { return mFilePath; }
+
+	void dumpPending(int fd) const noexcept override;
+
+protected:
+
+	void sink_it_(const spdlog::details::log_msg&) override;
+	void flush_() override;
+
+	// Appends an already formatted record, called with the sink mutex held
+	void writeRecord(const spdlog::details::log_msg&, const spdlog::memory_buf_t& record);
+	// Called with the sink mutex held once the file would exceed the maximum size
+	virtual void rotate();
+	// Continues with the already opened file and returns the path of the previous one
+	boost::filesystem::path swapFile(int fd, const boost::filesystem::path& filePath);
+	// Writes the pending records and closes the file, nothing is logged afterwards
+	void close();
+
+private:
+
+	void append(const spdlog::memory_buf_t&);
+	void writePending();
+	void openFile(bool truncate);
+	void closeFile();
+	void flushLoop();
+
+	boost::filesystem::path mFilePath;
+	const FlushPolicy mFlushPolicy;
+	const size_t mMaxFileSize;
+	const size_t mMaxNumFiles;
+	const LogIndexWriter::Policy mIndexPolicy;
+
+	int mFd = -1;
+	std::unique_ptr<LogIndexWriter> mIndexWriter;
+	size_t mFileSize = 0;
+
+	spdlog::memory_buf_t mRecord;
+	std::vector<spdlog::memory_buf_t> mChunks;
+	size_t mActiveChunks = 0;
+	size_t mPendingRecords = 0;
+	size_t mPendingBytes = 0;
+
+	bool mStop = false;
+	std::mutex mFlushMutex;
+	std::condition_variable mFlushCondition;
+	std::thread mFlushThread;
+};
+
+}
@@ -0,0 +1,299 @@
+// Copyright (C) 2021 twyleg
+#include "log_filter_model.h"
+
+#include <algorithm>
+
+namespace Logging::Qt {
+
+namespace {
+
+constexpr uint64_t MIN_COMPACTION_INTERVAL = 65536;
+
+bool isTokenChar(unsigned char c) {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80;
+}
+
+unsigned char toLower(unsigned char c) {
+	return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+}
+
+template<class Callback>
+void forEachToken(std::string_view text, std::string& token, Callback&& callback) {
+	token.clear();
+	for (const char c: text) {
+		if (isTokenChar(static_cast<unsigned char>(c))) {
+			token.push_back(static_cast<char>(toLower(static_cast<unsigned char>(c))));
+		} else if (!token.empty()) {
+			callback(token);
+			token.clear();
+		}
+	}
+	if (!token.empty()) {
+		callback(token);
+		token.clear();
+	}
+}
+
+bool containsToken(std::string_view message, const std::string& token) {
+	const auto it = std::search(message.begin(), message.end(), token.begin(), token.end(),
+			[](char a, char b) {
+				return toLower(static_cast<unsigned char>(a)) == static_cast<unsigned char>(b);
+			});
+	return it != message.end();
+}
+
+void addPosting(std::vector<uint64_t>& postings, uint64_t sequence) {
+	if (postings.empty() || postings.back() != sequence) {
+		postings.push_back(sequence);
+	}
+}
+
+void erasePostingsBefore(std::vector<uint64_t>& postings, uint64_t sequence) {
+	postings.erase(postings.begin(), std::lower_bound(postings.begin(), postings.end(), sequence));
+}
+
+}
+
+LogFilterModel::LogFilterModel(QObject* parent)
+	: QAbstractListModel(parent)
+{}
+
+void LogFilterModel::setSourceModel(LogModel* sourceModel) {
+	if (mSourceModel) {
+		disconnect(mSourceModel, nullptr, this, nullptr);
+	}
+
+	mSourceModel = sourceModel;
+	if (mSourceModel) {
+		connect(mSourceModel, &QAbstractItemModel::rowsInserted, this, &LogFilterModel::onRowsInserted);
+		connect(mSourceModel, &QAbstractItemModel::rowsRemoved, this, &LogFilterModel::onRowsRemoved);
+		connect(mSourceModel, &QAbstractItemModel::modelReset, this, &LogFilterModel::rebuildIndex);
+	}
+	rebuildIndex();
+}
+
+int LogFilterModel::rowCount(const QModelIndex& parent) const {
+	return parent.isValid() ? 0 : static_cast<int>(mRows.size());
+}
+
+QVariant LogFilterModel::data(const QModelIndex& index, int role) const {
+	if (!mSourceModel || !index.isValid() || index.row() >= rowCount()) {
+		return QVariant();
+	}
+	const int sourceRow = static_cast<int>(mRows[static_cast<size_t>(index.row())] - mSourceModel->firstSequence());
+	return mSourceModel->data(mSourceModel->index(sourceRow), role);
+}
+
+QHash<int, QByteArray> LogFilterModel::roleNames() const {
+	return mSourceModel ? mSourceModel->roleNames() : QAbstractListModel::roleNames();
+}
+
+void LogFilterModel::setMinimumLevel(int level) {
+	if (level == mMinimumLevel) {
+		return;
+	}
+	mMinimumLevel = level;
+	applyFilter();
+	emit minimumLevelChanged();
+}
+
+void LogFilterModel::setModules(const QStringList& modules) {
+	if (modules == mModules) {
+		return;
+	}
+	mModules = modules;
+	mModuleSelection.clear();
+	applyFilter();
+	emit modulesChanged();
+}
+
+void LogFilterModel::setSearchText(const QString& searchText) {
+	if (searchText == mSearchText) {
+		return;
+	}
+	mSearchText = searchText;
+
+	const QByteArray utf8 = searchText.toUtf8();
+	std::string token;
+	mSearchTokens.clear();
+	forEachToken(std::string_view(utf8.constData(), static_cast<size_t>(utf8.size())), token, [this](const std::string& token) {
+		mSearchTokens.push_back(token);
+	});
+
+	applyFilter();
+	emit searchTextChanged();
+}
+
+void LogFilterModel::onRowsInserted(const QModelIndex& parent, int first, int last) {
+	if (parent.isValid()) {
+		return;
+	}
+
+	const uint64_t firstSequence = mSourceModel->firstSequence();
+	std::vector<uint64_t> insertedRows;
+	for (int row=first; row<=last; ++row) {
+		indexRow(row);
+		if (matches(row)) {
+			insertedRows.push_back(firstSequence + static_cast<uint64_t>(row));
+		}
+	}
+
+	if (insertedRows.empty()) {
+		return;
+	}
+	const int firstRow = rowCount();
+	beginInsertRows(QModelIndex(), firstRow, firstRow + static_cast<int>(insertedRows.size()) - 1);
+	mRows.insert(mRows.end(), insertedRows.begin(), insertedRows.end());
+	endInsertRows();
+}
+
+void LogFilterModel::onRowsRemoved() {
+	const uint64_t firstSequence = mSourceModel->firstSequence();
+	const auto numRemovedRows = std::lower_bound(mRows.begin(), mRows.end(), firstSequence) - mRows.begin();
+	if (numRemovedRows > 0) {
+		beginRemoveRows(QModelIndex(), 0, static_cast<int>(numRemovedRows) - 1);
+		mRows.erase(mRows.begin(), mRows.begin() + numRemovedRows);
+		endRemoveRows();
+	}
+
+	const uint64_t numEvicted = firstSequence - mCompactedSequence;
+	if (numEvicted >= std::max(MIN_COMPACTION_INTERVAL, static_cast<uint64_t>(mSourceModel->rowCount()))) {
+		compactIndex();
+	}
+}
+
+void LogFilterModel::rebuildIndex() {
+	for (auto& postings: mLevelIndex) {
+		postings.clear();
+	}
+	mModuleIndex.clear();
+	mTokenIndex.clear();
+	mModuleSelection.clear();
+
+	if (mSourceModel) {
+		mCompactedSequence = mSourceModel->firstSequence();
+		for (int row=0; row<mSourceModel->rowCount(); ++row) {
+			indexRow(row);
+		}
+	}
+	applyFilter();
+}
+
+void LogFilterModel::indexRow(int row) {
+	const uint64_t sequence = mSourceModel->firstSequence() + static_cast<uint64_t>(row);
+
+	mLevelIndex[static_cast<size_t>(mSourceModel->levelAt(row))].push_back(sequence);
+
+	const uint16_t module = mSourceModel->moduleAt(row);
+	if (module >= mModuleIndex.size()) {
+		mModuleIndex.resize(module + 1u);
+	}
+	mModuleIndex[module].push_back(sequence);
+
+	std::string token;
+	forEachToken(mSourceModel->messageAt(row), token, [this, sequence](const std::string& token) {
+		addPosting(mTokenIndex[token], sequence);
+	});
+}
+
+void LogFilterModel::compactIndex() {
+	const uint64_t firstSequence = mSourceModel->firstSequence();
+	for (auto& postings: mLevelIndex) {
+		erasePostingsBefore(postings, firstSequence);
+	}
+	for (auto& postings: mModuleIndex) {
+		erasePostingsBefore(postings, firstSequence);
+	}
+	for (auto it = mTokenIndex.begin(); it != mTokenIndex.end();) {
+		erasePostingsBefore(it->second, firstSequence);
+		if (it->second.empty()) {
+			it = mTokenIndex.erase(it);
+		} else {
+			++it;
+		}
+	}
+	mCompactedSequence = firstSequence;
+}
+
+void LogFilterModel::applyFilter() {
+	beginResetModel();
+	mRows.clear();
+	if (mSourceModel) {
+		const uint64_t firstSequence = mSourceModel->firstSequence();
+		for (const uint64_t sequence: collectCandidates()) {
+			if (matches(static_cast<int>(sequence - firstSequence))) {
+				mRows.push_back(sequence);
+			}
+		}
+	}
+	endResetModel();
+}
+
+bool LogFilterModel::matches(int row) {
+	if (mSourceModel->levelAt(row) < mMinimumLevel) {
+		return false;
+	}
+	if (!mModules.isEmpty() && !isModuleSelected(mSourceModel->moduleAt(row))) {
+		return false;
+	}
+	const std::string_view message = mSourceModel->messageAt(row);
+	return std::all_of(mSearchTokens.begin(), mSearchTokens.end(), [message](const std::string& token) {
+		return containsToken(message, token);
+	});
+}
+
+bool LogFilterModel::isModuleSelected(uint16_t module) {
+	while (mModuleSelection.size() <= module) {
+		const auto& moduleName = mSourceModel->moduleName(static_cast<uint16_t>(mModuleSelection.size()));
+		mModuleSelection.push_back(mModules.contains(moduleName));
+	}
+	return mModuleSelection[module];
+}
+
+LogFilterModel::Postings LogFilterModel::collectCandidates() {
+	Postings candidates;
+
+	if (!mSearchTokens.empty()) {
+		// Search tokens may match anywhere inside a message token, so the vocabulary is
+		// scanned for the most selective (longest) search token; the others are verified.
+		const auto& searchToken = *std::max_element(mSearchTokens.begin(), mSearchTokens.end(),
+				[](const std::string& a, const std::string& b) {
+					return a.size() < b.size();
+				});
+		const uint64_t firstSequence = mSourceModel->firstSequence();
+		for (const auto& [token, postings]: mTokenIndex) {
+			if (token.find(searchToken) != std::string::npos) {
+				candidates.insert(candidates.end(), std::lower_bound(postings.begin(), postings.end(), firstSequence), postings.end());
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	} else if (!mModules.isEmpty()) {
+		for (uint16_t module=0; module<mModuleIndex.size(); ++module) {
+			if (isModuleSelected(module)) {
+				appendPostings(mModuleIndex[module], candidates);
+			}
+		}
+	} else if (mMinimumLevel > spdlog::level::trace) {
+		for (size_t level=static_cast<size_t>(std::max(mMinimumLevel, 0)); level<mLevelIndex.size(); ++level) {
+			appendPostings(mLevelIndex[level], candidates);
+		}
+	} else {
+		const uint64_t firstSequence = mSourceModel->firstSequence();
+		candidates.resize(static_cast<size_t>(mSourceModel->rowCount()));
+		for (size_t i=0; i<candidates.size(); ++i) {
+			candidates[i] = firstSequence + i;
+		}
+	}
+
+	return candidates;
+}
+
+void LogFilterModel::appendPostings(const Postings& postings, Postings& candidates) const {
+	const auto first = std::lower_bound(postings.begin(), postings.end(), mSourceModel->firstSequence());
+	const auto middle = static_cast<Postings::difference_type>(candidates.size());
+	candidates.insert(candidates.end(), first, postings.end());
+	std::inplace_merge(candidates.begin(), candidates.begin() + middle, candidates.end());
+}
+
+}
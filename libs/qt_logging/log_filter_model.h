@@ -0,0 +1,84 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include "log_model.h"
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QStringList>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Logging::Qt {
+
+// Filters a LogModel by minimum level, module and search text. Records are indexed
+// by level, module and message token as they arrive, so a filter change only visits
+// the candidate records of the most selective index instead of the whole history.
+class LogFilterModel : public QAbstractListModel
+{
+	Q_OBJECT
+	Q_PROPERTY(int minimumLevel READ minimumLevel WRITE setMinimumLevel NOTIFY minimumLevelChanged)
+	Q_PROPERTY(QStringList modules READ modules WRITE setModules NOTIFY modulesChanged)
+	Q_PROPERTY(QString searchText READ searchText WRITE setSearchText NOTIFY searchTextChanged)
+public:
+	explicit LogFilterModel(QObject* parent = nullptr);
+
+	void setSourceModel(LogModel* sourceModel);
+	LogModel* sourceModel() const { return mSourceModel; }
+
+	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = ::Qt::DisplayRole) const override;
+	QHash<int, QByteArray> roleNames() const override;
+
+	int minimumLevel() const { return mMinimumLevel; }
+	void setMinimumLevel(int level);
+
+	QStringList modules() const { return mModules; }
+	void setModules(const QStringList& modules);
+
+	QString searchText() const { return mSearchText; }
+	void setSearchText(const QString& searchText);
+
+signals:
+	void minimumLevelChanged();
+	void modulesChanged();
+	void searchTextChanged();
+
+private:
+	using Postings = std::vector<uint64_t>;
+
+	void onRowsInserted(const QModelIndex& parent, int first, int last);
+	void onRowsRemoved();
+	void rebuildIndex();
+	void indexRow(int row);
+	void compactIndex();
+	void applyFilter();
+
+	bool matches(int row);
+	bool isModuleSelected(uint16_t module);
+	Postings collectCandidates();
+	void appendPostings(const Postings& postings, Postings& candidates) const;
+
+	LogModel* mSourceModel = nullptr;
+
+	std::array<Postings, spdlog::level::n_levels> mLevelIndex;
+	std::vector<Postings> mModuleIndex;
+	std::unordered_map<std::string, Postings> mTokenIndex;
+	uint64_t mCompactedSequence = 0;
+
+	int mMinimumLevel = spdlog::level::trace;
+	QStringList mModules;
+	std::vector<char> mModuleSelection;
+	QString mSearchText;
+	std::vector<std::string> mSearchTokens;
+
+	std::deque<uint64_t> mRows;
+};
+
+}
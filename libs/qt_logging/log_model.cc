@@ -0,0 +1,175 @@
+// Copyright (C) 2021 twyleg
+#include "log_model.h"
+
+#include <QDateTime>
+
+#include <algorithm>
+
+namespace Logging::Qt {
+
+namespace {
+
+constexpr int DEFAULT_MAX_ROWS = 1000000;
+constexpr int64_t NANOSECONDS_PER_MILLISECOND = 1000000;
+
+QString formatTimestamp(int64_t timestamp) {
+	return QDateTime::fromMSecsSinceEpoch(timestamp / NANOSECONDS_PER_MILLISECOND).toString("yyyyMMdd-hh:mm:ss.zzz");
+}
+
+QString levelName(uint8_t level) {
+	const auto name = spdlog::level::to_string_view(static_cast<spdlog::level::level_enum>(level));
+	return QString::fromUtf8(name.data(), static_cast<int>(name.size()));
+}
+
+}
+
+LogModel::LogModel(QObject* parent)
+	: QAbstractListModel(parent),
+	  mMaxRows(DEFAULT_MAX_ROWS)
+{}
+
+int LogModel::rowCount(const QModelIndex& parent) const {
+	return parent.isValid() ? 0 : static_cast<int>(mSize);
+}
+
+QVariant LogModel::data(const QModelIndex& index, int role) const {
+	if (!index.isValid() || index.row() >= rowCount()) {
+		return QVariant();
+	}
+
+	const StoredRecord& record = recordAt(index.row());
+	switch (role) {
+	case ::Qt::DisplayRole:
+		return QString("[%1] [%2] [%3] [%4]: %5").arg(
+				formatTimestamp(record.mTimestamp),
+				QString::number(record.mThreadId),
+				mModuleNames[record.mModule],
+				levelName(record.mLevel),
+				QString::fromUtf8(record.mMessage.data(), static_cast<int>(record.mMessage.size())));
+	case TimestampRole:
+		return formatTimestamp(record.mTimestamp);
+	case LevelRole:
+		return static_cast<int>(record.mLevel);
+	case LevelNameRole:
+		return levelName(record.mLevel);
+	case ModuleRole:
+		return mModuleNames[record.mModule];
+	case ThreadRole:
+		return static_cast<uint>(record.mThreadId);
+	case MessageRole:
+		return QString::fromUtf8(record.mMessage.data(), static_cast<int>(record.mMessage.size()));
+	default:
+		return QVariant();
+	}
+}
+
+QHash<int, QByteArray> LogModel::roleNames() const {
+	return {
+		{::Qt::DisplayRole, "display"},
+		{TimestampRole, "timestamp"},
+		{LevelRole, "level"},
+		{LevelNameRole, "levelName"},
+		{ModuleRole, "module"},
+		{ThreadRole, "thread"},
+		{MessageRole, "message"}
+	};
+}
+
+void LogModel::appendRecords(std::vector<LogRecord>& records) {
+	if (records.empty()) {
+		return;
+	}
+
+	const size_t numNewRows = std::min(records.size(), static_cast<size_t>(mMaxRows));
+	const size_t numRetainedRows = std::min(mSize, static_cast<size_t>(mMaxRows) - numNewRows);
+	removeOldestRows(static_cast<int>(mSize - numRetainedRows));
+
+	const int firstRow = static_cast<int>(mSize);
+	beginInsertRows(QModelIndex(), firstRow, firstRow + static_cast<int>(numNewRows) - 1);
+	for (size_t i=records.size()-numNewRows; i<records.size(); ++i) {
+		LogRecord& record = records[i];
+		StoredRecord storedRecord{
+			record.mTimestamp,
+			static_cast<uint32_t>(record.mThreadId),
+			internModule(record.mModule),
+			static_cast<uint8_t>(record.mLevel),
+			std::move(record.mMessage)
+		};
+
+		if (mRecords.size() < static_cast<size_t>(mMaxRows)) {
+			mRecords.push_back(std::move(storedRecord));
+		} else {
+			mRecords[(mFirst + mSize) % mRecords.size()] = std::move(storedRecord);
+		}
+		mSize++;
+	}
+	endInsertRows();
+}
+
+void LogModel::setMaxRows(int maxRows) {
+	maxRows = std::max(1, maxRows);
+
+	beginResetModel();
+	const size_t numRetainedRows = std::min(mSize, static_cast<size_t>(maxRows));
+	std::vector<StoredRecord> records;
+	records.reserve(numRetainedRows);
+	for (size_t row=mSize-numRetainedRows; row<mSize; ++row) {
+		records.push_back(std::move(mRecords[(mFirst + row) % mRecords.size()]));
+	}
+	mRecords = std::move(records);
+	mFirstSequence += mSize - numRetainedRows;
+	mFirst = 0;
+	mSize = numRetainedRows;
+	mMaxRows = maxRows;
+	endResetModel();
+}
+
+spdlog::level::level_enum LogModel::levelAt(int row) const {
+	return static_cast<spdlog::level::level_enum>(recordAt(row).mLevel);
+}
+
+uint16_t LogModel::moduleAt(int row) const {
+	return recordAt(row).mModule;
+}
+
+std::string_view LogModel::messageAt(int row) const {
+	return recordAt(row).mMessage;
+}
+
+const LogModel::StoredRecord& LogModel::recordAt(int row) const {
+	return mRecords[(mFirst + static_cast<size_t>(row)) % mRecords.size()];
+}
+
+uint16_t LogModel::internModule(const std::string& module) {
+	const QString moduleName = QString::fromStdString(module);
+	const auto it = mModuleIndices.constFind(moduleName);
+	if (it != mModuleIndices.constEnd()) {
+		return it.value();
+	}
+	const auto index = static_cast<uint16_t>(mModuleNames.size());
+	mModuleNames.append(moduleName);
+	mModuleIndices.insert(moduleName, index);
+	return index;
+}
+
+void LogModel::removeOldestRows(int count) {
+	if (count <= 0) {
+		return;
+	}
+	beginRemoveRows(QModelIndex(), 0, count - 1);
+	for (int i=0; i<count; ++i) {
+		mRecords[mFirst].mMessage.clear();
+		mRecords[mFirst].mMessage.shrink_to_fit();
+		mFirst = (mFirst + 1) % mRecords.size();
+	}
+	mSize -= static_cast<size_t>(count);
+	mFirstSequence += static_cast<uint64_t>(count);
+	if (mSize == 0) {
+		// Restart at the front, appends to a ring that is still growing expect it to start there
+		mRecords.clear();
+		mFirst = 0;
+	}
+	endRemoveRows();
+}
+
+}
@@ -0,0 +1,85 @@
+// Copyright (C) 2021 twyleg
+#pragma once
+
+#include <spdlog/common.h>
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Logging::Qt {
+
+struct LogRecord {
+	int64_t mTimestamp;
+	uint64_t mThreadId;
+	spdlog::level::level_enum mLevel;
+	std::string mModule;
+	std::string mMessage;
+};
+
+// Keeps the newest records in a bounded ring. Messages stay UTF-8 and module names
+// are interned; QStrings are only created for the rows a view asks for.
+class LogModel : public QAbstractListModel
+{
+	Q_OBJECT
+public:
+	enum Roles {
+		TimestampRole = ::Qt::UserRole + 1,
+		LevelRole,
+		LevelNameRole,
+		ModuleRole,
+		ThreadRole,
+		MessageRole
+	};
+	Q_ENUM(Roles)
+
+	explicit LogModel(QObject* parent = nullptr);
+
+	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = ::Qt::DisplayRole) const override;
+	QHash<int, QByteArray> roleNames() const override;
+
+	void appendRecords(std::vector<LogRecord>& records);
+
+	void setMaxRows(int maxRows);
+	int maxRows() const { return mMaxRows; }
+
+	// Rows move up as the oldest records are dropped; sequence numbers stay with a record.
+	uint64_t firstSequence() const { return mFirstSequence; }
+	spdlog::level::level_enum levelAt(int row) const;
+	uint16_t moduleAt(int row) const;
+	std::string_view messageAt(int row) const;
+
+	int moduleCount() const { return mModuleNames.size(); }
+	const QString& moduleName(uint16_t module) const { return mModuleNames[module]; }
+
+private:
+	struct StoredRecord {
+		int64_t mTimestamp;
+		uint32_t mThreadId;
+		uint16_t mModule;
+		uint8_t mLevel;
+		std::string mMessage;
+	};
+
+	const StoredRecord& recordAt(int row) const;
+	uint16_t internModule(const std::string& module);
+	void removeOldestRows(int count);
+
+	std::vector<StoredRecord> mRecords;
+	size_t mFirst = 0;
+	size_t mSize = 0;
+	uint64_t mFirstSequence = 0;
+	int mMaxRows;
+
+	QVector<QString> mModuleNames;
+	QHash<QString, uint16_t> mModuleIndices;
+};
+
+}
@@ -1,47 +1,73 @@
 // Copyright (C) 2021 twyleg
 #include "sinks.h"
 
-#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
 
 namespace Logging::Qt {
 
 namespace {
-QString removeLastNewLine(const QString& initialString) {
-	int pos = initialString.lastIndexOf(QChar('\n'));
 
-	if (pos != -1) {
-		return initialString.left(pos);
+// Larger buffers are handed over to the model instead of staying parked in a queue cell
+constexpr size_t MAX_RETAINED_CAPACITY = 4096;
+
+void takeString(std::string& from, std::string& to) {
+	if (from.capacity() > MAX_RETAINED_CAPACITY) {
+		to = std::move(from);
+		from = std::string();
 	} else {
-		return initialString;
+		to.assign(from);
 	}
 }
+
 }
 
-QStringListModelSink::QStringListModelSink()
+const QStringListModelSink::Parameters QStringListModelSink::DEFAULT_PARAMETERS{
+	30,
+	1000000,
+	16384
+};
+
+QStringListModelSink::QStringListModelSink(const Parameters& parameters)
 	: QObject(),
-	  base_sink(),
-	  mStringListModel(this)
+	  spdlog::sinks::sink(),
+	  mLogModel(this),
+	  mQueue(parameters.mQueueSize),
+	  mPublishTimer(this)
 {
-	QObject::connect(
-			this, SIGNAL(messageAdded(QString)),
-			this, SLOT(addMessage(QString)),
-			::Qt::QueuedConnection
-	);
-}
+	mLogModel.setMaxRows(parameters.mMaxRows);
 
-void QStringListModelSink::addMessage(QString message) {
-	mStringListModel.insertRow(mStringListModel.rowCount());
-	QModelIndex index = mStringListModel.index(mStringListModel.rowCount()-1);
-	mStringListModel.setData(index, message);
+	QObject::connect(&mPublishTimer, &QTimer::timeout, this, &QStringListModelSink::publishMessages);
+	mPublishTimer.setInterval(1000 / std::max(1, parameters.mFrameRate));
+	mPublishTimer.start();
 }
 
-void QStringListModelSink::sink_it_(const spdlog::details::log_msg& msg) {
-	spdlog::memory_buf_t formatted;
-	base_sink::formatter_->format(msg, formatted);
-	QString str = removeLastNewLine(QString::fromStdString(fmt::to_string(formatted)));
-	emit messageAdded(str);
+void QStringListModelSink::publishMessages() {
+	LogRecord record;
+	while (mQueue.tryPopWith([&record](LogRecord& queued) {
+		record.mTimestamp = queued.mTimestamp;
+		record.mThreadId = queued.mThreadId;
+		record.mLevel = queued.mLevel;
+		takeString(queued.mModule, record.mModule);
+		takeString(queued.mMessage, record.mMessage);
+	})) {
+		mBatch.push_back(std::move(record));
+	}
+	mLogModel.appendRecords(mBatch);
+	mBatch.clear();
 }
 
-void QStringListModelSink::flush_() {}
+void QStringListModelSink::log(const spdlog::details::log_msg& msg) {
+	const bool pushed = mQueue.tryPushWith([&msg](LogRecord& record) {
+		record.mTimestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count();
+		record.mThreadId = msg.thread_id;
+		record.mLevel = msg.level;
+		record.mModule.assign(msg.logger_name.data(), msg.logger_name.size());
+		record.mMessage.assign(msg.payload.data(), msg.payload.size());
+	});
+	if (!pushed) {
+		mDropped.fetch_add(1, std::memory_order_relaxed);
+	}
+}
 
 }
@@ -1,35 +1,59 @@
 // Copyright (C) 2021 twyleg
 #pragma once
-#include <spdlog/sinks/base_sink.h>
-#include "spdlog/details/null_mutex.h"
+#include "log_model.h"
+
+#include <logging/bounded_queue.h>
+
+#include <spdlog/sinks/sink.h>
 
 #include <QObject>
-#include <QStringListModel>
+#include <QTimer>
 
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
 
-namespace Logging::Qt {
 
-using base_sink = spdlog::sinks::base_sink <spdlog::details::null_mutex>;
+namespace Logging::Qt {
 
-class QStringListModelSink : public QObject, public base_sink
+// Collects records in a lock-free queue and publishes them to the model in
+// batches from a timer on the GUI thread. Producers from any thread copy the
+// record fields straight into a queue cell, reusing its buffers; no formatter or
+// other shared state is touched on the logging path. Formatting is left to the
+// model, so patterns set on the sink are ignored.
+class QStringListModelSink : public QObject, public spdlog::sinks::sink
 {
 	Q_OBJECT
 public:
-	QStringListModelSink();
+	struct Parameters {
+		int mFrameRate;
+		int mMaxRows;
+		size_t mQueueSize;
+	};
 
-	QStringListModel mStringListModel;
+	static const Parameters DEFAULT_PARAMETERS;
 
-public slots:
-	void addMessage(QString message);
+	explicit QStringListModelSink(const Parameters& parameters = DEFAULT_PARAMETERS);
 
-signals:
-	void messageAdded(QString);
+	void log(const spdlog::details::log_msg& msg) override;
+	void flush() override {}
+	void set_pattern(const std::string&) override {}
+	void set_formatter(std::unique_ptr<spdlog::formatter>) override {}
 
-protected:
-	void sink_it_(const spdlog::details::log_msg& msg) override;
-	void flush_() override;
+	uint64_t droppedMessages() const { return mDropped.load(std::memory_order_relaxed); }
+
+	LogModel mLogModel;
+
+public slots:
+	void publishMessages();
+
+private:
+	BoundedQueue<LogRecord> mQueue;
+	std::vector<LogRecord> mBatch;
+	std::atomic<uint64_t> mDropped{0};
+	QTimer mPublishTimer;
 };
 
 
 }
-
@@ -1,18 +1,98 @@
 // Copyright (C) 2021 twyleg
 #include "utils.h"
 
-#include <logging/logger.h>
-
 #include <QObject>
 
+#include <atomic>
+#include <mutex>
+#include <string_view>
+
 namespace Logging::Qt {
 
 namespace {
 
-std::unordered_map<std::string, std::shared_ptr<spdlog::logger>> QT_LOG_MODULES({
-	{"qml", Logging::Logger::addModule("qml")},
-	{"js", Logging::Logger::addModule("qml_js")}
-});
+const Logger::Config::CategoryModuleMap DEFAULT_CATEGORY_MODULES{
+	{"qml", "qml"},
+	{"js", "qml_js"}
+};
+
+std::mutex categoryModulesMutex;
+std::unordered_map<std::string, std::shared_ptr<Module>> categoryModules;
+std::atomic<uint64_t> categoryModulesGeneration{1};
+
+// Category names are static strings in practice, so each thread resolves a category
+// pointer once and afterwards only compares pointers. Unknown categories map to nullptr.
+struct CategoryCache {
+	uint64_t mGeneration = 0;
+	const char* mLastCategory = nullptr;
+	Module* mLastModule = nullptr;
+	std::unordered_map<const char*, Module*> mModules;
+};
+
+thread_local CategoryCache categoryCache;
+thread_local std::string messageBuffer;
+
+std::shared_ptr<Module> getOrAddModule(const std::string& name) {
+	auto module = std::dynamic_pointer_cast<Module>(spdlog::get(name));
+	return module ? module : Logger::addModule(name);
+}
+
+Module* resolveCategory(const char* category) {
+	auto& cache = categoryCache;
+	const uint64_t generation = categoryModulesGeneration.load(std::memory_order_acquire);
+	if (cache.mGeneration != generation) {
+		cache.mModules.clear();
+		cache.mLastCategory = nullptr;
+		cache.mGeneration = generation;
+	}
+	if (category == cache.mLastCategory) {
+		return cache.mLastModule;
+	}
+
+	auto it = cache.mModules.find(category);
+	if (it == cache.mModules.end()) {
+		Module* module = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(categoryModulesMutex);
+			const auto moduleIt = categoryModules.find(category);
+			if (moduleIt != categoryModules.end()) {
+				module = moduleIt->second.get();
+			}
+		}
+		it = cache.mModules.emplace(category, module).first;
+	}
+
+	cache.mLastCategory = category;
+	cache.mLastModule = it->second;
+	return it->second;
+}
+
+void appendUtf8(const QString& string, std::string& out) {
+	const auto* data = reinterpret_cast<const char16_t*>(string.utf16());
+	const auto size = static_cast<size_t>(string.size());
+	for (size_t i=0; i<size; ++i) {
+		uint32_t codePoint = data[i];
+		if (codePoint >= 0xd800 && codePoint < 0xdc00 && i + 1 < size && data[i + 1] >= 0xdc00 && data[i + 1] < 0xe000) {
+			codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (data[++i] - 0xdc00);
+		}
+
+		if (codePoint < 0x80) {
+			out.push_back(static_cast<char>(codePoint));
+		} else if (codePoint < 0x800) {
+			out.push_back(static_cast<char>(0xc0 | (codePoint >> 6)));
+			out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+		} else if (codePoint < 0x10000) {
+			out.push_back(static_cast<char>(0xe0 | (codePoint >> 12)));
+			out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+			out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+		} else {
+			out.push_back(static_cast<char>(0xf0 | (codePoint >> 18)));
+			out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+			out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+			out.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+		}
+	}
+}
 
 spdlog::level::level_enum qtMsgTypeToSpdlogLevel(QtMsgType type) {
 
@@ -34,26 +114,44 @@ spdlog::level::level_enum qtMsgTypeToSpdlogLevel(QtMsgType type) {
 
 void redirectQtLogMessages(QtMsgType type, const QMessageLogContext &context, const QString &msg) {
 
-	QByteArray localMsg = msg.toLocal8Bit();
-	const char *file = context.file ? context.file : "";
-	const char *function = context.function ? context.function : "";
-	const char *category = context.category ? context.category : "";
+	Module* qtLogModule = resolveCategory(context.category ? context.category : "");
+	if (!qtLogModule) {
+		return;
+	}
 
-	auto qtLogModuleIt = QT_LOG_MODULES.find(category);
-	if (qtLogModuleIt == QT_LOG_MODULES.end()) {
+	const auto logLevel = qtMsgTypeToSpdlogLevel(type);
+	// Qt messages have no LOG call site, only the module rate limit applies
+	if (!shouldLog(*qtLogModule, logLevel) || !admit(*qtLogModule, logLevel, nullptr)) {
 		return;
 	}
 
-	auto qtLogModule = qtLogModuleIt->second;
-	auto logLevel = qtMsgTypeToSpdlogLevel(type);
+	const char *file = context.file ? context.file : "";
+	const char *function = context.function ? context.function : "";
+
+	auto& localMsg = messageBuffer;
+	localMsg.clear();
+	appendUtf8(msg, localMsg);
 
-	qtLogModule->log(logLevel, "{} ({}:{}, {})", localMsg.constData(), file, context.line, function);
+	qtLogModule->log(logLevel, "{} ({}:{}, {})", std::string_view(localMsg), file, context.line, function);
 }
 
 }
 
-void initQmlLoggerRedirection() {
+void initQmlLoggerRedirection(const Logger::Config::CategoryModuleMap& categoryModuleMap) {
+	setCategoryModules(categoryModuleMap);
 	qInstallMessageHandler(redirectQtLogMessages);
 }
 
+void setCategoryModules(const Logger::Config::CategoryModuleMap& categoryModuleMap) {
+	std::lock_guard<std::mutex> lock(categoryModulesMutex);
+	categoryModules.clear();
+	for (const auto& [category, module]: DEFAULT_CATEGORY_MODULES) {
+		categoryModules[category] = getOrAddModule(module);
+	}
+	for (const auto& [category, module]: categoryModuleMap) {
+		categoryModules[category] = getOrAddModule(module);
+	}
+	categoryModulesGeneration.fetch_add(1, std::memory_order_release);
+}
+
 }
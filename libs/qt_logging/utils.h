@@ -1,9 +1,18 @@
 // Copyright (C) 2021 twyleg
 #pragma once
 
+#include <logging/logger.h>
+
 namespace Logging::Qt {
 
-void initQmlLoggerRedirection();
+// Redirects Qt log messages of the "qml" and "js" categories, plus the given
+// category to module mappings, to logging modules. Messages of other categories
+// are dropped.
+void initQmlLoggerRedirection(const Logger::Config::CategoryModuleMap& categoryModules = {});
+
+// Replaces the category to module mappings of the redirection, e.g. after the logger
+// config was reloaded. The "qml" and "js" categories stay mapped.
+void setCategoryModules(const Logger::Config::CategoryModuleMap& categoryModules);
 
 }
 
@@ -0,0 +1,188 @@
+// Copyright (C) 2021 twyleg
+#include <logging/async_sink.h>
+#include <logging/sinks.h>
+
+#include <spdlog/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+class BlockingSink : public StringContainerSink<std::vector, std::mutex> {
+
+public:
+
+	void release() {
+		std::lock_guard<std::mutex> lock(mGateMutex);
+		mReleased = true;
+		mGateCondition.notify_all();
+	}
+
+protected:
+
+	void sink_it_(const spdlog::details::log_msg& msg) override {
+		std::unique_lock<std::mutex> lock(mGateMutex);
+		mGateCondition.wait(lock, [this]() { return mReleased; });
+		lock.unlock();
+		StringContainerSink<std::vector, std::mutex>::sink_it_(msg);
+	}
+
+private:
+
+	std::mutex mGateMutex;
+	std::condition_variable mGateCondition;
+	bool mReleased = false;
+};
+
+class ThrowingSink : public spdlog::sinks::base_sink<std::mutex> {
+
+protected:
+
+	void sink_it_(const spdlog::details::log_msg&) override {
+		throw spdlog::spdlog_ex("sink failed");
+	}
+
+	void flush_() override {}
+};
+
+// Writes records concurrently and slowly, counts the ones with the given payload
+class SlowCountingSink : public spdlog::sinks::sink {
+
+public:
+
+	explicit SlowCountingSink(std::string payload)
+		: mPayload(std::move(payload))
+	{}
+
+	void log(const spdlog::details::log_msg& msg) override {
+		std::this_thread::sleep_for(std::chrono::microseconds(20));
+		if (std::string_view(msg.payload.data(), msg.payload.size()) == mPayload) {
+			mCount.fetch_add(1);
+		}
+	}
+
+	void flush() override {}
+	void set_pattern(const std::string&) override {}
+	void set_formatter(std::unique_ptr<spdlog::formatter>) override {}
+
+	int getCount() const { return mCount.load(); }
+
+private:
+
+	const std::string mPayload;
+	std::atomic<int> mCount{0};
+};
+
+}
+
+class AsyncSinkTest : public ::testing::Test {
+
+protected:
+
+	std::shared_ptr<spdlog::logger> createLogger(AsyncSink::OverflowPolicy overflowPolicy) {
+		mAsyncSink = std::make_shared<AsyncSink>(AsyncSink::Parameters{4, overflowPolicy, 1},
+				std::vector<spdlog::sink_ptr>{mBlockingSink});
+		mAsyncSink->set_pattern("%v");
+		return std::make_shared<spdlog::logger>("async_test", mAsyncSink);
+	}
+
+	std::shared_ptr<BlockingSink> mBlockingSink = std::make_shared<BlockingSink>();
+	std::shared_ptr<AsyncSink> mAsyncSink;
+};
+
+TEST_F(AsyncSinkTest, DropNewest_QueueOverflow_NewestMessagesDroppedAndCounted) {
+	auto logger = createLogger(AsyncSink::OverflowPolicy::DROP_NEWEST);
+
+	for (int i=0; i<20; ++i) {
+		logger->info("message {}", i);
+	}
+	mBlockingSink->release();
+	logger->flush();
+
+	const auto statistics = mAsyncSink->getStatistics();
+	const auto& messages = mBlockingSink->getContainer();
+	EXPECT_GT(statistics.mDroppedMessages, 0);
+	EXPECT_EQ(statistics.mEnqueuedMessages + statistics.mDroppedMessages, 20);
+	EXPECT_EQ(messages.size(), statistics.mEnqueuedMessages);
+	EXPECT_EQ(messages.front(), "message 0");
+	EXPECT_EQ(statistics.mQueueHighWaterMark, statistics.mQueueCapacity);
+}
+
+TEST_F(AsyncSinkTest, DropOldest_QueueOverflow_NewestMessagesKept) {
+	auto logger = createLogger(AsyncSink::OverflowPolicy::DROP_OLDEST);
+
+	for (int i=0; i<20; ++i) {
+		logger->info("message {}", i);
+	}
+	mBlockingSink->release();
+	logger->flush();
+
+	const auto statistics = mAsyncSink->getStatistics();
+	const auto& messages = mBlockingSink->getContainer();
+	EXPECT_GT(statistics.mDroppedMessages, 0);
+	EXPECT_EQ(messages.size() + statistics.mDroppedMessages, 20);
+	EXPECT_EQ(messages.back(), "message 19");
+}
+
+TEST_F(AsyncSinkTest, Block_QueueOverflow_NoMessageDropped) {
+	auto logger = createLogger(AsyncSink::OverflowPolicy::BLOCK);
+	mBlockingSink->release();
+
+	for (int i=0; i<1000; ++i) {
+		logger->info("message {}", i);
+	}
+	logger->flush();
+
+	EXPECT_EQ(mAsyncSink->getStatistics().mDroppedMessages, 0);
+	EXPECT_EQ(mBlockingSink->getContainer().size(), 1000);
+}
+
+TEST(AsyncSinkErrorTest, SinkThrows_Log_OtherSinksAndLaterRecordsWritten) {
+	auto stringVectorSink = std::make_shared<StringContainerSink<std::vector, std::mutex>>();
+	auto asyncSink = std::make_shared<AsyncSink>(AsyncSink::Parameters{4, AsyncSink::OverflowPolicy::BLOCK, 1},
+			std::vector<spdlog::sink_ptr>{std::make_shared<ThrowingSink>(), stringVectorSink});
+	asyncSink->set_pattern("%v");
+	spdlog::logger logger("async_test", asyncSink);
+
+	logger.info("first");
+	logger.info("second");
+	logger.flush();
+
+	EXPECT_EQ(stringVectorSink->getContainer(), std::vector<std::string>({"first", "second"}));
+}
+
+TEST(AsyncSinkFlushTest, MultipleWorkersAndConcurrentLogging_Flush_EarlierRecordsWritten) {
+	auto countingSink = std::make_shared<SlowCountingSink>("flushed");
+	auto asyncSink = std::make_shared<AsyncSink>(AsyncSink::Parameters{256, AsyncSink::OverflowPolicy::BLOCK, 4},
+			std::vector<spdlog::sink_ptr>{countingSink});
+	spdlog::logger logger("async_test", asyncSink);
+
+	std::atomic<bool> stop{false};
+	std::thread noiseThread([&logger, &stop]() {
+		while (!stop.load()) {
+			logger.info("noise");
+		}
+	});
+
+	for (int i=1; i<=100; ++i) {
+		logger.info("flushed");
+		logger.flush();
+		EXPECT_EQ(countingSink->getCount(), i);
+	}
+
+	stop.store(true);
+	noiseThread.join();
+}
+
+}
@@ -0,0 +1,116 @@
+// Copyright (C) 2021 twyleg
+#include "helper.h"
+
+#include <logging/binary_file_sink.h>
+#include <logging/binary_log_reader.h>
+#include <logging/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+auto LM = Logging::Logger::addModule("binary_module");
+
+struct DecodedRecord {
+	std::string mModule;
+	spdlog::level::level_enum mLevel;
+	std::string mMessage;
+};
+
+}
+
+class BinaryFileSinkTest : public ::testing::Test {
+
+public:
+
+	BinaryFileSinkTest() {
+		createEmptyDirectory("./log/");
+		Logger::instance().removeAllSinks();
+		Logger::instance().setModuleLogLevel(*LM, LL_DEBUG);
+	}
+
+protected:
+
+	std::vector<DecodedRecord> readSegments() {
+		std::vector<boost::filesystem::path> segmentPaths;
+		for (const auto& entry: boost::filesystem::directory_iterator("./log/binary")) {
+			segmentPaths.push_back(entry.path());
+		}
+		std::sort(segmentPaths.begin(), segmentPaths.end());
+
+		std::vector<DecodedRecord> records;
+		for (const auto& segmentPath: segmentPaths) {
+			BinaryLogReader::readSegment(segmentPath, [&records](const spdlog::details::log_msg& msg) {
+				records.push_back({
+					std::string(msg.logger_name.data(), msg.logger_name.size()),
+					msg.level,
+					std::string(msg.payload.data(), msg.payload.size())
+				});
+			});
+		}
+		return records;
+	}
+};
+
+TEST_F(BinaryFileSinkTest, LogAndDeferredLog_ReadSegment_RecordsDecoded) {
+	auto sink = std::make_shared<BinaryFileSink>("./log/binary", "test", 64 * 1024);
+	Logger::instance().addSink(sink);
+
+	LOG(LM, LL_INFO, "preformatted {}", 42);
+	LOG_DEFERRED(LM, LL_WARN, "deferred {} {} {}", 1.5, "text", -7);
+	FLUSH_DEFERRED(LM);
+	Logger::instance().removeAllSinks();
+	sink.reset();
+
+	const auto records = readSegments();
+	ASSERT_EQ(records.size(), 2);
+	EXPECT_EQ(records[0].mModule, "binary_module");
+	EXPECT_EQ(records[0].mLevel, LL_INFO);
+	EXPECT_EQ(records[0].mMessage, "preformatted 42");
+	EXPECT_EQ(records[1].mLevel, LL_WARN);
+	EXPECT_EQ(records[1].mMessage, "deferred 1.5 text -7");
+}
+
+TEST_F(BinaryFileSinkTest, ModuleNameReusedForOtherModule_Log_RecordsDecodedWithTheirModules) {
+	auto sink = std::make_shared<BinaryFileSink>("./log/binary", "test", 64 * 1024);
+
+	// Both names share the same buffer, like a module created where a destroyed one lived
+	std::string moduleName = "first_module";
+	sink->log(spdlog::details::log_msg(moduleName, LL_INFO, "first"));
+	moduleName = "other_module";
+	sink->log(spdlog::details::log_msg(moduleName, LL_INFO, "second"));
+	sink.reset();
+
+	const auto records = readSegments();
+	ASSERT_EQ(records.size(), 2);
+	EXPECT_EQ(records[0].mModule, "first_module");
+	EXPECT_EQ(records[1].mModule, "other_module");
+}
+
+TEST_F(BinaryFileSinkTest, ManyRecords_Log_SegmentsRotatedAndSelfContained) {
+	auto sink = std::make_shared<BinaryFileSink>("./log/binary", "test", 4096);
+	Logger::instance().addSink(sink);
+
+	for (int i=0; i<1000; ++i) {
+		LOG_DEFERRED(LM, LL_DEBUG, "message {}", i);
+	}
+	FLUSH_DEFERRED(LM);
+	Logger::instance().removeAllSinks();
+	sink.reset();
+
+	EXPECT_GT(std::distance(boost::filesystem::directory_iterator("./log/binary"), boost::filesystem::directory_iterator()), 1);
+
+	const auto records = readSegments();
+	ASSERT_EQ(records.size(), 1000);
+	for (int i=0; i<1000; ++i) {
+		EXPECT_EQ(records[i].mMessage, fmt::format("message {}", i));
+		EXPECT_EQ(records[i].mModule, "binary_module");
+	}
+}
+
+}
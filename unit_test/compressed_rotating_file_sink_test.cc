@@ -0,0 +1,112 @@
+// Copyright (C) 2021 twyleg
+#include "helper.h"
+
+#include <logging/compressed_rotating_file_sink.h>
+
+#include <spdlog/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+const boost::filesystem::path LOG_DIR = "./log/compressed";
+const boost::filesystem::path LOG_FILE_PATH = LOG_DIR / "compressed.log";
+
+CompressedRotatingFileSink::Parameters createParameters(size_t maxFileSize, size_t maxTotalSize = 0) {
+	return {CompressedRotatingFileSink::Compression::GZIP, 6, maxFileSize, maxTotalSize};
+}
+
+std::vector<boost::filesystem::path> listFiles(const std::string& extension) {
+	std::vector<boost::filesystem::path> files;
+	for (const auto& entry: boost::filesystem::directory_iterator(LOG_DIR)) {
+		if (entry.path().extension() == extension) {
+			files.push_back(entry.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+}
+
+class CompressedRotatingFileSinkTest : public ::testing::Test {
+
+public:
+
+	CompressedRotatingFileSinkTest() {
+		createEmptyDirectory(LOG_DIR);
+	}
+
+protected:
+
+	std::shared_ptr<spdlog::logger> createLogger(std::shared_ptr<CompressedRotatingFileSink> sink) {
+		sink->set_pattern("%v");
+		return std::make_shared<spdlog::logger>("compressed", sink);
+	}
+};
+
+TEST_F(CompressedRotatingFileSinkTest, SegmentsFull_Rotate_FinishedSegmentsCompressed) {
+	auto sink = std::make_shared<CompressedRotatingFileSink>(LOG_FILE_PATH, createParameters(1024));
+	auto logger = createLogger(sink);
+
+	std::ostringstream expected;
+	for (int i=0; i<100; ++i) {
+		logger->info("message {:04}", i);
+		expected << fmt::format("message {:04}\n", i);
+	}
+	logger->flush();
+	sink->waitForCompression();
+
+	const auto compressedFiles = listFiles(".gz");
+	ASSERT_GT(compressedFiles.size(), 0);
+	EXPECT_EQ(listFiles(".log").size(), 2);
+
+	std::string content;
+	for (const auto& file: compressedFiles) {
+		content += readGzipFile(file);
+	}
+	content += readTextFile(sink->getFilePath());
+	EXPECT_EQ(content, expected.str());
+}
+
+TEST_F(CompressedRotatingFileSinkTest, CompressedSizeAboveLimit_Rotate_OldestSegmentsRemoved) {
+	auto sink = std::make_shared<CompressedRotatingFileSink>(LOG_FILE_PATH, createParameters(1024, 1024));
+	auto logger = createLogger(sink);
+
+	for (int i=0; i<2000; ++i) {
+		logger->info("message {:04} {:x}", i, i * 2654435761ull);
+	}
+	logger->flush();
+	sink->waitForCompression();
+
+	const auto compressedFiles = listFiles(".gz");
+	ASSERT_GT(compressedFiles.size(), 0);
+	uintmax_t compressedSize = 0;
+	for (const auto& file: compressedFiles) {
+		compressedSize += boost::filesystem::file_size(file);
+	}
+	EXPECT_LE(compressedSize, 1024);
+	EXPECT_EQ(readGzipFile(compressedFiles.back()).substr(0, 8), "message ");
+	EXPECT_NE(compressedFiles.front().filename().string(), "compressed.000000.log.gz");
+}
+
+TEST_F(CompressedRotatingFileSinkTest, ExistingSegments_Create_SequenceContinuedAndLeftoverCompressed) {
+	writeTextFile(LOG_DIR / "compressed.000004.log", "leftover\n");
+
+	auto sink = std::make_shared<CompressedRotatingFileSink>(LOG_FILE_PATH, createParameters(1024));
+	sink->waitForCompression();
+
+	EXPECT_EQ(sink->getFilePath().filename().string(), "compressed.000005.log");
+	EXPECT_EQ(readGzipFile(LOG_DIR / "compressed.000004.log.gz"), "leftover\n");
+	EXPECT_FALSE(boost::filesystem::exists(LOG_DIR / "compressed.000004.log"));
+}
+
+}
@@ -0,0 +1,149 @@
+// Copyright (C) 2021 twyleg
+#include "helper.h"
+
+#include <logging/logger.h>
+#include <logging/ring_buffer_sink.h>
+#include <logging/vectored_file_sink.h>
+
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace Logging::Testing {
+
+namespace {
+
+auto LM = Logging::Logger::addModule("crash_module");
+
+const boost::filesystem::path CRASH_DUMP_PATH = "./log/crash.log";
+const boost::filesystem::path LOG_FILE_PATH = "./log/crash_test.log";
+
+// Frames of 1 KiB, the depth limit is far beyond any thread stack and only keeps the
+// recursion finite for the compiler
+constexpr int MAX_OVERFLOW_DEPTH = 1024 * 1024;
+
+int overflowStack(int depth) {
+	if (depth > MAX_OVERFLOW_DEPTH) {
+		return 0;
+	}
+	volatile char frame[1024];
+	frame[0] = static_cast<char>(depth);
+	return overflowStack(depth + 1) + frame[0];
+}
+
+}
+
+class CrashHandlerTest : public ::testing::Test {
+
+public:
+
+	CrashHandlerTest() {
+		createEmptyDirectory("./log/");
+		Logger::instance().removeAllSinks();
+		Logger::instance().setModuleLogLevel(*LM, LL_DEBUG);
+	}
+
+protected:
+
+	static void logRecords() {
+		for (int i=0; i<10; ++i) {
+			LOG(LM, LL_INFO, "record before crash {}", i);
+		}
+	}
+
+	int runCrashingChild(const std::function<void()>& crash) {
+		const pid_t pid = ::fork();
+		if (pid == 0) {
+			Logger::instance().addSink(std::make_shared<RingBufferSink>(4, 256));
+			Logger::instance().addSink(std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true,
+					VectoredFileSink::FlushPolicy{LL_ERROR, 0, std::chrono::milliseconds(0), 0}));
+			Logger::instance().installCrashHandler(CRASH_DUMP_PATH);
+
+			crash();
+			::_exit(0);
+		}
+
+		int status = 0;
+		::waitpid(pid, &status, 0);
+		return status;
+	}
+};
+
+TEST_F(CrashHandlerTest, FatalSignal_CrashHandlerInstalled_BufferedRecordsDumped) {
+	const int status = runCrashingChild([]() {
+		logRecords();
+		::raise(SIGSEGV);
+	});
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	EXPECT_EQ(WTERMSIG(status), SIGSEGV);
+
+	EXPECT_TRUE(readTextFileToVector(LOG_FILE_PATH).empty());
+
+	const auto dump = readTextFile(CRASH_DUMP_PATH);
+	EXPECT_NE(dump.find("*** Fatal signal 11"), std::string::npos);
+	EXPECT_NE(dump.find("--- recent log records ---"), std::string::npos);
+	EXPECT_NE(dump.find("record before crash 9"), std::string::npos);
+	EXPECT_NE(dump.find("--- unflushed records of ./log/crash_test.log ---"), std::string::npos);
+	EXPECT_NE(dump.find("record before crash 0"), std::string::npos);
+}
+
+TEST_F(CrashHandlerTest, Abort_CrashHandlerInstalled_ProcessTerminatedBySignal) {
+	const int status = runCrashingChild([]() {
+		logRecords();
+		::raise(SIGABRT);
+	});
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	EXPECT_EQ(WTERMSIG(status), SIGABRT);
+	EXPECT_NE(readTextFile(CRASH_DUMP_PATH).find("*** Fatal signal 6"), std::string::npos);
+}
+
+TEST_F(CrashHandlerTest, CrashHandlerRemovedByReload_FatalSignal_NothingDumped) {
+	const auto config = [](const boost::optional<std::string>& crashDumpFile) {
+		return Logger::Config{LL_DEBUG, {}, {}, {}, boost::none, crashDumpFile, {}, {}, {}};
+	};
+
+	const pid_t pid = ::fork();
+	if (pid == 0) {
+		Logger::instance().addSink(std::make_shared<RingBufferSink>(4, 256));
+		Logger::instance().configure(config(CRASH_DUMP_PATH.string()));
+		Logger::instance().configure(config(boost::none));
+
+		logRecords();
+		::raise(SIGSEGV);
+		::_exit(0);
+	}
+
+	int status = 0;
+	::waitpid(pid, &status, 0);
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	EXPECT_EQ(WTERMSIG(status), SIGSEGV);
+	EXPECT_EQ(readTextFile(CRASH_DUMP_PATH).find("*** Fatal signal"), std::string::npos);
+}
+
+TEST_F(CrashHandlerTest, StackOverflowInOtherThread_CrashHandlerInstalled_BufferedRecordsDumped) {
+	const int status = runCrashingChild([]() {
+		std::thread thread([]() {
+			logRecords();
+			overflowStack(0);
+		});
+		thread.join();
+	});
+
+	ASSERT_TRUE(WIFSIGNALED(status));
+	EXPECT_EQ(WTERMSIG(status), SIGSEGV);
+
+	const auto dump = readTextFile(CRASH_DUMP_PATH);
+	EXPECT_NE(dump.find("*** Fatal signal 11"), std::string::npos);
+	EXPECT_NE(dump.find("record before crash 9"), std::string::npos);
+}
+
+}
@@ -0,0 +1,83 @@
+// Copyright (C) 2021 twyleg
+#include <logging/logger.h>
+#include <logging/sinks.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+auto LM = Logging::Logger::addModule("deferred_module");
+
+enum class TestEnum : int {
+	VALUE = 7
+};
+
+}
+
+class DeferredLoggingTest : public ::testing::Test {
+
+public:
+
+	DeferredLoggingTest() {
+		Logger::instance().removeAllSinks();
+		Logger::instance().addSink(mStringVectorSink);
+		Logger::instance().setModuleLogLevel(*LM, LL_DEBUG);
+	}
+
+protected:
+
+	std::shared_ptr<StringContainerSink<std::vector, std::mutex>> mStringVectorSink =
+			std::make_shared<StringContainerSink<std::vector, std::mutex>>();
+};
+
+TEST_F(DeferredLoggingTest, MixedArguments_LogDeferredAndFlush_MessageFormattedOnBackend) {
+	const std::string text = "text";
+	int value = 42;
+
+	LOG_DEFERRED(LM, LL_INFO, "int={} uint={} double={:.2f} bool={} char={} enum={} cstr={} str={}",
+			-1, 2u, 3.14159, true, 'x', TestEnum::VALUE, "literal", text);
+	LOG_DEFERRED(LM, LL_WARN, "pointer set: {}", &value != nullptr);
+	FLUSH_DEFERRED(LM);
+
+	const auto& messages = mStringVectorSink->getContainer();
+	ASSERT_EQ(messages.size(), 2);
+	EXPECT_NE(messages[0].find("[deferred_module] [info]: int=-1 uint=2 double=3.14 bool=true char=x enum=7 cstr=literal str=text"), std::string::npos);
+	EXPECT_NE(messages[1].find("[warning]: pointer set: true"), std::string::npos);
+}
+
+TEST_F(DeferredLoggingTest, FilteredLevel_LogDeferred_NothingLogged) {
+	Logger::instance().setModuleLogLevel(*LM, LL_ERROR);
+
+	LOG_DEFERRED(LM, LL_INFO, "filtered {}", 1);
+	FLUSH_DEFERRED(LM);
+
+	EXPECT_TRUE(mStringVectorSink->getContainer().empty());
+}
+
+TEST_F(DeferredLoggingTest, MultipleThreadsWrappingBuffer_LogDeferred_AllMessagesDelivered) {
+	constexpr int NUM_THREADS = 4;
+	constexpr int NUM_MESSAGES = 20000;
+
+	std::vector<std::thread> threads;
+	for (int t=0; t<NUM_THREADS; ++t) {
+		threads.emplace_back([t]() {
+			for (int i=0; i<NUM_MESSAGES; ++i) {
+				LOG_DEFERRED(LM, LL_DEBUG, "thread {} message {} {}", t, i, std::string(i % 50, 'x'));
+			}
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+	FLUSH_DEFERRED(LM);
+
+	EXPECT_EQ(mStringVectorSink->getContainer().size(), NUM_THREADS * NUM_MESSAGES);
+}
+
+}
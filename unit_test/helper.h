@@ -3,7 +3,10 @@
 
 #include <boost/filesystem.hpp>
 
+#include <zlib.h>
+
 #include <fstream>
+#include <string>
 #include <vector>
 
 namespace Logging::Testing {
@@ -36,6 +39,18 @@ inline std::vector<std::string> readTextFileToVector(const boost::filesystem::pa
 	return vec;
 }
 
+inline std::string readGzipFile(const boost::filesystem::path& filepath) {
+	gzFile file = ::gzopen(filepath.c_str(), "rb");
+	std::string content;
+	char buffer[4096];
+	int size;
+	while ((size = ::gzread(file, buffer, sizeof(buffer))) > 0) {
+		content.append(buffer, static_cast<size_t>(size));
+	}
+	::gzclose(file);
+	return content;
+}
+
 inline void writeTextFile(const boost::filesystem::path& filepath, const std::string_view& content) {
 	std::ofstream ofs(filepath);
 	ofs << content;
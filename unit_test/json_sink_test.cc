@@ -0,0 +1,134 @@
+// Copyright (C) 2021 twyleg
+#include "helper.h"
+
+#include <logging/json_sink.h>
+#include <logging/logger.h>
+#include <logging/sinks.h>
+
+#include <spdlog/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+auto LM = Logging::Logger::addModule("json_module");
+
+std::string escape(std::string_view value) {
+	spdlog::memory_buf_t buffer;
+	JsonSink::appendEscaped(value, buffer);
+	return std::string(buffer.data(), buffer.size());
+}
+
+}
+
+class JsonSinkTest : public ::testing::Test {
+
+public:
+
+	JsonSinkTest() {
+		Logger::instance().removeAllSinks();
+		Logger::instance().setModuleLogLevel(*LM, LL_DEBUG);
+	}
+
+	~JsonSinkTest() override {
+		Logger::instance().removeAllSinks();
+	}
+
+protected:
+
+	const boost::filesystem::path mTestDir = getTempTestDir();
+	const boost::filesystem::path mFilePath = mTestDir / "test.ndjson";
+};
+
+TEST_F(JsonSinkTest, TypedFields_LogKv_WrittenAsJsonMembers) {
+	Logger::instance().addSink(std::make_shared<JsonSink>(mFilePath, true));
+
+	const std::string user = "alice";
+	LOG_KV(LM, LL_INFO, "request done", "user", user, "latency_us", 1250u, "ratio", 0.5, "cached", false,
+			"code", -3, "grade", 'A', "nan", std::numeric_limits<double>::quiet_NaN());
+	LOG(LM, LL_WARN, "plain {}", 1);
+	FLUSH(LM);
+
+	const auto lines = readTextFileToVector(mFilePath);
+	ASSERT_EQ(lines.size(), 2);
+
+	const std::regex prefix("^\\{\"time\":\"\\d{4}-\\d{2}-\\d{2}T\\d{2}:\\d{2}:\\d{2}\\.\\d{6}Z\",(.*)$");
+	std::smatch match;
+	ASSERT_TRUE(std::regex_match(lines[0], match, prefix)) << lines[0];
+	EXPECT_NE(match[1].str().find("\"level\":\"info\",\"module\":\"json_module\",\"thread\":"), std::string::npos);
+	EXPECT_NE(match[1].str().find(",\"message\":\"request done\",\"fields\":{\"user\":\"alice\",\"latency_us\":1250,"
+			"\"ratio\":0.5,\"cached\":false,\"code\":-3,\"grade\":\"A\",\"nan\":null}}"), std::string::npos) << lines[0];
+
+	ASSERT_TRUE(std::regex_match(lines[1], match, prefix)) << lines[1];
+	EXPECT_NE(match[1].str().find("\"level\":\"warning\""), std::string::npos);
+	EXPECT_NE(match[1].str().find(",\"message\":\"plain 1\"}"), std::string::npos);
+}
+
+TEST_F(JsonSinkTest, FieldsNamedLikeRecordMembers_LogKv_NoDuplicateMembers) {
+	Logger::instance().addSink(std::make_shared<JsonSink>(mFilePath, true));
+
+	LOG_KV(LM, LL_INFO, "request done", "time", 1, "level", 2, "module", 3, "thread", 4, "message", "user text");
+	FLUSH(LM);
+
+	const auto lines = readTextFileToVector(mFilePath);
+	ASSERT_EQ(lines.size(), 1);
+	const std::regex record("^\\{\"time\":\"[^\"]*\",\"level\":\"info\",\"module\":\"json_module\",\"thread\":\\d+,"
+			"\"message\":\"request done\",\"fields\":\\{[^{}]*\\}\\}$");
+	EXPECT_TRUE(std::regex_match(lines[0], record)) << lines[0];
+	EXPECT_NE(lines[0].find(",\"message\":\"request done\",\"fields\":{\"time\":1,\"level\":2,\"module\":3,\"thread\":4,"
+			"\"message\":\"user text\"}}"), std::string::npos) << lines[0];
+}
+
+TEST_F(JsonSinkTest, SpecialCharacters_AppendEscaped_EscapedAsJson) {
+	EXPECT_EQ(escape(""), "");
+	EXPECT_EQ(escape("plain text"), "plain text");
+	EXPECT_EQ(escape("say \"hi\"\\"), "say \\\"hi\\\"\\\\");
+	EXPECT_EQ(escape(std::string("a\nb\tc\rd\be\ff\x01g\x1f", 14)), "a\\nb\\tc\\rd\\be\\ff\\u0001g\\u001f");
+	EXPECT_EQ(escape("0123456789abcdef0123456789abcdef\"0123456789\n"),
+			"0123456789abcdef0123456789abcdef\\\"0123456789\\n");
+	EXPECT_EQ(escape("\xc3\xa4 0123456789abcdef"), "\xc3\xa4 0123456789abcdef");
+}
+
+TEST_F(JsonSinkTest, TextSink_LogKv_FieldsRenderedInline) {
+	auto stringVectorSink = std::make_shared<StringContainerSink<std::vector, std::mutex>>();
+	Logger::instance().addSink(stringVectorSink);
+
+	LOG_KV(LM, LL_INFO, "request done", "user", "bob smith", "latency_us", 17, "empty", "", "ok", true);
+
+	const auto& messages = stringVectorSink->getContainer();
+	ASSERT_EQ(messages.size(), 1);
+	EXPECT_NE(messages[0].find("[json_module] [info]: request done user=\"bob smith\" latency_us=17 empty=\"\" ok=true"),
+			std::string::npos) << messages[0];
+}
+
+TEST_F(JsonSinkTest, AsyncSink_LogKv_FieldsReachStructuredSink) {
+	auto jsonSink = std::make_shared<JsonSink>(mFilePath, true);
+	auto stringVectorSink = std::make_shared<StringContainerSink<std::vector, std::mutex>>();
+	stringVectorSink->set_pattern("%v");
+	auto asyncSink = std::make_shared<AsyncSink>(AsyncSink::Parameters{16, AsyncSink::OverflowPolicy::BLOCK, 1},
+			std::vector<spdlog::sink_ptr>{jsonSink, stringVectorSink});
+	spdlog::logger logger("async_json", asyncSink);
+
+	for (int i=0; i<100; ++i) {
+		Structured::log(logger, LL_INFO, "tick", "index", i, "name", std::string(i % 40, 'x'));
+	}
+	logger.flush();
+
+	const auto lines = readTextFileToVector(mFilePath);
+	ASSERT_EQ(lines.size(), 100);
+	EXPECT_NE(lines[99].find("\"message\":\"tick\",\"fields\":{\"index\":99,\"name\":\"" + std::string(19, 'x') + "\"}}"),
+			std::string::npos) << lines[99];
+
+	const auto& messages = stringVectorSink->getContainer();
+	ASSERT_EQ(messages.size(), 100);
+	EXPECT_EQ(messages[3], "tick index=3 name=xxx");
+}
+
+}
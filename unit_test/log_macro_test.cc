@@ -0,0 +1,65 @@
+// Copyright (C) 2021 twyleg
+#include <logging/logger.h>
+#include <logging/sinks.h>
+
+#include <gtest/gtest.h>
+
+#undef LOGGING_ACTIVE_LEVEL
+#define LOGGING_ACTIVE_LEVEL LOGGING_LEVEL_WARN
+
+namespace Logging::Testing {
+
+namespace {
+
+auto LM = Logging::Logger::addModule("log_macro_module");
+
+}
+
+class LogMacroTest : public ::testing::Test {
+
+public:
+
+	LogMacroTest() {
+		Logger::instance().removeAllSinks();
+		Logger::instance().addSink(mStringVectorSink);
+		Logger::instance().setModuleLogLevel(*LM, LL_DEBUG);
+	}
+
+protected:
+
+	std::shared_ptr<StringContainerSink<std::vector, std::mutex>> mStringVectorSink =
+			std::make_shared<StringContainerSink<std::vector, std::mutex>>();
+};
+
+TEST_F(LogMacroTest, LevelBelowActiveLevel_Log_ArgumentsNotEvaluatedAndNothingLogged) {
+	int evaluated = 0;
+
+	LOG(LM, LL_DEBUG, "debug {}", ++evaluated);
+	LOG(LM, LL_INFO, "info {}", ++evaluated);
+	LOG_DEFERRED(LM, LL_INFO, "deferred info {}", ++evaluated);
+
+	EXPECT_EQ(evaluated, 0);
+	EXPECT_TRUE(mStringVectorSink->getContainer().empty());
+}
+
+TEST_F(LogMacroTest, LevelAtActiveLevel_Log_MessageLogged) {
+	int evaluated = 0;
+
+	LOG(LM, LL_WARN, "warn {}", ++evaluated);
+	LOG(LM, LL_ERROR, "error without arguments");
+
+	EXPECT_EQ(evaluated, 1);
+	ASSERT_EQ(mStringVectorSink->getContainer().size(), 2);
+	EXPECT_NE(mStringVectorSink->getContainer()[0].find("[warning]: warn 1"), std::string::npos);
+}
+
+TEST_F(LogMacroTest, ModuleLevelAboveMessageLevel_Log_ArgumentsNotEvaluated) {
+	Logger::instance().setModuleLogLevel(*LM, LL_ERROR);
+	int evaluated = 0;
+
+	LOG(LM, LL_WARN, "warn {}", ++evaluated);
+
+	EXPECT_EQ(evaluated, 0);
+}
+
+}
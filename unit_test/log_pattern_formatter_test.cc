@@ -0,0 +1,47 @@
+// Copyright (C) 2021 twyleg
+#include <logging/log_pattern_formatter.h>
+
+#include <spdlog/pattern_formatter.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+namespace Logging::Testing {
+
+namespace {
+
+std::string format(spdlog::formatter& formatter, const spdlog::details::log_msg& msg) {
+	spdlog::memory_buf_t formatted;
+	formatter.format(msg, formatted);
+	return std::string(formatted.data(), formatted.size());
+}
+
+}
+
+TEST(LogPatternFormatterTest, Records_Format_SameOutputAsPatternFormatter) {
+	LogPatternFormatter formatter;
+	spdlog::pattern_formatter patternFormatter(LogPatternFormatter::PATTERN);
+
+	const auto start = spdlog::log_clock::now();
+	const char* names[] = {"module_a", "module.b", ""};
+	for (int i=0; i<1000; ++i) {
+		const auto payload = fmt::format("message {}", i);
+		spdlog::details::log_msg msg(names[i % 3], static_cast<spdlog::level::level_enum>(i % spdlog::level::n_levels),
+				payload);
+		msg.time = start + std::chrono::milliseconds(i * 37);
+		msg.thread_id = static_cast<size_t>(i % 7) * 100003;
+		EXPECT_EQ(format(formatter, msg), format(patternFormatter, msg));
+	}
+}
+
+TEST(LogPatternFormatterTest, CreateFormatter_OtherPattern_PatternFormatterUsed) {
+	auto formatter = createFormatter("%l: %v");
+	spdlog::details::log_msg msg("module", spdlog::level::warn, "message");
+
+	EXPECT_EQ(format(*formatter, msg), std::string("warning: message") + spdlog::details::os::default_eol);
+	EXPECT_NE(dynamic_cast<LogPatternFormatter*>(createFormatter(LogPatternFormatter::PATTERN).get()), nullptr);
+}
+
+}
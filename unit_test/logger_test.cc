@@ -13,9 +13,13 @@
 
 #include <string>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <list>
 #include <regex>
+#include <sstream>
+#include <thread>
 
 namespace Logging::Testing {
 
@@ -67,6 +71,16 @@ constexpr const char* VALID_TEST_CONFIG_WITHOUT_SINKS_XML = R"(
 </TestConfig>
 )";
 
+constexpr const char* VALID_TEST_CONFIG_WITH_ERROR_LEVEL_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Error"/>
+		 <Sinks/>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
 constexpr const char* VALID_TEST_CONFIG_WITH_SINKS_XML = R"(
 <TestConfig>
 	<Logging>
@@ -83,6 +97,185 @@ constexpr const char* VALID_TEST_CONFIG_WITH_SINKS_XML = R"(
 </TestConfig>
 )";
 
+constexpr const char* VALID_TEST_CONFIG_WITH_URING_SINK_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <SingleFileSink outputDir="./log"/>
+			 <UringFileSink outputDir="./log"/>
+		 </Sinks>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_COMPRESSED_ROTATING_SINK_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <RotatingFileSink outputDir="./log" maxSize="512" maxNumFiles="100" compress="gzip" compressionLevel="1"/>
+		 </Sinks>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_CHANGED_COMPRESSED_ROTATING_SINK_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <RotatingFileSink outputDir="./log" maxSize="512" maxNumFiles="100" compress="gzip" compressionLevel="9"/>
+		 </Sinks>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_ASYNC_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <SingleFileSink outputDir="./log"/>
+		 </Sinks>
+		 <Async queueSize="1024" overflowPolicy="dropOldest" workerThreads="1"/>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_CATEGORIES_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks/>
+		 <Categories>
+			 <Category name="qt.qpa.xcb" module="qt_xcb"/>
+			 <Category name="default" module="qt"/>
+		 </Categories>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_BLOCKING_ASYNC_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <SingleFileSink outputDir="./log"/>
+		 </Sinks>
+		 <Async queueSize="1024" overflowPolicy="block" workerThreads="1"/>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_SINGLE_FILE_SINK_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <SingleFileSink outputDir="./log"/>
+		 </Sinks>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_WILDCARD_MODULES_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Error">
+			 <Module name="net.*" logLevel="Info"/>
+			 <Module name="net.http.client" logLevel="Debug"/>
+		 </LogLevel>
+		 <Sinks/>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_RATE_LIMITS_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Info">
+			 <Module name="flood.*" maxRate="100" burst="20"/>
+			 <Module name="flood.repeats" logLevel="Debug" maxRepeats="5"/>
+			 <Module name="flood.*" sampleRate="0.25"/>
+			 <Module name="flood.rate" sampleRate="1"/>
+		 </LogLevel>
+		 <Sinks/>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_FILTERED_SINKS_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <SingleFileSink outputDir="./log" fileName="all"/>
+			 <SingleFileSink outputDir="./log" fileName="errors" level="Error" pattern="%l: %v"/>
+			 <SingleFileSink outputDir="./log" fileName="audit" modules="audit.* module_b"/>
+		 </Sinks>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_FILTERED_ASYNC_SINKS_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <SingleFileSink outputDir="./log" fileName="all"/>
+			 <SingleFileSink outputDir="./log" fileName="errors" level="Error" pattern="%l: %v"/>
+			 <SingleFileSink outputDir="./log" fileName="audit" modules="audit.* module_b"/>
+		 </Sinks>
+		 <Async queueSize="1024" overflowPolicy="block" workerThreads="1"/>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* VALID_TEST_CONFIG_WITH_ROUTES_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <SingleFileSink name="main" outputDir="./log" fileName="main"/>
+			 <SingleFileSink name="audit" outputDir="./log" fileName="audit"/>
+			 <SingleFileSink name="qml" outputDir="./log" fileName="qml"/>
+		 </Sinks>
+		 <Routes>
+			 <Route modules="audit.*" sinks="audit main"/>
+			 <Route modules="qml qml_js" sinks="qml"/>
+		 </Routes>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
+constexpr const char* INVALID_TEST_CONFIG_WITH_UNKNOWN_ROUTE_SINK_XML = R"(
+<TestConfig>
+	<Logging>
+		 <LogLevel defaultLogLevel="Debug"/>
+		 <Sinks>
+			 <SingleFileSink name="main" outputDir="./log"/>
+		 </Sinks>
+		 <Routes>
+			 <Route modules="audit.*" sinks="audit"/>
+		 </Routes>
+	</Logging>
+	 <Foo>Foobar</Foo>
+</TestConfig>
+)";
+
 constexpr const char* INVALID_TEST_CONFIG_XML = R"(
 <TestConfig>
 	<Logging>
@@ -120,10 +313,13 @@ protected:
 		return logConfig;
 	}
 
-	void expectSinkParameters(const Logger::Config::SinkMap& sinks, const std::string& sinkName,
+	void expectSinkParameters(const Logger::Config::SinkList& sinks, const std::string& sinkType,
 			const std::unordered_map<std::string, std::string>& expectedParameterMap) {
-		auto actualParameterMap = sinks.find(sinkName)->second;
-		EXPECT_TRUE(actualParameterMap == expectedParameterMap);
+		auto it = std::find_if(sinks.begin(), sinks.end(), [&sinkType](const auto& sink) {
+			return sink.mType == sinkType;
+		});
+		ASSERT_NE(it, sinks.end());
+		EXPECT_TRUE(it->mParameters == expectedParameterMap);
 	}
 };
 
@@ -141,10 +337,123 @@ TEST_F(LoggerConfigTest, ValidConfig_ReadConfig_ReturnLogConfigFile) {
 	expectSinkParameters(logConfig.mSinks, "TimestampFileSink", {{"outputDir", "./log"}});
 }
 
+TEST_F(LoggerConfigTest, ValidConfigWithAsync_ReadConfig_ReturnAsyncParameters) {
+	auto logConfig = configure(VALID_TEST_CONFIG_WITH_ASYNC_XML);
+
+	ASSERT_TRUE(logConfig.mAsync);
+	EXPECT_EQ(logConfig.mAsync->mQueueSize, 1024);
+	EXPECT_EQ(logConfig.mAsync->mOverflowPolicy, AsyncSink::OverflowPolicy::DROP_OLDEST);
+	EXPECT_EQ(logConfig.mAsync->mWorkerThreads, 1);
+}
+
+TEST_F(LoggerConfigTest, ValidConfigWithCategories_ReadConfig_ReturnCategoryModules) {
+	auto logConfig = configure(VALID_TEST_CONFIG_WITH_CATEGORIES_XML);
+
+	ASSERT_EQ(logConfig.mCategoryModules.size(), 2);
+	EXPECT_EQ(logConfig.mCategoryModules.at("qt.qpa.xcb"), "qt_xcb");
+	EXPECT_EQ(logConfig.mCategoryModules.at("default"), "qt");
+}
+
+TEST_F(LoggerConfigTest, ValidConfig_Configure_ModuleLevelTableUpdated) {
+	configure(VALID_TEST_CONFIG_WITH_SINKS_XML);
+	auto lateModule = Logger::addModule("module_added_after_configure");
+
+	EXPECT_NE(LM->id(), lateModule->id());
+	EXPECT_TRUE(LM->shouldLog(LL_DEBUG));
+	EXPECT_FALSE(lateModule->shouldLog(LL_DEBUG));
+	EXPECT_TRUE(lateModule->shouldLog(LL_INFO));
+
+	Logger::instance().setModuleLogLevel(*lateModule, LL_ERROR);
+	EXPECT_FALSE(lateModule->shouldLog(LL_WARN));
+	EXPECT_EQ(lateModule->level(), LL_ERROR);
+}
+
+TEST_F(LoggerConfigTest, ValidConfigWithWildcardModules_Configure_LevelsResolvedPerModule) {
+	auto clientModule = Logger::addModule("net.http.client");
+	auto serverModule = Logger::addModule("net.http.server");
+	auto otherModule = Logger::addModule("storage");
+
+	configure(VALID_TEST_CONFIG_WITH_WILDCARD_MODULES_XML);
+
+	EXPECT_EQ(clientModule->level(), LL_DEBUG);
+	EXPECT_EQ(serverModule->level(), LL_INFO);
+	EXPECT_EQ(otherModule->level(), LL_ERROR);
+}
+
+TEST_F(LoggerConfigTest, ValidConfigWithRateLimits_Configure_RateLimitsAndSampleRatesResolvedPerModule) {
+	auto rateModule = Logger::addModule("flood.rate");
+	auto repeatsModule = Logger::addModule("flood.repeats");
+	auto otherModule = Logger::addModule("quiet");
+
+	auto logConfig = configure(VALID_TEST_CONFIG_WITH_RATE_LIMITS_XML);
+
+	EXPECT_EQ(logConfig.mModuleLogLevel.size(), 1);
+	ASSERT_EQ(logConfig.mModuleRateLimits.size(), 2);
+	EXPECT_EQ(logConfig.mModuleRateLimits.at("flood.*"), (RateLimit{100.0, 20, 0}));
+	EXPECT_EQ(logConfig.mModuleRateLimits.at("flood.repeats"), (RateLimit{0.0, 1, 5}));
+
+	EXPECT_TRUE(rateModule->rateLimiter().enabled());
+	EXPECT_TRUE(repeatsModule->rateLimiter().enabled());
+	EXPECT_FALSE(otherModule->rateLimiter().enabled());
+	EXPECT_EQ(repeatsModule->level(), LL_DEBUG);
+
+	ASSERT_EQ(logConfig.mModuleSampleRates.size(), 2);
+	EXPECT_DOUBLE_EQ(logConfig.mModuleSampleRates.at("flood.*"), 0.25);
+	EXPECT_FALSE(rateModule->sampler().enabled());
+	EXPECT_DOUBLE_EQ(repeatsModule->sampler().getRate(), 0.25);
+	EXPECT_FALSE(otherModule->sampler().enabled());
+
+	configure(VALID_TEST_CONFIG_WITHOUT_SINKS_XML);
+	EXPECT_FALSE(rateModule->rateLimiter().enabled());
+	EXPECT_FALSE(repeatsModule->sampler().enabled());
+}
+
 TEST_F(LoggerConfigTest, InvalidConfig_ReadConfig_Throw) {
 	EXPECT_THROW(configure(INVALID_TEST_CONFIG_XML), SimpleXercesc::XmlReader::XmlException);
 }
 
+TEST_F(LoggerConfigTest, ValidConfigWithRoutes_Configure_SinksAttachedToRoutedModules) {
+	auto auditModule = Logger::addModule("audit.payment");
+	auto qmlModule = Logger::addModule("qml_js");
+	configure(VALID_TEST_CONFIG_WITH_ROUTES_XML);
+
+	EXPECT_EQ(LM->getSinks().size(), 0);
+	EXPECT_EQ(auditModule->getSinks().size(), 2);
+	EXPECT_EQ(qmlModule->getSinks().size(), 1);
+}
+
+TEST_F(LoggerConfigTest, ValidConfig_ConfigureTwice_SinksReplacedNotDuplicated) {
+	configure(VALID_TEST_CONFIG_WITH_SINKS_XML);
+	const auto sinks = LM->getSinks();
+	configure(VALID_TEST_CONFIG_WITH_SINKS_XML);
+
+	EXPECT_EQ(LM->getSinks(), sinks);
+	configure(VALID_TEST_CONFIG_WITHOUT_SINKS_XML);
+	EXPECT_EQ(LM->getSinks().size(), 0);
+}
+
+TEST_F(LoggerConfigTest, WatchedConfig_ModifyConfigFile_ConfigReloaded) {
+	configure(VALID_TEST_CONFIG_WITHOUT_SINKS_XML);
+	EXPECT_EQ(LM->level(), LL_DEBUG);
+
+	const boost::filesystem::path configFilePath = boost::filesystem::current_path() / TEST_CONFIG_FILENAME;
+	Logger::instance().watchConfigFile(configFilePath, readLogConfig);
+	writeTextFile(configFilePath, VALID_TEST_CONFIG_WITH_ERROR_LEVEL_XML);
+
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (LM->level() != LL_ERROR && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	Logger::instance().unwatchConfigFile();
+
+	EXPECT_EQ(LM->level(), LL_ERROR);
+	configure(VALID_TEST_CONFIG_WITHOUT_SINKS_XML);
+}
+
+TEST_F(LoggerConfigTest, InvalidConfigWithUnknownRouteSink_ReadConfig_Throw) {
+	EXPECT_THROW(configure(INVALID_TEST_CONFIG_WITH_UNKNOWN_ROUTE_SINK_XML), std::runtime_error);
+}
+
 class LoggerTest : public LoggerConfigTest{
 
 public:
@@ -202,6 +511,185 @@ TEST_F(LoggerTest, ValidConfigWithMultipleSinks_LogMessage_MessageLoggedInFiles)
 	expectLogFileContains(timestampFilePath, 0, "[debug]: log message 42");
 }
 
+TEST_F(LoggerTest, ValidConfigWithSingleAndUringFileSink_LogMessage_MessageLoggedInSeparateFiles) {
+	configure(VALID_TEST_CONFIG_WITH_URING_SINK_XML);
+
+	boost::filesystem::path singleFilePath = "./log/test_logging.log";
+	boost::filesystem::path uringFilePath = "./log/test_logging.uring.log";
+
+	expectLogFileExists(singleFilePath);
+	expectLogFileExists(uringFilePath);
+
+	LOG(LM, LL_DEBUG, "log message {}", 42);
+	FLUSH(LM);
+
+	EXPECT_EQ(readTextFileToVector(singleFilePath).size(), 1);
+	EXPECT_EQ(readTextFileToVector(uringFilePath).size(), 1);
+	expectLogFileContains(singleFilePath, 0, "[debug]: log message 42");
+	expectLogFileContains(uringFilePath, 0, "[debug]: log message 42");
+}
+
+TEST_F(LoggerTest, CompressedRotatingSink_ReloadWithChangedParameters_NoRecordLost) {
+	constexpr int NUM_MESSAGES = 400;
+	for (int i=0; i<NUM_MESSAGES; ++i) {
+		if (i % 100 == 0) {
+			configure(i % 200 ? VALID_TEST_CONFIG_WITH_CHANGED_COMPRESSED_ROTATING_SINK_XML
+					: VALID_TEST_CONFIG_WITH_COMPRESSED_ROTATING_SINK_XML);
+		}
+		LOG(LM, LL_INFO, "compressed message {}", i);
+	}
+	configure(VALID_TEST_CONFIG_WITHOUT_SINKS_XML);
+
+	std::vector<int> messageNumbers;
+	const std::regex segmentRegex(R"(test_logging\.rotating\.\d{6}\.log(\.gz)?)");
+	for (const auto& entry: boost::filesystem::directory_iterator("./log")) {
+		const auto fileName = entry.path().filename().string();
+		if (!std::regex_match(fileName, segmentRegex)) {
+			continue;
+		}
+		std::istringstream content(entry.path().extension() == ".gz" ? readGzipFile(entry.path()) : readTextFile(entry.path()));
+		for (std::string line; std::getline(content, line);) {
+			messageNumbers.push_back(std::stoi(line.substr(line.rfind(' ') + 1)));
+		}
+	}
+	std::sort(messageNumbers.begin(), messageNumbers.end());
+
+	ASSERT_EQ(messageNumbers.size(), NUM_MESSAGES);
+	for (int i=0; i<NUM_MESSAGES; ++i) {
+		ASSERT_EQ(messageNumbers[i], i);
+	}
+}
+
+TEST_F(LoggerTest, ValidConfigWithFilteredSinks_LogMessages_MessagesLoggedPerSink) {
+	auto auditModule = Logger::addModule("audit.login");
+	configure(VALID_TEST_CONFIG_WITH_FILTERED_SINKS_XML);
+
+	LOG(LM, LL_INFO, "module message {}", 1);
+	LOG(LM, LL_ERROR, "module message {}", 2);
+	LOG(auditModule, LL_INFO, "audit message {}", 3);
+	FLUSH(LM);
+	FLUSH(auditModule);
+
+	const auto allLines = readTextFileToVector("./log/all.log");
+	const auto errorLines = readTextFileToVector("./log/errors.log");
+	const auto auditLines = readTextFileToVector("./log/audit.log");
+
+	ASSERT_EQ(allLines.size(), 3);
+	ASSERT_EQ(errorLines.size(), 1);
+	ASSERT_EQ(auditLines.size(), 1);
+	EXPECT_EQ(errorLines[0], "error: module message 2");
+	EXPECT_NE(auditLines[0].find("[audit.login] [info]: audit message 3"), std::string::npos);
+}
+
+TEST_F(LoggerTest, ValidConfigWithFilteredAsyncSinks_LogMessages_MessagesLoggedPerSink) {
+	auto auditModule = Logger::addModule("audit.async");
+	configure(VALID_TEST_CONFIG_WITH_FILTERED_ASYNC_SINKS_XML);
+
+	LOG(LM, LL_INFO, "module message {}", 1);
+	LOG(LM, LL_ERROR, "module message {}", 2);
+	LOG(auditModule, LL_INFO, "audit message {}", 3);
+	LOG_KV(auditModule, LL_INFO, "audit fields", "user", "root");
+	FLUSH(LM);
+	FLUSH(auditModule);
+
+	const auto allLines = readTextFileToVector("./log/all.log");
+	const auto errorLines = readTextFileToVector("./log/errors.log");
+	const auto auditLines = readTextFileToVector("./log/audit.log");
+
+	ASSERT_EQ(allLines.size(), 4);
+	ASSERT_EQ(errorLines.size(), 1);
+	ASSERT_EQ(auditLines.size(), 2);
+	EXPECT_EQ(errorLines[0], "error: module message 2");
+	EXPECT_NE(auditLines[0].find("[audit.async] [info]: audit message 3"), std::string::npos);
+	EXPECT_NE(auditLines[1].find("audit fields"), std::string::npos);
+	configure(VALID_TEST_CONFIG_WITHOUT_SINKS_XML);
+}
+
+TEST_F(LoggerTest, ValidConfigWithFilteredSinks_SetModuleLogLevel_LevelLimitedBySinks) {
+	auto auditModule = Logger::addModule("audit.session");
+	configure(VALID_TEST_CONFIG_WITH_FILTERED_SINKS_XML);
+	Logger::instance().removeAllSinks();
+
+	Logger::instance().setModuleLogLevel(*auditModule, LL_DEBUG);
+	EXPECT_TRUE(auditModule->shouldLog(LL_DEBUG));
+
+	auto errorSink = std::make_shared<StringContainerSink<std::vector, std::mutex>>();
+	Logger::instance().addSink(errorSink);
+	errorSink->set_level(LL_ERROR);
+	Logger::instance().setModuleLogLevel(*auditModule, LL_DEBUG);
+	EXPECT_FALSE(auditModule->shouldLog(LL_WARN));
+	EXPECT_TRUE(auditModule->shouldLog(LL_ERROR));
+}
+
+TEST_F(LoggerTest, ValidConfigWithRoutes_LogMessages_MessagesLoggedInRoutedFiles) {
+	auto auditModule = Logger::addModule("audit.access");
+	auto qmlModule = Logger::addModule("qml");
+	configure(VALID_TEST_CONFIG_WITH_ROUTES_XML);
+
+	LOG(auditModule, LL_INFO, "audit message");
+	LOG(qmlModule, LL_INFO, "qml message");
+	FLUSH(auditModule);
+	FLUSH(qmlModule);
+
+	const auto mainLines = readTextFileToVector("./log/main.log");
+	const auto qmlLines = readTextFileToVector("./log/qml.log");
+	ASSERT_EQ(mainLines.size(), 1);
+	ASSERT_EQ(qmlLines.size(), 1);
+	EXPECT_NE(mainLines[0].find("audit message"), std::string::npos);
+	EXPECT_EQ(readTextFileToVector("./log/audit.log"), mainLines);
+	EXPECT_NE(qmlLines[0].find("qml message"), std::string::npos);
+}
+
+TEST_F(LoggerTest, ValidConfig_ReconfigureWhileLogging_NoMessagesLost) {
+	configure(VALID_TEST_CONFIG_WITH_SINGLE_FILE_SINK_XML);
+
+	std::atomic<bool> stop{false};
+	std::atomic<int> numMessages{0};
+	std::thread producer([&]() {
+		while (!stop.load()) {
+			LOG(LM, LL_INFO, "message {}", numMessages.load());
+			numMessages++;
+		}
+	});
+	for (int i=0; i<10; ++i) {
+		configure(i % 2 ? VALID_TEST_CONFIG_WITH_SINGLE_FILE_SINK_XML : VALID_TEST_CONFIG_WITH_BLOCKING_ASYNC_XML);
+	}
+	stop = true;
+	producer.join();
+	Logger::instance().removeAllSinks();
+
+	// Records still queued in a replaced async sink may be written after newer ones
+	auto lines = readTextFileToVector("./log/test_logging.log");
+	ASSERT_EQ(lines.size(), numMessages.load());
+	std::vector<int> messageNumbers;
+	for (const auto& line: lines) {
+		messageNumbers.push_back(std::stoi(line.substr(line.rfind(' ') + 1)));
+	}
+	std::sort(messageNumbers.begin(), messageNumbers.end());
+	for (int i=0; i<numMessages.load(); ++i) {
+		ASSERT_EQ(messageNumbers[i], i);
+	}
+}
+
+TEST_F(LoggerTest, ValidConfigWithAsync_LogMessagesAndFlush_MessagesLoggedInFile) {
+	configure(VALID_TEST_CONFIG_WITH_ASYNC_XML);
+
+	boost::filesystem::path singleFilePath = "./log/test_logging.log";
+
+	for (int i=0; i<100; ++i) {
+		LOG(LM, LL_INFO, "async message {}", i);
+	}
+	FLUSH(LM);
+
+	expectLogFileContains(singleFilePath, 0, "[info]: async message 0");
+	expectLogFileContains(singleFilePath, 99, "[info]: async message 99");
+
+	auto statistics = Logger::instance().getAsyncStatistics();
+	ASSERT_TRUE(statistics);
+	EXPECT_EQ(statistics->mEnqueuedMessages, 100);
+	EXPECT_EQ(statistics->mDroppedMessages, 0);
+}
+
 TEST_F(LoggerTest, ValidConfig_LogMessagesOnDifferentLevels_MessagesLogged) {
 	configure(VALID_TEST_CONFIG_WITHOUT_SINKS_XML);
 
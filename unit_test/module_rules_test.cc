@@ -0,0 +1,55 @@
+// Copyright (C) 2021 twyleg
+#include <logging/level.h>
+#include <logging/module_rules.h>
+
+#include <boost/optional/optional_io.hpp>
+
+#include <gtest/gtest.h>
+
+namespace Logging::Testing {
+
+TEST(ModuleRulesTest, ExactRule_Resolve_OnlyExactNameMatches) {
+	ModuleLevelRules rules({{"net.http", LL_WARN}});
+
+	EXPECT_EQ(rules.resolve("net.http"), LL_WARN);
+	EXPECT_FALSE(rules.resolve("net"));
+	EXPECT_FALSE(rules.resolve("net.http.client"));
+	EXPECT_FALSE(rules.resolve("other"));
+}
+
+TEST(ModuleRulesTest, WildcardRules_Resolve_MostSpecificRuleWins) {
+	ModuleLevelRules rules({
+		{"*", LL_ERROR},
+		{"net.*", LL_INFO},
+		{"net.http.*", LL_DEBUG},
+		{"net.http.server", LL_WARN}
+	});
+
+	EXPECT_EQ(rules.resolve("other"), LL_ERROR);
+	EXPECT_EQ(rules.resolve("net"), LL_ERROR);
+	EXPECT_EQ(rules.resolve("net.udp"), LL_INFO);
+	EXPECT_EQ(rules.resolve("net.http"), LL_INFO);
+	EXPECT_EQ(rules.resolve("net.http.client"), LL_DEBUG);
+	EXPECT_EQ(rules.resolve("net.http.client.pool"), LL_DEBUG);
+	EXPECT_EQ(rules.resolve("net.http.server"), LL_WARN);
+}
+
+TEST(ModuleRulesTest, FlatModuleNames_Resolve_BehaveLikeExactMap) {
+	ModuleLevelRules rules({{"test_module_b", LL_DEBUG}, {"test_module_c", LL_ERROR}});
+
+	EXPECT_EQ(rules.resolve("test_module_b"), LL_DEBUG);
+	EXPECT_EQ(rules.resolve("test_module_c"), LL_ERROR);
+	EXPECT_FALSE(rules.resolve("test_module_a"));
+}
+
+TEST(ModuleRulesTest, PatternList_Matches_OnlyListedModulesMatch) {
+	ModuleFilter filter({"audit.*", "qml", "qml_js"}, true);
+
+	EXPECT_TRUE(filter.matches("audit.login"));
+	EXPECT_TRUE(filter.matches("qml"));
+	EXPECT_TRUE(filter.matches("qml_js"));
+	EXPECT_FALSE(filter.matches("audit"));
+	EXPECT_FALSE(filter.matches("net.http"));
+}
+
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2021 twyleg
+#include <qt_logging/log_filter_model.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace Logging::Qt::Testing {
+
+class LogFilterModelTest : public ::testing::Test {
+
+public:
+
+	LogFilterModelTest() {
+		mFilterModel.setSourceModel(&mModel);
+	}
+
+protected:
+
+	void append(const std::vector<std::pair<spdlog::level::level_enum, std::string>>& records, const std::string& module = "module") {
+		std::vector<LogRecord> logRecords;
+		for (const auto& [level, message]: records) {
+			logRecords.push_back({0, 1, level, module, message});
+		}
+		mModel.appendRecords(logRecords);
+	}
+
+	std::vector<std::string> getMessages() const {
+		std::vector<std::string> messages;
+		for (int row=0; row<mFilterModel.rowCount(); ++row) {
+			messages.push_back(mFilterModel.data(mFilterModel.index(row), LogModel::MessageRole).toString().toStdString());
+		}
+		return messages;
+	}
+
+	LogModel mModel;
+	LogFilterModel mFilterModel;
+};
+
+TEST_F(LogFilterModelTest, MinimumLevel_AppendRecords_OnlyMatchingRowsShown) {
+	append({{spdlog::level::debug, "debug 0"}, {spdlog::level::warn, "warning 1"}});
+	mFilterModel.setMinimumLevel(spdlog::level::info);
+	append({{spdlog::level::err, "error 2"}, {spdlog::level::info, "info 3"}, {spdlog::level::trace, "trace 4"}});
+
+	EXPECT_EQ(getMessages(), std::vector<std::string>({"warning 1", "error 2", "info 3"}));
+
+	mFilterModel.setMinimumLevel(spdlog::level::trace);
+	EXPECT_EQ(mFilterModel.rowCount(), 5);
+}
+
+TEST_F(LogFilterModelTest, Modules_SetModules_OnlySelectedModulesShown) {
+	append({{spdlog::level::info, "first a"}}, "a");
+	append({{spdlog::level::info, "first b"}}, "b");
+	append({{spdlog::level::info, "second a"}}, "a");
+
+	mFilterModel.setModules({"a"});
+	EXPECT_EQ(getMessages(), std::vector<std::string>({"first a", "second a"}));
+
+	append({{spdlog::level::info, "first c"}}, "c");
+	mFilterModel.setModules({"b", "c"});
+	EXPECT_EQ(getMessages(), std::vector<std::string>({"first b", "first c"}));
+}
+
+TEST_F(LogFilterModelTest, SearchText_EvictSourceRows_FilteredRowsFollowSource) {
+	mModel.setMaxRows(4);
+	mFilterModel.setSearchText("Conn");
+	append({{spdlog::level::info, "connected 0"}, {spdlog::level::info, "idle 1"}, {spdlog::level::info, "Connection lost 2"}});
+	EXPECT_EQ(getMessages(), std::vector<std::string>({"connected 0", "Connection lost 2"}));
+
+	append({{spdlog::level::info, "idle 3"}, {spdlog::level::info, "idle 4"}});
+	EXPECT_EQ(getMessages(), std::vector<std::string>({"Connection lost 2"}));
+
+	append({{spdlog::level::info, "reconnect 5"}, {spdlog::level::info, "idle 6"}, {spdlog::level::info, "idle 7"}, {spdlog::level::info, "idle 8"}});
+	EXPECT_EQ(getMessages(), std::vector<std::string>({"reconnect 5"}));
+
+	mFilterModel.setSearchText("conn lost");
+	EXPECT_EQ(mFilterModel.rowCount(), 0);
+	mFilterModel.setSearchText("");
+	EXPECT_EQ(getMessages(), std::vector<std::string>({"reconnect 5", "idle 6", "idle 7", "idle 8"}));
+}
+
+TEST_F(LogFilterModelTest, SourceMaxRowsChanged_SetMaxRows_FilterRebuilt) {
+	mFilterModel.setSearchText("keep");
+	append({{spdlog::level::info, "keep 0"}, {spdlog::level::info, "drop 1"}, {spdlog::level::info, "keep 2"}, {spdlog::level::info, "keep 3"}});
+
+	mModel.setMaxRows(2);
+	EXPECT_EQ(getMessages(), std::vector<std::string>({"keep 2", "keep 3"}));
+}
+
+}
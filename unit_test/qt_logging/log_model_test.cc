@@ -0,0 +1,96 @@
+// Copyright (C) 2021 twyleg
+#include <qt_logging/log_model.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace Logging::Qt::Testing {
+
+namespace {
+
+std::vector<LogRecord> createRecords(int first, int count) {
+	std::vector<LogRecord> records;
+	for (int i=first; i<first+count; ++i) {
+		records.push_back({i, 1, spdlog::level::info, "module", "message " + std::to_string(i)});
+	}
+	return records;
+}
+
+std::vector<std::string> getMessages(const LogModel& model) {
+	std::vector<std::string> messages;
+	for (int row=0; row<model.rowCount(); ++row) {
+		messages.emplace_back(model.messageAt(row));
+		EXPECT_EQ(model.data(model.index(row), LogModel::MessageRole).toString().toStdString(), messages.back());
+	}
+	return messages;
+}
+
+}
+
+class LogModelTest : public ::testing::Test {
+
+protected:
+
+	void append(int first, int count) {
+		auto records = createRecords(first, count);
+		mModel.appendRecords(records);
+	}
+
+	LogModel mModel;
+};
+
+TEST_F(LogModelTest, FewerRowsThanMaxRows_AppendRecords_AllRowsKept) {
+	append(0, 3);
+	append(3, 2);
+
+	EXPECT_EQ(mModel.rowCount(), 5);
+	EXPECT_EQ(mModel.firstSequence(), 0);
+	EXPECT_EQ(getMessages(mModel), std::vector<std::string>({"message 0", "message 1", "message 2", "message 3", "message 4"}));
+}
+
+TEST_F(LogModelTest, BatchLargerThanMaxRows_AppendToGrowingRing_NewestRowsKept) {
+	mModel.setMaxRows(4);
+	append(0, 2);
+	append(2, 6);
+
+	EXPECT_EQ(mModel.firstSequence(), 2);
+	EXPECT_EQ(getMessages(mModel), std::vector<std::string>({"message 4", "message 5", "message 6", "message 7"}));
+
+	append(8, 1);
+	EXPECT_EQ(mModel.firstSequence(), 3);
+	EXPECT_EQ(getMessages(mModel), std::vector<std::string>({"message 5", "message 6", "message 7", "message 8"}));
+}
+
+TEST_F(LogModelTest, MoreRowsThanMaxRows_AppendBatches_OldestRowsEvictedAcrossWrap) {
+	mModel.setMaxRows(5);
+	for (int i=0; i<12; i+=3) {
+		append(i, 3);
+	}
+
+	EXPECT_EQ(mModel.firstSequence(), 7);
+	EXPECT_EQ(getMessages(mModel), std::vector<std::string>({"message 7", "message 8", "message 9", "message 10", "message 11"}));
+	EXPECT_EQ(mModel.levelAt(0), spdlog::level::info);
+	EXPECT_EQ(mModel.moduleName(mModel.moduleAt(0)).toStdString(), "module");
+}
+
+TEST_F(LogModelTest, SetMaxRows_ShrinkAndGrow_NewestRowsRetained) {
+	mModel.setMaxRows(10);
+	append(0, 8);
+
+	mModel.setMaxRows(3);
+	EXPECT_EQ(mModel.maxRows(), 3);
+	EXPECT_EQ(mModel.firstSequence(), 5);
+	EXPECT_EQ(getMessages(mModel), std::vector<std::string>({"message 5", "message 6", "message 7"}));
+
+	append(8, 2);
+	EXPECT_EQ(getMessages(mModel), std::vector<std::string>({"message 7", "message 8", "message 9"}));
+
+	mModel.setMaxRows(6);
+	append(10, 4);
+	EXPECT_EQ(mModel.firstSequence(), 8);
+	EXPECT_EQ(getMessages(mModel), std::vector<std::string>({"message 8", "message 9", "message 10", "message 11", "message 12", "message 13"}));
+}
+
+}
@@ -0,0 +1,140 @@
+// Copyright (C) 2021 twyleg
+#include <logging/logger.h>
+#include <logging/rate_limiter.h>
+#include <logging/sinks.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+constexpr int64_t MS = 1000000;
+
+auto LM = Logging::Logger::addModule("rate_limited_module");
+
+void waitForNextSecond() {
+	const auto now = std::chrono::steady_clock::now().time_since_epoch();
+	const auto second = std::chrono::duration_cast<std::chrono::seconds>(now);
+	std::this_thread::sleep_until(std::chrono::steady_clock::time_point(second + std::chrono::seconds(1)));
+}
+
+}
+
+TEST(RateLimiterTest, Burst_AdmitFasterThanRate_BurstAdmittedThenLimited) {
+	RateLimiter rateLimiter;
+	rateLimiter.configure({100.0, 5, 0});
+	LogCallSite callSite{__FILE__, __LINE__};
+
+	int admitted = 0;
+	for (int i=0; i<20; ++i) {
+		admitted += rateLimiter.admit(&callSite, 1000 * MS).mAdmitted;
+	}
+	EXPECT_EQ(admitted, 5);
+
+	const auto admission = rateLimiter.admit(&callSite, 1000 * MS + 10 * MS);
+	EXPECT_TRUE(admission.mAdmitted);
+	EXPECT_EQ(admission.mSuppressedByRate, 15);
+	EXPECT_EQ(admission.mSuppressedRepeats, 0);
+	EXPECT_FALSE(rateLimiter.admit(&callSite, 1000 * MS + 10 * MS).mAdmitted);
+}
+
+TEST(RateLimiterTest, MaxRepeats_SameCallSite_RepeatsLimitedPerSecond) {
+	RateLimiter rateLimiter;
+	rateLimiter.configure({0.0, 0, 3});
+	LogCallSite callSite{__FILE__, __LINE__};
+	LogCallSite otherCallSite{__FILE__, __LINE__};
+
+	int admitted = 0;
+	for (int i=0; i<10; ++i) {
+		admitted += rateLimiter.admit(&callSite, 5000 * MS + i).mAdmitted;
+	}
+	EXPECT_EQ(admitted, 3);
+	EXPECT_TRUE(rateLimiter.admit(&otherCallSite, 5000 * MS).mAdmitted);
+	EXPECT_TRUE(rateLimiter.admit(nullptr, 5000 * MS).mAdmitted);
+
+	const auto admission = rateLimiter.admit(&callSite, 6000 * MS);
+	EXPECT_TRUE(admission.mAdmitted);
+	EXPECT_EQ(admission.mSuppressedRepeats, 7);
+}
+
+TEST(RateLimiterTest, Unlimited_Configure_Disabled) {
+	RateLimiter rateLimiter;
+	EXPECT_FALSE(rateLimiter.enabled());
+	rateLimiter.configure({10.0, 1, 0});
+	EXPECT_TRUE(rateLimiter.enabled());
+	rateLimiter.configure({0.0, 0, 0});
+	EXPECT_FALSE(rateLimiter.enabled());
+}
+
+class RateLimitedModuleTest : public ::testing::Test {
+
+public:
+
+	RateLimitedModuleTest() {
+		Logger::instance().removeAllSinks();
+		Logger::instance().addSink(mStringVectorSink);
+		Logger::instance().setModuleLogLevel(*LM, LL_DEBUG);
+	}
+
+	~RateLimitedModuleTest() override {
+		Logger::instance().setModuleRateLimit(*LM, {0.0, 0, 0});
+		Logger::instance().removeAllSinks();
+	}
+
+protected:
+
+	std::shared_ptr<StringContainerSink<std::vector, std::mutex>> mStringVectorSink =
+			std::make_shared<StringContainerSink<std::vector, std::mutex>>();
+};
+
+TEST_F(RateLimitedModuleTest, RepeatedCallSite_Log_RepeatsSuppressedAndSummarized) {
+	Logger::instance().setModuleRateLimit(*LM, {0.0, 0, 2});
+
+	int formatted = 0;
+	const auto logFailure = [&formatted]() {
+		LOG(LM, LL_ERROR, "dependency failed {}", ++formatted);
+	};
+	waitForNextSecond();
+	for (int i=0; i<1000; ++i) {
+		logFailure();
+	}
+	LOG_KV(LM, LL_ERROR, "other call site", "attempt", 1);
+	waitForNextSecond();
+	logFailure();
+
+	EXPECT_EQ(formatted, 3);
+	const auto& messages = mStringVectorSink->getContainer();
+	ASSERT_EQ(messages.size(), 5);
+	EXPECT_NE(messages[0].find("dependency failed 1"), std::string::npos);
+	EXPECT_NE(messages[1].find("dependency failed 2"), std::string::npos);
+	EXPECT_NE(messages[2].find("other call site attempt=1"), std::string::npos);
+	EXPECT_NE(messages[3].find("[error]: Suppressed 998 repeated messages from "), std::string::npos) << messages[3];
+	EXPECT_NE(messages[3].find("rate_limiter_test.cc:"), std::string::npos);
+	EXPECT_NE(messages[4].find("dependency failed 3"), std::string::npos);
+}
+
+TEST_F(RateLimitedModuleTest, ModuleRate_LogAfterSuppression_SummaryLoggedBeforeNextRecord) {
+	Logger::instance().setModuleRateLimit(*LM, {1000.0, 3, 0});
+
+	for (int i=0; i<50; ++i) {
+		LOG(LM, LL_WARN, "flood {}", i);
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	LOG(LM, LL_WARN, "after flood");
+
+	const auto& messages = mStringVectorSink->getContainer();
+	ASSERT_GE(messages.size(), 5);
+	EXPECT_NE(messages[0].find("flood 0"), std::string::npos);
+	const auto& summary = messages[messages.size() - 2];
+	EXPECT_NE(summary.find("[warning]: Suppressed "), std::string::npos) << summary;
+	EXPECT_NE(summary.find(" messages exceeding the rate limit of the module"), std::string::npos) << summary;
+	EXPECT_NE(messages.back().find("after flood"), std::string::npos);
+}
+
+}
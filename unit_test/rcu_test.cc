@@ -0,0 +1,71 @@
+// Copyright (C) 2021 twyleg
+#include <logging/rcu.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+struct Object {
+	explicit Object(int value)
+		: mValue(value),
+		  mCheck(value)
+	{}
+
+	~Object() {
+		mCheck = -1;
+	}
+
+	int mValue;
+	int mCheck;
+};
+
+}
+
+TEST(RcuPointerTest, Update_Read_NewObjectReturned) {
+	RcuPointer<Object> pointer(std::make_shared<Object>(1));
+	EXPECT_EQ(pointer.read()->mValue, 1);
+
+	auto previous = pointer.update(std::make_shared<Object>(2));
+	EXPECT_EQ(previous->mValue, 1);
+	EXPECT_EQ(pointer.read()->mValue, 2);
+	EXPECT_EQ(pointer.load()->mValue, 2);
+}
+
+TEST(RcuPointerTest, ConcurrentReaders_Update_NoReaderSeesReleasedObject) {
+	RcuPointer<Object> pointer(std::make_shared<Object>(0));
+
+	std::atomic<bool> stop{false};
+	std::atomic<int> numInvalidReads{0};
+	std::vector<std::thread> readers;
+	for (int i=0; i<4; ++i) {
+		readers.emplace_back([&]() {
+			int lastValue = 0;
+			while (!stop.load()) {
+				const auto object = pointer.read();
+				if (object->mCheck != object->mValue || object->mValue < lastValue) {
+					numInvalidReads++;
+				}
+				lastValue = object->mValue;
+			}
+		});
+	}
+
+	for (int i=1; i<=1000; ++i) {
+		pointer.update(std::make_shared<Object>(i));
+	}
+	stop = true;
+	for (auto& reader: readers) {
+		reader.join();
+	}
+
+	EXPECT_EQ(numInvalidReads.load(), 0);
+	EXPECT_EQ(pointer.read()->mValue, 1000);
+}
+
+}
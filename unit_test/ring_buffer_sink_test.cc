@@ -0,0 +1,135 @@
+// Copyright (C) 2021 twyleg
+#include <logging/ring_buffer_sink.h>
+
+#include <spdlog/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <regex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+// Counts how often the sink clones it for a producer thread
+class CountingFormatter : public spdlog::formatter {
+
+public:
+
+	explicit CountingFormatter(std::shared_ptr<std::atomic<int>> clones)
+		: mClones(std::move(clones))
+	{}
+
+	void format(const spdlog::details::log_msg& msg, spdlog::memory_buf_t& dest) override {
+		dest.append(msg.payload.data(), msg.payload.data() + msg.payload.size());
+		dest.push_back('\n');
+	}
+
+	std::unique_ptr<spdlog::formatter> clone() const override {
+		mClones->fetch_add(1);
+		return std::make_unique<CountingFormatter>(mClones);
+	}
+
+private:
+
+	std::shared_ptr<std::atomic<int>> mClones;
+};
+
+}
+
+class RingBufferSinkTest : public ::testing::Test {
+
+protected:
+
+	std::shared_ptr<spdlog::logger> createLogger(size_t capacity, size_t recordSize) {
+		mSink = std::make_shared<RingBufferSink>(capacity, recordSize);
+		mSink->set_pattern("%v");
+		return std::make_shared<spdlog::logger>("ring", mSink);
+	}
+
+	std::shared_ptr<RingBufferSink> mSink;
+};
+
+TEST_F(RingBufferSinkTest, MoreRecordsThanCapacity_GetRecords_NewestRecordsReturned) {
+	auto logger = createLogger(4, 64);
+
+	for (int i=0; i<10; ++i) {
+		logger->info("message {}", i);
+	}
+
+	EXPECT_EQ(mSink->getRecords(), std::vector<std::string>({"message 6\n", "message 7\n", "message 8\n", "message 9\n"}));
+}
+
+TEST_F(RingBufferSinkTest, RecordLargerThanSlot_GetRecords_RecordTruncated) {
+	auto logger = createLogger(4, 8);
+
+	logger->info("0123456789");
+
+	EXPECT_EQ(mSink->getRecords(), std::vector<std::string>({"0123456\n"}));
+}
+
+TEST_F(RingBufferSinkTest, PatternChanged_Log_NewPatternUsed) {
+	auto logger = createLogger(4, 64);
+
+	logger->info("first");
+	mSink->set_pattern("[%l] %v");
+	logger->info("second");
+
+	EXPECT_EQ(mSink->getRecords(), std::vector<std::string>({"first\n", "[info] second\n"}));
+}
+
+TEST_F(RingBufferSinkTest, TwoSinks_LogAlternately_FormatterClonedOncePerSink) {
+	auto clones = std::make_shared<std::atomic<int>>(0);
+	auto firstSink = std::make_shared<RingBufferSink>(4, 64);
+	auto secondSink = std::make_shared<RingBufferSink>(4, 64);
+	firstSink->set_formatter(std::make_unique<CountingFormatter>(clones));
+	secondSink->set_formatter(std::make_unique<CountingFormatter>(clones));
+	spdlog::logger firstLogger("first", firstSink);
+	spdlog::logger secondLogger("second", secondSink);
+
+	for (int i=0; i<100; ++i) {
+		firstLogger.info("first {}", i);
+		secondLogger.info("second {}", i);
+	}
+
+	EXPECT_EQ(clones->load(), 2);
+	EXPECT_EQ(firstSink->getRecords().back(), "first 99\n");
+	EXPECT_EQ(secondSink->getRecords().back(), "second 99\n");
+}
+
+TEST_F(RingBufferSinkTest, ConcurrentProducers_ForEachRecord_RecordsComplete) {
+	constexpr int NUM_THREADS = 4;
+	constexpr int NUM_MESSAGES = 10000;
+	auto logger = createLogger(256, 64);
+
+	std::vector<std::thread> threads;
+	for (int t=0; t<NUM_THREADS; ++t) {
+		threads.emplace_back([&logger, t]() {
+			for (int i=0; i<NUM_MESSAGES; ++i) {
+				logger->info("thread {} message {}", t, i);
+			}
+		});
+	}
+	for (auto& thread: threads) {
+		thread.join();
+	}
+
+	const std::regex recordRegex(R"(thread \d message \d+\n)");
+	std::set<std::string> records;
+	mSink->forEachRecord([&](const char* data, size_t size) {
+		const std::string record(data, size);
+		EXPECT_TRUE(std::regex_match(record, recordRegex)) << record;
+		records.insert(record);
+	});
+
+	EXPECT_GT(records.size(), 0);
+	EXPECT_LE(records.size(), mSink->capacity());
+}
+
+}
@@ -0,0 +1,126 @@
+// Copyright (C) 2021 twyleg
+#include <logging/logger.h>
+#include <logging/sampler.h>
+#include <logging/sinks.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+constexpr int NUM_SAMPLES = 100000;
+
+auto LM = Logging::Logger::addModule("sampled_module");
+
+int countSampled(const Sampler& sampler, spdlog::level::level_enum level) {
+	int sampled = 0;
+	for (int i=0; i<NUM_SAMPLES; ++i) {
+		sampled += sampler.sample(level);
+	}
+	return sampled;
+}
+
+}
+
+TEST(SamplerTest, SampleRate_SampleDebug_FractionKept) {
+	Sampler sampler;
+	EXPECT_FALSE(sampler.enabled());
+	EXPECT_EQ(countSampled(sampler, LL_DEBUG), NUM_SAMPLES);
+
+	sampler.setRate(0.25);
+	EXPECT_TRUE(sampler.enabled());
+	EXPECT_DOUBLE_EQ(sampler.getRate(), 0.25);
+	EXPECT_NEAR(countSampled(sampler, LL_DEBUG), NUM_SAMPLES / 4, NUM_SAMPLES / 50);
+
+	sampler.setRate(0.0);
+	EXPECT_EQ(countSampled(sampler, LL_DEBUG), 0);
+}
+
+TEST(SamplerTest, SampleRate_SampleHigherLevels_AllKept) {
+	Sampler sampler;
+	sampler.setRate(0.0);
+	EXPECT_EQ(countSampled(sampler, LL_INFO), NUM_SAMPLES);
+	EXPECT_EQ(countSampled(sampler, LL_ERROR), NUM_SAMPLES);
+}
+
+TEST(SamplerTest, TraceScope_SampleRepeatedly_SameDecisionPerTrace) {
+	Sampler sampler;
+	sampler.setRate(0.5);
+	Sampler higherRateSampler;
+	higherRateSampler.setRate(0.75);
+
+	int keptTraces = 0;
+	for (uint64_t traceId=0; traceId<1000; ++traceId) {
+		TraceScope traceScope(traceId);
+		const bool kept = sampler.sample(LL_DEBUG);
+		for (int i=0; i<10; ++i) {
+			EXPECT_EQ(sampler.sample(LL_DEBUG), kept);
+		}
+		if (kept) {
+			EXPECT_TRUE(higherRateSampler.sample(LL_DEBUG));
+		}
+		keptTraces += kept;
+	}
+	EXPECT_NEAR(keptTraces, 500, 60);
+
+	const auto decision = [&sampler](std::string_view traceId) {
+		TraceScope traceScope(traceId);
+		return sampler.sample(LL_DEBUG);
+	};
+	EXPECT_EQ(decision("request-4711"), decision("request-4711"));
+}
+
+TEST(SamplerTest, NestedTraceScopes_LeaveScope_PreviousTraceRestored) {
+	Sampler sampler;
+	sampler.setRate(0.5);
+
+	TraceScope outerScope(std::string_view("outer"));
+	const bool outerDecision = sampler.sample(LL_DEBUG);
+	for (uint64_t traceId=0; traceId<64; ++traceId) {
+		TraceScope innerScope(traceId);
+		sampler.sample(LL_DEBUG);
+	}
+	EXPECT_EQ(sampler.sample(LL_DEBUG), outerDecision);
+}
+
+class SampledModuleTest : public ::testing::Test {
+
+public:
+
+	SampledModuleTest() {
+		Logger::instance().removeAllSinks();
+		Logger::instance().addSink(mStringVectorSink);
+		Logger::instance().setModuleLogLevel(*LM, LL_DEBUG);
+	}
+
+	~SampledModuleTest() override {
+		Logger::instance().setModuleSampleRate(*LM, 1.0);
+		Logger::instance().removeAllSinks();
+	}
+
+protected:
+
+	std::shared_ptr<StringContainerSink<std::vector, std::mutex>> mStringVectorSink =
+			std::make_shared<StringContainerSink<std::vector, std::mutex>>();
+};
+
+TEST_F(SampledModuleTest, SampleRate_LogDebugAndInfo_DebugSampledBeforeFormatting) {
+	Logger::instance().setModuleSampleRate(*LM, 0.1);
+
+	int formatted = 0;
+	for (int i=0; i<10000; ++i) {
+		LOG(LM, LL_DEBUG, "debug {}", ++formatted);
+	}
+	LOG(LM, LL_INFO, "info");
+
+	const auto& messages = mStringVectorSink->getContainer();
+	EXPECT_EQ(static_cast<int>(messages.size()) - 1, formatted);
+	EXPECT_NEAR(formatted, 1000, 150);
+	EXPECT_NE(messages.back().find("[info]: info"), std::string::npos);
+}
+
+}
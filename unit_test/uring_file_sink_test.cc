@@ -0,0 +1,111 @@
+// Copyright (C) 2021 twyleg
+#include "helper.h"
+
+#include <logging/level.h>
+#include <logging/uring_file_sink.h>
+
+#include <spdlog/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Logging::Testing {
+
+namespace {
+
+const boost::filesystem::path LOG_FILE_PATH = "./log/uring.log";
+
+}
+
+class UringFileSinkTest : public ::testing::Test {
+
+public:
+
+	UringFileSinkTest() {
+		createEmptyDirectory("./log/");
+	}
+
+protected:
+
+	void SetUp() override {
+		if (!UringFileSink::isSupported()) {
+			GTEST_SKIP() << "io_uring not supported";
+		}
+	}
+
+	std::shared_ptr<spdlog::logger> createLogger(std::shared_ptr<UringFileSink> sink) {
+		sink->set_pattern("%v");
+		return std::make_shared<spdlog::logger>("uring", sink);
+	}
+};
+
+TEST_F(UringFileSinkTest, ManyRecords_Flush_AllRecordsWrittenInOrder) {
+	auto sink = std::make_shared<UringFileSink>(LOG_FILE_PATH, true, UringFileSink::Parameters{2, 1024, LL_ERROR});
+	auto logger = createLogger(sink);
+
+	for (int i=0; i<10000; ++i) {
+		logger->info("message {}", i);
+	}
+	logger->flush();
+
+	const auto lines = readTextFileToVector(LOG_FILE_PATH);
+	ASSERT_EQ(lines.size(), 10000);
+	for (int i=0; i<10000; ++i) {
+		EXPECT_EQ(lines[i], "message " + std::to_string(i));
+	}
+}
+
+TEST_F(UringFileSinkTest, RecordLargerThanBuffer_Flush_RecordWritten) {
+	auto sink = std::make_shared<UringFileSink>(LOG_FILE_PATH, true, UringFileSink::Parameters{2, 64, LL_ERROR});
+	auto logger = createLogger(sink);
+	const std::string largeMessage(1000, 'x');
+
+	logger->info("small");
+	logger->info(largeMessage);
+	logger->info("small");
+	logger->flush();
+
+	EXPECT_EQ(readTextFileToVector(LOG_FILE_PATH), std::vector<std::string>({"small", largeMessage, "small"}));
+}
+
+TEST_F(UringFileSinkTest, TwoSinksOnSameFile_LogAlternately_NoRecordOverwritten) {
+	auto firstLogger = createLogger(std::make_shared<UringFileSink>(LOG_FILE_PATH, false, UringFileSink::Parameters{2, 64, LL_INFO}));
+	auto secondLogger = createLogger(std::make_shared<UringFileSink>(LOG_FILE_PATH, false, UringFileSink::Parameters{2, 64, LL_INFO}));
+
+	for (int i=0; i<100; ++i) {
+		(i % 2 ? secondLogger : firstLogger)->info("message {}", i);
+	}
+	firstLogger->flush();
+	secondLogger->flush();
+
+	// The two rings complete independently, only the records within each sink are ordered
+	std::vector<int> messageNumbers;
+	for (const auto& line: readTextFileToVector(LOG_FILE_PATH)) {
+		messageNumbers.push_back(std::stoi(line.substr(line.rfind(' ') + 1)));
+	}
+	std::sort(messageNumbers.begin(), messageNumbers.end());
+	ASSERT_EQ(messageNumbers.size(), 100);
+	for (int i=0; i<100; ++i) {
+		EXPECT_EQ(messageNumbers[i], i);
+	}
+}
+
+TEST_F(UringFileSinkTest, MaxFileSize_Log_FilesRotated) {
+	auto sink = std::make_shared<UringFileSink>(LOG_FILE_PATH, true, UringFileSink::Parameters{2, 1024, LL_ERROR}, 25, 2);
+	auto logger = createLogger(sink);
+
+	for (int i=0; i<6; ++i) {
+		logger->info("message {}", i);
+	}
+	logger->flush();
+
+	EXPECT_EQ(readTextFileToVector(LOG_FILE_PATH), std::vector<std::string>({"message 4", "message 5"}));
+	EXPECT_EQ(readTextFileToVector("./log/uring.1.log"), std::vector<std::string>({"message 2", "message 3"}));
+	EXPECT_EQ(readTextFileToVector("./log/uring.2.log"), std::vector<std::string>({"message 0", "message 1"}));
+}
+
+}
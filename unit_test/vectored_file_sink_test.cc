@@ -0,0 +1,164 @@
+// Copyright (C) 2021 twyleg
+#include "helper.h"
+
+#include <logging/vectored_file_sink.h>
+
+#include <spdlog/logger.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace Logging::Testing {
+
+namespace {
+
+const boost::filesystem::path LOG_FILE_PATH = "./log/vectored.log";
+
+VectoredFileSink::FlushPolicy createFlushPolicy(size_t maxRecords, std::chrono::milliseconds interval = std::chrono::milliseconds(0)) {
+	return {spdlog::level::level_enum::err, maxRecords, interval, 0};
+}
+
+}
+
+class VectoredFileSinkTest : public ::testing::Test {
+
+public:
+
+	VectoredFileSinkTest() {
+		createEmptyDirectory("./log/");
+	}
+
+protected:
+
+	std::shared_ptr<spdlog::logger> createLogger(std::shared_ptr<VectoredFileSink> sink) {
+		sink->set_pattern("%v");
+		return std::make_shared<spdlog::logger>("vectored", sink);
+	}
+};
+
+TEST_F(VectoredFileSinkTest, RecordsBelowFlushThreshold_Log_RecordsBuffered) {
+	auto sink = std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true, createFlushPolicy(3));
+	auto logger = createLogger(sink);
+
+	logger->info("message 0");
+	logger->info("message 1");
+	EXPECT_EQ(readTextFileToVector(LOG_FILE_PATH).size(), 0);
+
+	logger->info("message 2");
+	const auto lines = readTextFileToVector(LOG_FILE_PATH);
+	ASSERT_EQ(lines.size(), 3);
+	EXPECT_EQ(lines[2], "message 2");
+}
+
+TEST_F(VectoredFileSinkTest, RecordOnFlushLevel_Log_RecordsWritten) {
+	auto sink = std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true, createFlushPolicy(0));
+	auto logger = createLogger(sink);
+
+	logger->info("message 0");
+	EXPECT_EQ(readTextFileToVector(LOG_FILE_PATH).size(), 0);
+
+	logger->error("message 1");
+	EXPECT_EQ(readTextFileToVector(LOG_FILE_PATH).size(), 2);
+}
+
+TEST_F(VectoredFileSinkTest, FlushInterval_Log_RecordsWrittenByTimer) {
+	auto sink = std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true, createFlushPolicy(0, std::chrono::milliseconds(10)));
+	auto logger = createLogger(sink);
+
+	logger->info("message 0");
+	for (int i=0; i<200 && readTextFileToVector(LOG_FILE_PATH).empty(); ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	EXPECT_EQ(readTextFileToVector(LOG_FILE_PATH).size(), 1);
+}
+
+TEST_F(VectoredFileSinkTest, ManyRecords_Flush_AllRecordsWrittenInOrder) {
+	auto sink = std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true, createFlushPolicy(0));
+	auto logger = createLogger(sink);
+
+	for (int i=0; i<10000; ++i) {
+		logger->info("message {}", i);
+	}
+	logger->flush();
+
+	const auto lines = readTextFileToVector(LOG_FILE_PATH);
+	ASSERT_EQ(lines.size(), 10000);
+	for (int i=0; i<10000; ++i) {
+		EXPECT_EQ(lines[i], "message " + std::to_string(i));
+	}
+}
+
+TEST_F(VectoredFileSinkTest, MaxFileSize_Log_FilesRotated) {
+	auto sink = std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true, createFlushPolicy(1), 25, 2);
+	auto logger = createLogger(sink);
+
+	for (int i=0; i<6; ++i) {
+		logger->info("message {}", i);
+	}
+
+	EXPECT_EQ(readTextFileToVector(LOG_FILE_PATH), std::vector<std::string>({"message 4", "message 5"}));
+	EXPECT_EQ(readTextFileToVector("./log/vectored.1.log"), std::vector<std::string>({"message 2", "message 3"}));
+	EXPECT_EQ(readTextFileToVector("./log/vectored.2.log"), std::vector<std::string>({"message 0", "message 1"}));
+}
+
+TEST_F(VectoredFileSinkTest, RecordsLargerThanMaxFileSize_Log_NoEmptyFileRotated) {
+	auto sink = std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true, createFlushPolicy(1), 10, 2);
+	auto logger = createLogger(sink);
+
+	logger->info("large message 0");
+	logger->info("large message 1");
+
+	EXPECT_EQ(readTextFileToVector(LOG_FILE_PATH), std::vector<std::string>({"large message 1"}));
+	EXPECT_EQ(readTextFileToVector("./log/vectored.1.log"), std::vector<std::string>({"large message 0"}));
+	EXPECT_FALSE(boost::filesystem::exists("./log/vectored.2.log"));
+}
+
+TEST_F(VectoredFileSinkTest, IndexPolicy_Log_IndexBlocksCoverRecords) {
+	auto sink = std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true, createFlushPolicy(0), 0, 0, LogIndexWriter::Policy{2, 0});
+	auto logger = createLogger(sink);
+	auto otherLogger = std::make_shared<spdlog::logger>("other", sink);
+
+	logger->info("message 0");
+	logger->info("message 1");
+	otherLogger->error("message 2");
+	logger->flush();
+	EXPECT_EQ(LogIndex::read(LogIndex::indexPath(LOG_FILE_PATH)).size(), 1);
+
+	sink.reset();
+	logger.reset();
+	otherLogger.reset();
+
+	const auto entries = LogIndex::read(LogIndex::indexPath(LOG_FILE_PATH));
+	ASSERT_EQ(entries.size(), 2);
+	EXPECT_EQ(entries[0].mOffset, 0);
+	EXPECT_EQ(entries[0].mSize, 20);
+	EXPECT_EQ(entries[0].mNumRecords, 2);
+	EXPECT_EQ(entries[0].mLevelMask, 1u << spdlog::level::info);
+	EXPECT_EQ(entries[0].mModuleMask, LogIndex::moduleBit("vectored"));
+	EXPECT_LE(entries[0].mMinTimestamp, entries[0].mMaxTimestamp);
+	EXPECT_EQ(entries[1].mOffset, 20);
+	EXPECT_EQ(entries[1].mSize, 10);
+	EXPECT_EQ(entries[1].mLevelMask, 1u << spdlog::level::err);
+	EXPECT_EQ(entries[1].mModuleMask, LogIndex::moduleBit("other"));
+	EXPECT_GE(entries[1].mMinTimestamp, entries[0].mMaxTimestamp);
+}
+
+TEST_F(VectoredFileSinkTest, IndexPolicyAndMaxFileSize_Log_IndexRotatedWithFile) {
+	auto sink = std::make_shared<VectoredFileSink>(LOG_FILE_PATH, true, createFlushPolicy(1), 25, 2, LogIndexWriter::Policy{1, 0});
+	auto logger = createLogger(sink);
+
+	for (int i=0; i<4; ++i) {
+		logger->info("message {}", i);
+	}
+
+	EXPECT_EQ(LogIndex::read(LogIndex::indexPath(LOG_FILE_PATH)).size(), 2);
+	const auto rotatedEntries = LogIndex::read(LogIndex::indexPath("./log/vectored.1.log"));
+	ASSERT_EQ(rotatedEntries.size(), 2);
+	EXPECT_EQ(rotatedEntries[1].mOffset, 10);
+}
+
+}